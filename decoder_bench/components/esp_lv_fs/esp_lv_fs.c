@@ -14,7 +14,6 @@ static char *TAG = "lv_fs";
 
 typedef struct {
     const char *name;
-    const uint8_t *data;    // asset_mem
     size_t size;            // asset_size
 } file_descriptor_t;
 
@@ -27,6 +26,7 @@ typedef struct {
 
 typedef struct {
     int fd;
+    const uint8_t *data;    // asset_mem, pinned while the file is open
     size_t pos;
     bool is_open;     // Moved flag to indicate if the file is open
 } FILE_t;
@@ -36,20 +36,24 @@ static void *fs_open(lv_fs_drv_t *drv, const char *path, lv_fs_mode_t mode)
     LV_UNUSED(drv);
     file_system_t *fs = drv->user_data;
 
-    for (int i = 0; i < fs->file_count; i++) {
-        if (strcmp(fs->desc[i]->name, path) == 0) {
-            FILE_t *fp = (FILE_t *)malloc(sizeof(FILE_t));
-            if (!fp) {
-                return NULL;
-            }
-            fp->is_open = true;
-            fp->fd = i;
-            fp->pos = 0;
-            return (void*)fp;
-        }
+    int i = mmap_assets_find(fs->fs_assets, path);
+    if (i < 0 || i >= fs->file_count) {
+        return NULL; // file not found
     }
 
-    return NULL; // file not found
+    FILE_t *fp = (FILE_t *)malloc(sizeof(FILE_t));
+    if (!fp) {
+        return NULL;
+    }
+    fp->data = mmap_assets_get_mem(fs->fs_assets, i);
+    if (!fp->data) {
+        free(fp);
+        return NULL;
+    }
+    fp->is_open = true;
+    fp->fd = i;
+    fp->pos = 0;
+    return (void*)fp;
 }
 
 static lv_fs_res_t fs_close(lv_fs_drv_t *drv, void *file_p)
@@ -62,6 +66,7 @@ static lv_fs_res_t fs_close(lv_fs_drv_t *drv, void *file_p)
         return LV_FS_RES_FS_ERR;
     }
 
+    mmap_assets_release(fs->fs_assets, fp->fd);
     fp->is_open = false;
     free(fp);
     return LV_FS_RES_OK;
@@ -82,7 +87,7 @@ static lv_fs_res_t fs_read(lv_fs_drv_t *drv, void *file_p, void *buf, uint32_t b
         btr = file->size - fp->pos;
     }
 
-    mmap_assets_copy_mem(fs->fs_assets, (size_t)(file->data + fp->pos), buf, btr);
+    mmap_assets_copy_mem(fs->fs_assets, (size_t)(fp->data + fp->pos), buf, btr);
     fp->pos += btr;
     *br = btr;
     return LV_FS_RES_OK;
@@ -245,7 +250,6 @@ esp_err_t esp_lv_fs_desc_init(const fs_cfg_t *cfg, esp_lv_fs_handle_t *ret_handl
         ESP_GOTO_ON_FALSE(fs, ESP_ERR_NO_MEM, err, TAG, "no mem for file descriptor");
 
         fs->desc[i]->name = mmap_assets_get_name(fs->fs_assets, i);
-        fs->desc[i]->data = mmap_assets_get_mem(fs->fs_assets, i);
         fs->desc[i]->size = mmap_assets_get_size(fs->fs_assets, i);
 
         fs->file_count++;
@@ -17,6 +17,7 @@
 #include "esp_check.h"
 #include "esp_lv_sjpg.h"
 #include "esp_jpeg_dec.h"
+#include "split_image.h"
 
 #include "lvgl.h"
 
@@ -43,7 +44,7 @@ typedef struct {
     int sjpg_total_frames;
     int sjpg_single_frame_height;
     int sjpg_cache_frame_index;
-    uint8_t **frame_base_array;        //to save base address of each split frames upto sjpg_total_frames.
+    split_image_t split;               //Parsed header, locates the split frames in place.
     uint8_t *frame_cache;
     io_source_t io;
 } SJPEG;
@@ -63,6 +64,7 @@ static void lv_sjpg_free(SJPEG *jpg);
 /**********************
  *  STATIC VARIABLES
  **********************/
+static split_image_pool_t s_split_pool; //Shared splits of V3 images, registered by esp_lv_split_jpg_set_split_pool().
 
 /**********************
  *      MACROS
@@ -98,6 +100,15 @@ esp_err_t esp_lv_split_jpg_deinit(esp_lv_sjpg_decoder_handle_t handle)
     return ESP_OK;
 }
 
+esp_err_t esp_lv_split_jpg_set_split_pool(const void *pool, size_t size)
+{
+    ESP_RETURN_ON_FALSE(pool || !size, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+
+    s_split_pool.mem = pool;
+    s_split_pool.size = pool ? size : 0;
+    return ESP_OK;
+}
+
 static lv_fs_res_t jpg_load_file(const char *filename, uint8_t **buffer, size_t *size, bool read_head)
 {
     uint32_t len;
@@ -235,18 +246,13 @@ static lv_res_t decoder_info(lv_img_decoder_t *decoder, const void *src, lv_img_
 
         const lv_img_dsc_t * img_dsc = src;
         uint8_t *raw_sjpeg_data = (uint8_t *)img_dsc->data;
+        split_image_t split;
 
-        if (!strncmp((char *)raw_sjpeg_data, "_SJPG__", strlen("_SJPG__"))) {
-
-            raw_sjpeg_data += 14; //seek to res info ... refer sjpg format
+        if (split_image_parse(raw_sjpeg_data, img_dsc->data_size, "_SJPG__", &s_split_pool, &split)) {
             header->always_zero = 0;
             header->cf = LV_IMG_CF_RAW;
-
-            header->w = *raw_sjpeg_data++;
-            header->w |= *raw_sjpeg_data++ << 8;
-
-            header->h = *raw_sjpeg_data++;
-            header->h |= *raw_sjpeg_data++ << 8;
+            header->w = split.width;
+            header->h = split.height;
 
             return lv_ret;
         } else if (is_jpg(img_dsc->data, img_dsc->data_size) == true) {
@@ -294,7 +300,6 @@ static lv_res_t decoder_open(lv_img_decoder_t *decoder, lv_img_decoder_dsc_t *ds
 
     if (dsc->src_type == LV_IMG_SRC_VARIABLE) {
 
-        uint8_t *data;
         SJPEG *sjpg = (SJPEG *) dsc->user_data;
         const uint32_t raw_sjpg_data_size = ((lv_img_dsc_t *)dsc->src)->data_size;
         if (sjpg == NULL) {
@@ -310,41 +315,15 @@ static lv_res_t decoder_open(lv_img_decoder_t *decoder, lv_img_decoder_dsc_t *ds
             sjpg->sjpg_data_size = ((lv_img_dsc_t *)(dsc->src))->data_size;
         }
 
-        if (!strncmp((char *) sjpg->sjpg_data, "_SJPG__", strlen("_SJPG__"))) {
-            data = sjpg->sjpg_data;
-            data += 14;
-
-            sjpg->sjpg_x_res = *data++;
-            sjpg->sjpg_x_res |= *data++ << 8;
-
-            sjpg->sjpg_y_res = *data++;
-            sjpg->sjpg_y_res |= *data++ << 8;
-
-            sjpg->sjpg_total_frames = *data++;
-            sjpg->sjpg_total_frames |= *data++ << 8;
-
-            sjpg->sjpg_single_frame_height = *data++;
-            sjpg->sjpg_single_frame_height |= *data++ << 8;
+        if (split_image_parse(sjpg->sjpg_data, sjpg->sjpg_data_size, "_SJPG__", &s_split_pool, &sjpg->split)) {
+            sjpg->sjpg_x_res = sjpg->split.width;
+            sjpg->sjpg_y_res = sjpg->split.height;
+            sjpg->sjpg_total_frames = sjpg->split.splits;
+            sjpg->sjpg_single_frame_height = sjpg->split.split_height;
 
             ESP_LOGD(TAG, "[%d,%d], frames:%d, height:%d", sjpg->sjpg_x_res, sjpg->sjpg_y_res, \
                      sjpg->sjpg_total_frames, sjpg->sjpg_single_frame_height);
 
-            sjpg->frame_base_array = malloc(sizeof(uint8_t *) * sjpg->sjpg_total_frames);
-            if (! sjpg->frame_base_array) {
-                ESP_LOGE(TAG, "Not enough memory for frame_base_array allocation");
-                lv_sjpg_cleanup(sjpg);
-                sjpg = NULL;
-                return LV_RES_INV;
-            }
-
-            uint8_t *img_frame_base = data +  sjpg->sjpg_total_frames * 2;
-            sjpg->frame_base_array[0] = img_frame_base;
-
-            for (int i = 1; i <  sjpg->sjpg_total_frames; i++) {
-                int offset = *data++;
-                offset |= *data++ << 8;
-                sjpg->frame_base_array[i] = sjpg->frame_base_array[i - 1] + offset;
-            }
             sjpg->sjpg_cache_frame_index = -1;
             sjpg->frame_cache = (void *)malloc(sjpg->sjpg_x_res * sjpg->sjpg_single_frame_height * 4);
             if (! sjpg->frame_cache) {
@@ -472,15 +451,7 @@ static lv_res_t decoder_read_line(lv_img_decoder_t *decoder, lv_img_decoder_dsc_
 
         /*If line not from cache, refresh cache */
         if (sjpg_req_frame_index != sjpg->sjpg_cache_frame_index) {
-            sjpg->io.raw_sjpg_data = sjpg->frame_base_array[ sjpg_req_frame_index ];
-            if (sjpg_req_frame_index == (sjpg->sjpg_total_frames - 1)) {
-                /*This is the last frame. */
-                const uint32_t frame_offset = (uint32_t)(sjpg->io.raw_sjpg_data - sjpg->sjpg_data);
-                sjpg->io.raw_sjpg_data_size = sjpg->sjpg_data_size - frame_offset;
-            } else {
-                sjpg->io.raw_sjpg_data_size =
-                    (uint32_t)(sjpg->frame_base_array[sjpg_req_frame_index + 1] - sjpg->io.raw_sjpg_data);
-            }
+            sjpg->io.raw_sjpg_data = (uint8_t *)split_image_tile(&sjpg->split, sjpg_req_frame_index, &sjpg->io.raw_sjpg_data_size);
 
             lv_img_header_t header;             /*No used, just required by the decoder*/
 
@@ -551,9 +522,6 @@ static void lv_sjpg_free(SJPEG *jpg)
     if (jpg->frame_cache) {
         free(jpg->frame_cache);
     }
-    if (jpg->frame_base_array) {
-        free(jpg->frame_base_array);
-    }
 }
 
 static void lv_sjpg_cleanup(SJPEG *jpg)
@@ -37,6 +37,22 @@ esp_err_t esp_lv_split_jpg_init(esp_lv_sjpg_decoder_handle_t *ret_handle);
  */
 esp_err_t esp_lv_split_jpg_deinit(esp_lv_sjpg_decoder_handle_t handle);
 
+/**
+ * @brief Register the pool of splits shared by deduplicated images
+ *
+ * With CONFIG_MMAP_SPLIT_DEDUP, V3 split images read the splits they share with
+ * other images from the "split_pool.bin" asset, outside their own bytes. The
+ * decoder only follows those to the registered pool, so such images don't
+ * decode until it's registered. The pool has to stay mapped while they're drawn.
+ *
+ * @param pool Pool, e.g. mmap_assets_get_mem() of "split_pool.bin", NULL to unregister it
+ * @param size Num bytes in pool
+ * @return
+ *     - ESP_OK on success
+ *     - ESP_ERR_INVALID_ARG if pool is NULL and size isn't 0
+ */
+esp_err_t esp_lv_split_jpg_set_split_pool(const void *pool, size_t size);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
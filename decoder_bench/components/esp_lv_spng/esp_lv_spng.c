@@ -15,6 +15,7 @@
 
 #include "lvgl.h"
 #include "png.h"
+#include "split_image.h"
 
 /*********************
  *      DEFINES
@@ -36,7 +37,7 @@ typedef struct {
     int spng_total_frames;
     int spng_single_frame_height;
     int spng_cache_frame_index;
-    uint8_t **frame_base_array;        //to save base address of each split frames upto spng_total_frames.
+    split_image_t split;               //Parsed header, locates the split frames in place.
     uint8_t *frame_cache;
     io_source_t io;
 } SPNG;
@@ -60,6 +61,7 @@ static lv_res_t libpng_decode32(uint8_t **out, uint32_t *w, uint32_t *h, const u
  *  STATIC VARIABLES
  **********************/
 static const char *TAG = "spng";
+static split_image_pool_t s_split_pool; //Shared splits of V3 images, registered by esp_lv_split_png_set_split_pool().
 
 /**********************
  *      MACROS
@@ -99,6 +101,15 @@ esp_err_t esp_lv_split_png_deinit(esp_lv_spng_decoder_handle_t handle)
 
 }
 
+esp_err_t esp_lv_split_png_set_split_pool(const void *pool, size_t size)
+{
+    ESP_RETURN_ON_FALSE(pool || !size, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+
+    s_split_pool.mem = pool;
+    s_split_pool.size = pool ? size : 0;
+    return ESP_OK;
+}
+
 /**********************
  *   STATIC FUNCTIONS
  **********************/
@@ -198,16 +209,13 @@ static lv_res_t decoder_info(struct _lv_img_decoder_t *decoder, const void *src,
         const uint32_t data_size = img_dsc->data_size;
         const uint32_t *size = ((uint32_t *)img_dsc->data) + 4;
 
-        if (!strncmp((char *)raw_spng_data, "_SPNG__", strlen("_SPNG__"))) {
-            raw_spng_data += 14; //seek to res info ... refer spng format
+        split_image_t split;
+
+        if (split_image_parse(raw_spng_data, data_size, "_SPNG__", &s_split_pool, &split)) {
             header->always_zero = 0;
             header->cf = LV_IMG_CF_RAW_ALPHA;
-
-            header->w = *raw_spng_data++;
-            header->w |= *raw_spng_data++ << 8;
-
-            header->h = *raw_spng_data++;
-            header->h |= *raw_spng_data++ << 8;
+            header->w = split.width;
+            header->h = split.height;
 
             return lv_ret;
         } else if (is_png(raw_spng_data, data_size) == true) {
@@ -286,7 +294,6 @@ static lv_res_t decoder_open(lv_img_decoder_t *decoder, lv_img_decoder_dsc_t *ds
         uint32_t png_width;             /*No used, just required by he decoder*/
         uint32_t png_height;            /*No used, just required by he decoder*/
 
-        uint8_t *data;
         SPNG *spng = (SPNG *) dsc->user_data;
         const uint32_t raw_spng_data_size = ((lv_img_dsc_t *)dsc->src)->data_size;
         if (spng == NULL) {
@@ -302,40 +309,14 @@ static lv_res_t decoder_open(lv_img_decoder_t *decoder, lv_img_decoder_dsc_t *ds
             spng->spng_data_size = ((lv_img_dsc_t *)(dsc->src))->data_size;
         }
 
-        if (!strncmp((char *) spng->spng_data, "_SPNG__", strlen("_SPNG__"))) {
-            data = spng->spng_data;
-            data += 14;
-
-            spng->spng_x_res = *data++;
-            spng->spng_x_res |= *data++ << 8;
-
-            spng->spng_y_res = *data++;
-            spng->spng_y_res |= *data++ << 8;
-
-            spng->spng_total_frames = *data++;
-            spng->spng_total_frames |= *data++ << 8;
-
-            spng->spng_single_frame_height = *data++;
-            spng->spng_single_frame_height |= *data++ << 8;
+        if (split_image_parse(spng->spng_data, spng->spng_data_size, "_SPNG__", &s_split_pool, &spng->split)) {
+            spng->spng_x_res = spng->split.width;
+            spng->spng_y_res = spng->split.height;
+            spng->spng_total_frames = spng->split.splits;
+            spng->spng_single_frame_height = spng->split.split_height;
 
             ESP_LOGD(TAG, "[%d,%d], frames:%d, height:%d", spng->spng_x_res, spng->spng_y_res, \
                      spng->spng_total_frames, spng->spng_single_frame_height);
-            spng->frame_base_array = lv_mem_alloc(sizeof(uint8_t *) * spng->spng_total_frames);
-            if (! spng->frame_base_array) {
-                ESP_LOGE(TAG, "Not enough memory for frame_base_array allocation");
-                lv_spng_cleanup(spng);
-                spng = NULL;
-                return LV_RES_INV;
-            }
-
-            uint8_t *img_frame_base = data +  spng->spng_total_frames * 2;
-            spng->frame_base_array[0] = img_frame_base;
-
-            for (int i = 1; i <  spng->spng_total_frames; i++) {
-                int offset = *data++;
-                offset |= *data++ << 8;
-                spng->frame_base_array[i] = spng->frame_base_array[i - 1] + offset;
-            }
             spng->spng_cache_frame_index = -1;
             spng->frame_cache = (void *)lv_mem_alloc(spng->spng_x_res * spng->spng_single_frame_height * 4);
             if (! spng->frame_cache) {
@@ -467,15 +448,7 @@ static lv_res_t decoder_read_line(lv_img_decoder_t *decoder, lv_img_decoder_dsc_
 
         /*If line not from cache, refresh cache */
         if (spng_req_frame_index != spng->spng_cache_frame_index) {
-            spng->io.raw_spng_data = spng->frame_base_array[ spng_req_frame_index ];
-            if (spng_req_frame_index == (spng->spng_total_frames - 1)) {
-                /*This is the last frame. */
-                const uint32_t frame_offset = (uint32_t)(spng->io.raw_spng_data - spng->spng_data);
-                spng->io.raw_spng_data_size = spng->spng_data_size - frame_offset;
-            } else {
-                spng->io.raw_spng_data_size =
-                    (uint32_t)(spng->frame_base_array[spng_req_frame_index + 1] - spng->io.raw_spng_data);
-            }
+            spng->io.raw_spng_data = (uint8_t *)split_image_tile(&spng->split, spng_req_frame_index, &spng->io.raw_spng_data_size);
 
             uint32_t png_width;             /*No used, just required by he decoder*/
             uint32_t png_height;            /*No used, just required by he decoder*/
@@ -591,9 +564,6 @@ static void lv_spng_free(SPNG *spng)
     if (spng->frame_cache) {
         lv_mem_free(spng->frame_cache);
     }
-    if (spng->frame_base_array) {
-        lv_mem_free(spng->frame_base_array);
-    }
 }
 
 static void lv_spng_cleanup(SPNG *spng)
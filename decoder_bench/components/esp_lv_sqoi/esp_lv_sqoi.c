@@ -17,10 +17,37 @@
 
 #define QOI_IMPLEMENTATION
 #include "qoi.h"
+#include "split_image.h"
+#include "anim_image.h"
 
 /*********************
  *      DEFINES
  *********************/
+/*Pixel format qoi.h decodes to, matching LV_IMG_CF_TRUE_COLOR_ALPHA*/
+#if LV_COLOR_DEPTH == 32
+#define QOI_LV_FORMAT       QOI_FMT_ARGB8888
+#elif LV_COLOR_DEPTH == 16 && LV_COLOR_16_SWAP
+#define QOI_LV_FORMAT       QOI_FMT_RGB565A8_SWAP
+#elif LV_COLOR_DEPTH == 16
+#define QOI_LV_FORMAT       QOI_FMT_RGB565A8
+#else
+#define QOI_LV_FORMAT       4       /*RGBA8888, converted by convert_color_depth()*/
+#endif
+
+/*Pixel formats of "_SRAW__" images LVGL can draw in place, as LV_IMG_CF_TRUE_COLOR(_ALPHA)*/
+#if LV_COLOR_DEPTH == 16 && LV_COLOR_16_SWAP
+#define RAW_LV_FORMAT       SPLIT_IMAGE_PIXEL_RGB565_SWAP
+#define RAW_LV_FORMAT_ALPHA SPLIT_IMAGE_PIXEL_RGB565A8_SWAP
+#elif LV_COLOR_DEPTH == 16
+#define RAW_LV_FORMAT       SPLIT_IMAGE_PIXEL_RGB565
+#define RAW_LV_FORMAT_ALPHA SPLIT_IMAGE_PIXEL_RGB565A8
+#else
+#define RAW_LV_FORMAT       SPLIT_IMAGE_PIXEL_UNKNOWN
+#define RAW_LV_FORMAT_ALPHA SPLIT_IMAGE_PIXEL_UNKNOWN
+#endif
+
+/*Skipped animation frames whose dirty rects are still invalidated one by one, beyond that the whole image is*/
+#define ANIM_MAX_SKIPPED_FRAMES     4
 
 /**********************
  *      TYPEDEFS
@@ -30,6 +57,13 @@ typedef struct {
     uint32_t raw_qoi_data_size;        //Num bytes pointed to by raw_qoi_data.
 } io_source_t;
 
+typedef struct qoi_anim_t {
+    lv_img_dsc_t img;                  //Source handed to LVGL, the decoder finds the animation by its address.
+    anim_image_t anim;
+    int frame;                         //Frame drawn, -1 until the first esp_lv_split_qoi_anim_set_frame().
+    struct qoi_anim_t *next;
+} qoi_anim_t;
+
 typedef struct {
     uint8_t *qoi_data;
     uint32_t qoi_data_size;
@@ -38,8 +72,15 @@ typedef struct {
     int qoi_total_frames;
     int qoi_single_frame_height;
     int qoi_cache_frame_index;
-    uint8_t **frame_base_array;        //to save base address of each split frames upto qoi_total_frames.
+    int qoi_cache_row_first;           //Rows [qoi_cache_row_first, dec.y) of the cached frame are decoded.
+    qoi_dec_state dec;                 //Decoder state of the cached frame, resumed by the next row.
+    uint32_t dec_pos;                  //Offset of the next op of the cached frame.
+    split_image_t split;               //Parsed header, locates the split frames in place.
+    anim_image_t anim;                 //Parsed "_AQOI__" header, anim.frames is 0 for other images.
+    const qoi_anim_t *anim_src;        //Animation drawn, NULL to draw the first frame of anim.
+    int anim_cache_frame;              //Animation frame the cached split belongs to.
     uint8_t *frame_cache;
+    uint32_t frame_cache_size;         //Num bytes allocated in frame_cache.
     io_source_t io;
 } QOI;
 
@@ -53,15 +94,23 @@ static lv_res_t decoder_read_line(lv_img_decoder_t *decoder, lv_img_decoder_dsc_
 static void decoder_close(lv_img_decoder_t *dec, lv_img_decoder_dsc_t *dsc);
 static void convert_color_depth(uint8_t *img, uint32_t px_cnt);
 static int is_qoi(const uint8_t *raw_data, size_t len);
+static const uint8_t *raw_image_pixels(const uint8_t *raw_data, size_t len, split_image_t *split, lv_img_cf_t *cf);
+static QOI *lv_qoi_alloc(void);
+static esp_err_t lv_qoi_reserve(QOI *qoi, uint32_t cache_size);
 static void lv_qoi_cleanup(QOI *qoi);
 static void lv_qoi_free(QOI *qoi);
 
-static lv_res_t qoi_decode32(uint8_t **out, uint32_t *w, uint32_t *h, const uint8_t *in, size_t insize);
+static lv_res_t qoi_decode_frame(QOI *qoi, const uint8_t *in, size_t insize);
+static lv_res_t qoi_anim_decode_split(QOI *qoi, int frame, int split);
+static const qoi_anim_t *qoi_anim_find(const void *src);
 
 /**********************
  *  STATIC VARIABLES
  **********************/
 static const char *TAG = "sqoi";
+static QOI *s_qoi_spare;               //Released by decoder_close(), reused by the next decoder_open().
+static qoi_anim_t *s_anims;            //Animations opened by esp_lv_split_qoi_anim_new().
+static split_image_pool_t s_split_pool; //Shared splits of V3 images, registered by esp_lv_split_qoi_set_split_pool().
 
 /**********************
  *      MACROS
@@ -97,34 +146,225 @@ esp_err_t esp_lv_split_qoi_deinit(esp_lv_sqoi_decoder_handle_t handle)
     ESP_LOGD(TAG, "delete qoi decoder @%p", handle);
     lv_img_decoder_delete(handle);
 
+    if (s_qoi_spare) {
+        lv_qoi_free(s_qoi_spare);
+        free(s_qoi_spare);
+        s_qoi_spare = NULL;
+    }
+
+    return ESP_OK;
+
+}
+
+esp_err_t esp_lv_split_qoi_set_split_pool(const void *pool, size_t size)
+{
+    ESP_RETURN_ON_FALSE(pool || !size, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+
+    s_split_pool.mem = pool;
+    s_split_pool.size = pool ? size : 0;
     return ESP_OK;
+}
+
+esp_err_t esp_lv_split_qoi_anim_new(const void *data, size_t size, esp_lv_sqoi_anim_handle_t *ret_handle)
+{
+    ESP_RETURN_ON_FALSE(data && ret_handle, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+
+    anim_image_t anim;
+    ESP_RETURN_ON_FALSE(anim_image_parse(data, size, &anim), ESP_ERR_INVALID_ARG, TAG, "not a QOI animation");
+
+    qoi_anim_t *qoi_anim = calloc(1, sizeof(qoi_anim_t));
+    ESP_RETURN_ON_FALSE(qoi_anim, ESP_ERR_NO_MEM, TAG, "Not enough memory for animation allocation");
+
+    qoi_anim->img.header.cf = LV_IMG_CF_RAW_ALPHA;
+    qoi_anim->img.header.w = anim.width;
+    qoi_anim->img.header.h = anim.height;
+    qoi_anim->img.data = data;
+    qoi_anim->img.data_size = size;
+    qoi_anim->anim = anim;
+    qoi_anim->frame = -1;
+    qoi_anim->next = s_anims;
+    s_anims = qoi_anim;
+
+    *ret_handle = qoi_anim;
+    ESP_LOGD(TAG, "new animation @%p, [%d,%d], frames:%d", qoi_anim, anim.width, anim.height, anim.frames);
+    return ESP_OK;
+}
+
+const lv_img_dsc_t *esp_lv_split_qoi_anim_get_src(esp_lv_sqoi_anim_handle_t handle)
+{
+    qoi_anim_t *qoi_anim = handle;
+    return qoi_anim ? &qoi_anim->img : NULL;
+}
+
+uint16_t esp_lv_split_qoi_anim_get_frames(esp_lv_sqoi_anim_handle_t handle)
+{
+    qoi_anim_t *qoi_anim = handle;
+    return qoi_anim ? qoi_anim->anim.frames : 0;
+}
+
+esp_err_t esp_lv_split_qoi_anim_set_frame(esp_lv_sqoi_anim_handle_t handle, uint16_t frame, lv_obj_t *img)
+{
+    qoi_anim_t *qoi_anim = handle;
+    ESP_RETURN_ON_FALSE(qoi_anim && frame < qoi_anim->anim.frames, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+
+    const int frames = qoi_anim->anim.frames;
+    const int prev = qoi_anim->frame;
+    if (frame == prev) {
+        return ESP_OK;
+    }
+    qoi_anim->frame = frame;
+    if (!img) {
+        return ESP_OK;
+    }
+
+    /*Invalidate the dirty rects of every frame from the one drawn before, or the whole image if there are too many*/
+    const int steps = (frame - prev + frames) % frames;
+    if (prev < 0 || steps > ANIM_MAX_SKIPPED_FRAMES + 1) {
+        lv_obj_invalidate(img);
+        return ESP_OK;
+    }
+
+    lv_area_t coords;
+    lv_obj_get_content_coords(img, &coords);
+    for (int i = 1; i <= steps; i++) {
+        anim_image_frame_t f;
+        if (!anim_image_frame(&qoi_anim->anim, (prev + i) % frames, &f)) {
+            lv_obj_invalidate(img);
+            return ESP_OK;
+        }
+        for (int j = 0; j < f.dirty; j++) {
+            anim_image_rect_t rect = anim_image_dirty(&f, j);
+            lv_area_t area = {
+                .x1 = coords.x1 + rect.x,
+                .y1 = coords.y1 + rect.y,
+                .x2 = coords.x1 + rect.x + rect.w - 1,
+                .y2 = coords.y1 + rect.y + rect.h - 1,
+            };
+            lv_obj_invalidate_area(img, &area);
+        }
+    }
 
+    return ESP_OK;
+}
+
+esp_err_t esp_lv_split_qoi_anim_del(esp_lv_sqoi_anim_handle_t handle)
+{
+    qoi_anim_t *qoi_anim = handle;
+    ESP_RETURN_ON_FALSE(qoi_anim, ESP_ERR_INVALID_ARG, TAG, "invalid animation handle pointer");
+
+    for (qoi_anim_t **p = &s_anims; *p; p = &(*p)->next) {
+        if (*p == qoi_anim) {
+            *p = qoi_anim->next;
+            break;
+        }
+    }
+    lv_img_cache_invalidate_src(&qoi_anim->img);
+    free(qoi_anim);
+
+    return ESP_OK;
 }
 
 /**********************
  *   STATIC FUNCTIONS
  **********************/
 
-lv_res_t qoi_decode32(uint8_t **out, uint32_t *w, uint32_t *h, const uint8_t *in, size_t insize)
+/**
+ * Decode a whole QOI image into `qoi->frame_cache`, growing it only if the image doesn't fit.
+ */
+static lv_res_t qoi_decode_frame(QOI *qoi, const uint8_t *in, size_t insize)
 {
-    if (!in || !out || !w || !h) {
+    if (!in || insize < QOI_HEADER_SIZE) {
+        return LV_RES_INV;
+    }
+
+    const uint32_t w = ((uint32_t)in[4] << 24) | (in[5] << 16) | (in[6] << 8) | in[7];
+    const uint32_t h = ((uint32_t)in[8] << 24) | (in[9] << 16) | (in[10] << 8) | in[11];
+    if (w == 0 || h == 0 || h >= QOI_PIXELS_MAX / w) {
+        return LV_RES_INV;
+    }
+    if (lv_qoi_reserve(qoi, w * h * QOI_FMT_BPP(QOI_LV_FORMAT)) != ESP_OK) {
         return LV_RES_INV;
     }
 
     qoi_desc image;
-    memset(&image, 0, sizeof(image));
+    if (!qoi_decode_into(qoi->frame_cache, qoi->frame_cache_size, in, insize, &image, QOI_LV_FORMAT)) {
+        return LV_RES_INV;
+    }
+    /*Convert the image to the system's color depth*/
+    convert_color_depth(qoi->frame_cache, image.width * image.height);
 
-    unsigned char *pixels = qoi_decode(in, insize, &image, 0);
+    return LV_RES_OK;
+}
 
-    *w = image.width;
-    *h = image.height;
-    *out = pixels;
-    if (*out == NULL) {
+/**
+ * Decode split `split` of animation frame `frame` into `qoi->frame_cache` in the system's color format:
+ * the keyframe split, with the frame's patches of that split drawn over it.
+ */
+static lv_res_t qoi_anim_decode_split(QOI *qoi, int frame, int split)
+{
+    const uint32_t px_size = LV_IMG_PX_SIZE_ALPHA_BYTE;
+    const int split_y = split * qoi->qoi_single_frame_height;
+    uint8_t *patch_row = qoi->frame_cache + qoi->qoi_x_res * qoi->qoi_single_frame_height * QOI_FMT_BPP(QOI_LV_FORMAT);
+
+    anim_image_frame_t anim_frame;
+    if (!anim_image_frame(&qoi->anim, frame, &anim_frame)) {
+        return LV_RES_INV;
+    }
+
+    uint32_t len;
+    const uint8_t *data = split_image_tile(&qoi->anim.key, split, &len);
+    int pos = qoi_decode_init(&qoi->dec, data, len, QOI_LV_FORMAT);
+    if (!pos || qoi->dec.desc.width != (unsigned int)qoi->qoi_x_res ||
+            qoi->dec.desc.height > (unsigned int)qoi->qoi_single_frame_height) {
         return LV_RES_INV;
     }
+    const int rows = qoi->dec.desc.height;
+    if (qoi_decode_rows(&qoi->dec, data + pos, len - pos, qoi->frame_cache, rows) != rows) {
+        return LV_RES_INV;
+    }
+    convert_color_depth(qoi->frame_cache, qoi->qoi_x_res * rows);
+
+    /*Patches are sorted by y and don't cross splits*/
+    for (int i = 0; i < anim_frame.patches; i++) {
+        anim_image_rect_t rect;
+        data = anim_image_patch(&anim_frame, i, &rect, &len);
+        if (rect.y < split_y) {
+            continue;
+        } else if (rect.y >= split_y + rows) {
+            break;
+        }
+
+        qoi_dec_state dec;
+        pos = qoi_decode_init(&dec, data, len, QOI_LV_FORMAT);
+        if (!pos || dec.desc.width != rect.w || dec.desc.height != rect.h || rect.y + rect.h > split_y + rows) {
+            return LV_RES_INV;
+        }
+        for (int row = 0; row < rect.h; row++) {
+            if (qoi_decode_rows(&dec, data + pos, len - pos, patch_row, 1) != 1) {
+                return LV_RES_INV;
+            }
+            pos += dec.consumed;
+            convert_color_depth(patch_row, rect.w);
+            memcpy(qoi->frame_cache + ((rect.y - split_y + row) * qoi->qoi_x_res + rect.x) * px_size, patch_row, rect.w * px_size);
+        }
+    }
+
     return LV_RES_OK;
 }
 
+/**
+ * Find the animation opened by esp_lv_split_qoi_anim_new() whose source is `src`.
+ */
+static const qoi_anim_t *qoi_anim_find(const void *src)
+{
+    for (const qoi_anim_t *qoi_anim = s_anims; qoi_anim; qoi_anim = qoi_anim->next) {
+        if (src == &qoi_anim->img) {
+            return qoi_anim;
+        }
+    }
+    return NULL;
+}
+
 static lv_fs_res_t qoi_load_file(const char *filename, uint8_t **buffer, size_t *size, bool read_head)
 {
     uint32_t len;
@@ -187,16 +427,29 @@ static lv_res_t decoder_info(struct _lv_img_decoder_t *decoder, const void *src,
         const uint32_t data_size = img_dsc->data_size;
         const uint8_t *size = ((uint8_t *)img_dsc->data) + 4;
 
-        if (!strncmp((char *)raw_qoi_data, "_SQOI__", strlen("_SQOI__"))) {
-            raw_qoi_data += 14; //seek to res info ... refer qoi format
+        split_image_t split;
+        anim_image_t qoi_anim;
+        lv_img_cf_t cf;
+
+        if (raw_image_pixels(raw_qoi_data, data_size, &split, &cf)) {
             header->always_zero = 0;
-            header->cf = LV_IMG_CF_RAW_ALPHA;
+            header->cf = cf;
+            header->w = split.width;
+            header->h = split.height;
 
-            header->w = *raw_qoi_data++;
-            header->w |= *raw_qoi_data++ << 8;
+            return lv_ret;
+        } else if (split_image_parse(raw_qoi_data, data_size, "_SQOI__", &s_split_pool, &split)) {
+            header->always_zero = 0;
+            header->cf = LV_IMG_CF_RAW_ALPHA;
+            header->w = split.width;
+            header->h = split.height;
 
-            header->h = *raw_qoi_data++;
-            header->h |= *raw_qoi_data++ << 8;
+            return lv_ret;
+        } else if (anim_image_parse(raw_qoi_data, data_size, &qoi_anim)) {
+            header->always_zero = 0;
+            header->cf = LV_IMG_CF_RAW_ALPHA;
+            header->w = qoi_anim.width;
+            header->h = qoi_anim.height;
 
             return lv_ret;
         } else if (is_qoi(raw_qoi_data, data_size) == true) {
@@ -264,92 +517,79 @@ static lv_res_t decoder_open(lv_img_decoder_t *decoder, lv_img_decoder_dsc_t *ds
     (void) decoder; /*Unused*/
     lv_res_t lv_ret = LV_RES_OK;        /*For the return values of PNG decoder functions*/
 
-    uint8_t *img_data = NULL;
-
     if (dsc->src_type == LV_IMG_SRC_VARIABLE) {
 
         const lv_img_dsc_t *img_dsc = dsc->src;
-        uint32_t png_width;             /*No used, just required by he decoder*/
-        uint32_t png_height;            /*No used, just required by he decoder*/
 
-        uint8_t *data;
+        /*Raw images are drawn straight from their source, e.g. mmap'd flash*/
+        split_image_t split;
+        lv_img_cf_t cf;
+        const uint8_t *pixels = raw_image_pixels(img_dsc->data, img_dsc->data_size, &split, &cf);
+        if (pixels) {
+            dsc->img_data = pixels;
+            return LV_RES_OK;
+        }
+
         QOI *qoi = (QOI *) dsc->user_data;
         const uint32_t raw_qoi_data_size = ((lv_img_dsc_t *)dsc->src)->data_size;
         if (qoi == NULL) {
-            qoi =  malloc(sizeof(QOI));
+            qoi = lv_qoi_alloc();
             if (!qoi) {
                 return LV_RES_INV;
             }
 
-            memset(qoi, 0, sizeof(QOI));
-
             dsc->user_data = qoi;
             qoi->qoi_data = (uint8_t *)((lv_img_dsc_t *)(dsc->src))->data;
             qoi->qoi_data_size = ((lv_img_dsc_t *)(dsc->src))->data_size;
         }
 
-        if (!strncmp((char *) qoi->qoi_data, "_SQOI__", strlen("_SQOI__"))) {
-            data = qoi->qoi_data;
-            data += 14;
-
-            qoi->qoi_x_res = *data++;
-            qoi->qoi_x_res |= *data++ << 8;
-
-            qoi->qoi_y_res = *data++;
-            qoi->qoi_y_res |= *data++ << 8;
-
-            qoi->qoi_total_frames = *data++;
-            qoi->qoi_total_frames |= *data++ << 8;
-
-            qoi->qoi_single_frame_height = *data++;
-            qoi->qoi_single_frame_height |= *data++ << 8;
+        if (split_image_parse(qoi->qoi_data, qoi->qoi_data_size, "_SQOI__", &s_split_pool, &qoi->split)) {
+            qoi->qoi_x_res = qoi->split.width;
+            qoi->qoi_y_res = qoi->split.height;
+            qoi->qoi_total_frames = qoi->split.splits;
+            qoi->qoi_single_frame_height = qoi->split.split_height;
 
             ESP_LOGD(TAG, "[%d,%d], frames:%d, height:%d", qoi->qoi_x_res, qoi->qoi_y_res, \
                      qoi->qoi_total_frames, qoi->qoi_single_frame_height);
-            qoi->frame_base_array = malloc(sizeof(uint8_t *) * qoi->qoi_total_frames);
-            if (! qoi->frame_base_array) {
-                ESP_LOGE(TAG, "Not enough memory for frame_base_array allocation");
+            const uint32_t frame_cache_size = qoi->qoi_x_res * qoi->qoi_single_frame_height * QOI_FMT_BPP(QOI_LV_FORMAT);
+            if (lv_qoi_reserve(qoi, frame_cache_size) != ESP_OK) {
                 lv_qoi_cleanup(qoi);
-                qoi = NULL;
+                dsc->user_data = NULL;
                 return LV_RES_INV;
             }
-
-            uint8_t *img_frame_base = data +  qoi->qoi_total_frames * 2;
-            qoi->frame_base_array[0] = img_frame_base;
-
-            for (int i = 1; i <  qoi->qoi_total_frames; i++) {
-                int offset = *data++;
-                offset |= *data++ << 8;
-                qoi->frame_base_array[i] = qoi->frame_base_array[i - 1] + offset;
-            }
             qoi->qoi_cache_frame_index = -1;
-            qoi->frame_cache = (void *)malloc(qoi->qoi_x_res * qoi->qoi_single_frame_height * 4);
-            if (! qoi->frame_cache) {
-                ESP_LOGE(TAG, "Not enough memory for frame_cache allocation");
+            dsc->img_data = NULL;
+
+            return lv_ret;
+        } else if (anim_image_parse(qoi->qoi_data, qoi->qoi_data_size, &qoi->anim)) {
+            qoi->qoi_x_res = qoi->anim.width;
+            qoi->qoi_y_res = qoi->anim.height;
+            qoi->qoi_total_frames = qoi->anim.key.splits;
+            qoi->qoi_single_frame_height = qoi->anim.split_height;
+            qoi->anim_src = qoi_anim_find(dsc->src);
+
+            /*A split, followed by one patch row in the format qoi.h decodes to*/
+            const uint32_t bpp = QOI_FMT_BPP(QOI_LV_FORMAT);
+            const uint32_t frame_cache_size = qoi->qoi_x_res * (qoi->qoi_single_frame_height + 1) * bpp;
+            if (lv_qoi_reserve(qoi, frame_cache_size) != ESP_OK) {
                 lv_qoi_cleanup(qoi);
-                qoi = NULL;
+                dsc->user_data = NULL;
                 return LV_RES_INV;
             }
+            qoi->qoi_cache_frame_index = -1;
             dsc->img_data = NULL;
 
             return lv_ret;
         } else if (is_qoi(qoi->qoi_data, raw_qoi_data_size) == true) {
-            /*Decode the image in ARGB8888 */
-            lv_ret = qoi_decode32(&img_data, &png_width, &png_height, img_dsc->data, img_dsc->data_size);
+            /*Decode the image in the system's color format*/
+            lv_ret = qoi_decode_frame(qoi, img_dsc->data, img_dsc->data_size);
             if (lv_ret != LV_RES_OK) {
-                ESP_LOGE(TAG, "Decode (qoi_decode32) error:%d", lv_ret);
-                if (img_data != NULL) {
-                    free(img_data);
-                }
+                ESP_LOGE(TAG, "Decode (qoi_decode_frame) error:%d", lv_ret);
                 lv_qoi_cleanup(qoi);
-                qoi = NULL;
+                dsc->user_data = NULL;
                 return LV_RES_INV;
-            } else {
-                /*Convert the image to the system's color depth*/
-                convert_color_depth(img_data,  png_width * png_height);
-                dsc->img_data = img_data;
-                qoi->frame_cache = img_data;
             }
+            dsc->img_data = qoi->frame_cache;
             return lv_ret;
         } else {
             return LV_RES_INV;
@@ -357,8 +597,6 @@ static lv_res_t decoder_open(lv_img_decoder_t *decoder, lv_img_decoder_dsc_t *ds
         return LV_RES_OK;     /*Return with its pointer*/
     } else if (dsc->src_type == LV_IMG_SRC_FILE) {
         const char *fn = dsc->src;
-        uint32_t png_width;
-        uint32_t png_height;
 
         if (strcmp(lv_fs_get_ext(fn), "qoi") == 0) {
             uint8_t *qoi_data;      /*Pointer to the loaded data. Same as the original file just loaded into the RAM*/
@@ -366,40 +604,33 @@ static lv_res_t decoder_open(lv_img_decoder_t *decoder, lv_img_decoder_dsc_t *ds
 
             QOI *qoi = (QOI *) dsc->user_data;
             if (qoi == NULL) {
-                qoi = malloc(sizeof(QOI));
+                qoi = lv_qoi_alloc();
                 if (!qoi) {
                     ESP_LOGE(TAG, "Failed to allocate memory for qoi");
                     return LV_RES_INV;
                 }
 
-                memset(qoi, 0, sizeof(QOI));
                 dsc->user_data = qoi;
             }
 
             if (qoi_load_file(fn, &qoi_data, &qoi_data_size, false) != LV_FS_RES_OK) {
                 if (qoi_data) {
                     free(qoi_data);
-                    lv_qoi_cleanup(qoi);
                 }
+                lv_qoi_cleanup(qoi);
+                dsc->user_data = NULL;
                 return LV_RES_INV;
             }
 
-            lv_ret = qoi_decode32(&img_data, &png_width, &png_height, qoi_data, qoi_data_size);
+            lv_ret = qoi_decode_frame(qoi, qoi_data, qoi_data_size);
             free(qoi_data);
             if (lv_ret != LV_RES_OK) {
-                ESP_LOGE(TAG, "Decode (qoi_decode32) error:%d", lv_ret);
-                if (img_data != NULL) {
-                    free(img_data);
-                }
+                ESP_LOGE(TAG, "Decode (qoi_decode_frame) error:%d", lv_ret);
                 lv_qoi_cleanup(qoi);
-                qoi = NULL;
+                dsc->user_data = NULL;
                 return LV_RES_INV;
-            } else {
-                /*Convert the image to the system's color depth*/
-                convert_color_depth(img_data,  png_width * png_height);
-                dsc->img_data = img_data;
-                qoi->frame_cache = img_data;
             }
+            dsc->img_data = qoi->frame_cache;
             return lv_ret;
         } else {
             return LV_RES_INV;
@@ -426,9 +657,6 @@ static lv_res_t decoder_read_line(lv_img_decoder_t *decoder, lv_img_decoder_dsc_
 {
     LV_UNUSED(decoder);
 
-    lv_res_t error;
-    uint8_t *img_data = NULL;
-
     if (dsc->src_type == LV_IMG_SRC_FILE) {
         ESP_LOGW(TAG, "Unsupported file format");
         return LV_RES_INV;
@@ -447,38 +675,58 @@ static lv_res_t decoder_read_line(lv_img_decoder_t *decoder, lv_img_decoder_dsc_
 #endif
 
         int qoi_req_frame_index = y / qoi->qoi_single_frame_height;
-
-        /*If line not from cache, refresh cache */
-        if (qoi_req_frame_index != qoi->qoi_cache_frame_index) {
-            qoi->io.raw_qoi_data = qoi->frame_base_array[ qoi_req_frame_index ];
-            if (qoi_req_frame_index == (qoi->qoi_total_frames - 1)) {
-                /*This is the last frame. */
-                const uint32_t frame_offset = (uint32_t)(qoi->io.raw_qoi_data - qoi->qoi_data);
-                qoi->io.raw_qoi_data_size = qoi->qoi_data_size - frame_offset;
-            } else {
-                qoi->io.raw_qoi_data_size =
-                    (uint32_t)(qoi->frame_base_array[qoi_req_frame_index + 1] - qoi->io.raw_qoi_data);
+        int qoi_req_row = y % qoi->qoi_single_frame_height;
+
+        if (qoi->anim.frames) {
+            int anim_frame = qoi->anim_src && qoi->anim_src->frame > 0 ? qoi->anim_src->frame : 0;
+            if (qoi_req_frame_index != qoi->qoi_cache_frame_index || anim_frame != qoi->anim_cache_frame) {
+                if (qoi_anim_decode_split(qoi, anim_frame, qoi_req_frame_index) != LV_RES_OK) {
+                    ESP_LOGE(TAG, "Decode (qoi_anim_decode_split) error, frame:%d, split:%d", anim_frame, qoi_req_frame_index);
+                    qoi->qoi_cache_frame_index = -1;
+                    return LV_RES_INV;
+                }
+                qoi->qoi_cache_frame_index = qoi_req_frame_index;
+                qoi->anim_cache_frame = anim_frame;
             }
 
-            uint32_t png_width;             /*No used, just required by he decoder*/
-            uint32_t png_height;            /*No used, just required by he decoder*/
+            memcpy(buf, qoi->frame_cache + (qoi_req_row * qoi->qoi_x_res + x) * color_depth, color_depth * len);
+            return LV_RES_OK;
+        }
 
-            /*Decode the image in ARGB8888 */
-            error = qoi_decode32(&img_data, &png_width, &png_height, qoi->io.raw_qoi_data, qoi->io.raw_qoi_data_size);
-            if (error != LV_RES_OK) {
-                ESP_LOGE(TAG, "Decode (qoi_decode32) error:%d", error);
-                if (img_data != NULL) {
-                    free(img_data);
-                }
+        /*If line not from cache, seek to the closest snapshot of the frame's seek table (or its first row)*/
+        if (qoi_req_frame_index != qoi->qoi_cache_frame_index || qoi_req_row < qoi->qoi_cache_row_first) {
+            qoi->io.raw_qoi_data = (uint8_t *)split_image_tile(&qoi->split, qoi_req_frame_index, &qoi->io.raw_qoi_data_size);
+
+            qoi->dec_pos = qoi_decode_seek(&qoi->dec, qoi->io.raw_qoi_data, qoi->io.raw_qoi_data_size, QOI_LV_FORMAT, qoi_req_row);
+            if (!qoi->dec_pos || qoi->dec.desc.width != (unsigned int)qoi->qoi_x_res ||
+                    qoi->dec.desc.height > (unsigned int)qoi->qoi_single_frame_height) {
+                ESP_LOGE(TAG, "Decode (qoi_decode_seek) error, frame:%d", qoi_req_frame_index);
+                qoi->qoi_cache_frame_index = -1;
                 return LV_RES_INV;
-            } else {
-                convert_color_depth(img_data,  png_width * png_height);
-                memcpy(qoi->frame_cache, img_data, qoi->qoi_single_frame_height * qoi->qoi_x_res * color_depth);
-                if (img_data != NULL) {
-                    free(img_data);
-                }
             }
             qoi->qoi_cache_frame_index = qoi_req_frame_index;
+            qoi->qoi_cache_row_first = qoi->dec.y;
+        } else if (qoi_req_row > (int)qoi->dec.y) {
+            /*Skip ahead if a snapshot is closer than the rows decoded so far*/
+            qoi_dec_state seek;
+            uint32_t pos = qoi_decode_seek(&seek, qoi->io.raw_qoi_data, qoi->io.raw_qoi_data_size, QOI_LV_FORMAT, qoi_req_row);
+            if (pos && seek.y > qoi->dec.y) {
+                qoi->dec = seek;
+                qoi->dec_pos = pos;
+                qoi->qoi_cache_row_first = seek.y;
+            }
+        }
+
+        /*Decode the rows up to the requested one straight into the cache in the system's color format*/
+        while ((int)qoi->dec.y <= qoi_req_row) {
+            uint8_t *row = qoi->frame_cache + qoi->dec.y * qoi->qoi_x_res * color_depth;
+            if (qoi_decode_rows(&qoi->dec, qoi->io.raw_qoi_data + qoi->dec_pos, qoi->io.raw_qoi_data_size - qoi->dec_pos, row, 1) != 1) {
+                ESP_LOGE(TAG, "Decode (qoi_decode_rows) error, frame:%d", qoi_req_frame_index);
+                qoi->qoi_cache_frame_index = -1;
+                return LV_RES_INV;
+            }
+            qoi->dec_pos += qoi->dec.consumed;
+            convert_color_depth(row, qoi->qoi_x_res);
         }
 
         uint8_t *cache = (uint8_t *)qoi->frame_cache + x * color_depth + (y % qoi->qoi_single_frame_height) * qoi->qoi_x_res * color_depth;
@@ -513,33 +761,14 @@ static void decoder_close(lv_img_decoder_t *decoder, lv_img_decoder_dsc_t *dsc)
 }
 
 /**
- * If the display is not in 32 bit format (ARGB888) then convert the image to the current color depth
- * @param img the ARGB888 image
+ * 32 and 16 bit color depths are decoded directly by qoi.h (see QOI_LV_FORMAT).
+ * For the remaining color depths convert the RGBA8888 image to the current color depth.
+ * @param img the RGBA8888 image
  * @param px_cnt number of pixels in `img`
  */
 static void convert_color_depth(uint8_t *img, uint32_t px_cnt)
 {
-#if LV_COLOR_DEPTH == 32
-    lv_color32_t *img_argb = (lv_color32_t *)img;
-    lv_color_t c;
-    lv_color_t *img_c = (lv_color_t *) img;
-    uint32_t i;
-    for (i = 0; i < px_cnt; i++) {
-        c = lv_color_make(img_argb[i].ch.red, img_argb[i].ch.green, img_argb[i].ch.blue);
-        img_c[i].ch.red = c.ch.blue;
-        img_c[i].ch.blue = c.ch.red;
-    }
-#elif LV_COLOR_DEPTH == 16
-    lv_color32_t *img_argb = (lv_color32_t *)img;
-    lv_color_t c;
-    uint32_t i;
-    for (i = 0; i < px_cnt; i++) {
-        c = lv_color_make(img_argb[i].ch.blue, img_argb[i].ch.green, img_argb[i].ch.red);
-        img[i * 3 + 2] = img_argb[i].ch.alpha;
-        img[i * 3 + 1] = c.full >> 8;
-        img[i * 3 + 0] = c.full & 0xFF;
-    }
-#elif LV_COLOR_DEPTH == 8
+#if LV_COLOR_DEPTH == 8
     lv_color32_t *img_argb = (lv_color32_t *)img;
     lv_color_t c;
     uint32_t i;
@@ -569,14 +798,85 @@ static int is_qoi(const uint8_t *raw_data, size_t len)
     return memcmp(magic, raw_data, sizeof(magic)) == 0;
 }
 
+/**
+ * Find the pixels of a "_SRAW__" image stored in the LVGL color format.
+ * @param raw_data the image
+ * @param len num bytes in raw_data
+ * @param split filled with the parsed header
+ * @param cf set to LV_IMG_CF_TRUE_COLOR or LV_IMG_CF_TRUE_COLOR_ALPHA
+ * @return pointer to the pixels, or NULL if raw_data isn't a raw image LVGL can draw as it is
+ */
+static const uint8_t *raw_image_pixels(const uint8_t *raw_data, size_t len, split_image_t *split, lv_img_cf_t *cf)
+{
+    if (!split_image_parse(raw_data, len, "_SRAW__", &s_split_pool, split) ||
+            split->format != SPLIT_IMAGE_FORMAT_RAW || split->splits != 1) {
+        return NULL;
+    }
+
+    uint32_t bpp;
+    if (split->pixel_format == RAW_LV_FORMAT && RAW_LV_FORMAT != SPLIT_IMAGE_PIXEL_UNKNOWN) {
+        *cf = LV_IMG_CF_TRUE_COLOR;
+        bpp = LV_COLOR_SIZE / 8;
+    } else if (split->pixel_format == RAW_LV_FORMAT_ALPHA && RAW_LV_FORMAT_ALPHA != SPLIT_IMAGE_PIXEL_UNKNOWN) {
+        *cf = LV_IMG_CF_TRUE_COLOR_ALPHA;
+        bpp = LV_IMG_PX_SIZE_ALPHA_BYTE;
+    } else {
+        ESP_LOGE(TAG, "raw image pixel format 0x%02x doesn't match LV_COLOR_DEPTH/LV_COLOR_16_SWAP", split->pixel_format);
+        return NULL;
+    }
+
+    uint32_t pixels_len;
+    const uint8_t *pixels = split_image_tile(split, 0, &pixels_len);
+    if (pixels_len != (uint32_t)split->width * split->height * bpp) {
+        return NULL;
+    }
+    return pixels;
+}
+
+/**
+ * Get a QOI context, reusing the one released by the last decoder_close() together with its buffers.
+ * With LV_IMG_CACHE_DEF_SIZE == 0 every image is reopened on each refresh, so this keeps
+ * steady-state playback free of heap calls.
+ */
+static QOI *lv_qoi_alloc(void)
+{
+    QOI *qoi = s_qoi_spare;
+    if (!qoi) {
+        return calloc(1, sizeof(QOI));
+    }
+    s_qoi_spare = NULL;
+
+    uint8_t *frame_cache = qoi->frame_cache;
+    uint32_t frame_cache_size = qoi->frame_cache_size;
+
+    memset(qoi, 0, sizeof(QOI));
+    qoi->frame_cache = frame_cache;
+    qoi->frame_cache_size = frame_cache_size;
+    return qoi;
+}
+
+/**
+ * Make sure frame_cache holds `cache_size` bytes.
+ * The buffer is only reallocated when it is too small.
+ */
+static esp_err_t lv_qoi_reserve(QOI *qoi, uint32_t cache_size)
+{
+    if (cache_size > qoi->frame_cache_size) {
+        free(qoi->frame_cache);
+        qoi->frame_cache_size = 0;
+        qoi->frame_cache = malloc(cache_size);
+        ESP_RETURN_ON_FALSE(qoi->frame_cache, ESP_ERR_NO_MEM, TAG, "Not enough memory for frame_cache allocation");
+        qoi->frame_cache_size = cache_size;
+    }
+
+    return ESP_OK;
+}
+
 static void lv_qoi_free(QOI *qoi)
 {
     if (qoi->frame_cache) {
         free(qoi->frame_cache);
     }
-    if (qoi->frame_base_array) {
-        free(qoi->frame_base_array);
-    }
 }
 
 static void lv_qoi_cleanup(QOI *qoi)
@@ -585,6 +885,15 @@ static void lv_qoi_cleanup(QOI *qoi)
         return;
     }
 
-    lv_qoi_free(qoi);
-    free(qoi);
+    /*Keep the context with the larger frame cache for the next decoder_open()*/
+    if (s_qoi_spare && s_qoi_spare->frame_cache_size > qoi->frame_cache_size) {
+        lv_qoi_free(qoi);
+        free(qoi);
+        return;
+    }
+    if (s_qoi_spare) {
+        lv_qoi_free(s_qoi_spare);
+        free(s_qoi_spare);
+    }
+    s_qoi_spare = qoi;
 }
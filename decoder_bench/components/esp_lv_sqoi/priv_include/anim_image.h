@@ -0,0 +1,207 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Parser for the animation containers ("_AQOI__") written by spiffs_assets_gen.py.
+ *
+ *   magic "_AQOI__" (7 bytes) | version "\0V1.00\0" (7 bytes)
+ *   width | height | frames | split height     (2 bytes each, little endian)
+ *   format (1 byte) | pixel format (1 byte) | reserved (4 bytes)
+ *   offset of the keyframe, of each frame and of the end (4 bytes each, little endian)
+ *   keyframe: a V2 or V3 "_SQOI__" split image of the first frame
+ *   frames, back to back
+ *
+ * Frame:
+ *   dirty rects | patches                      (2 bytes each, little endian)
+ *   x | y | w | h of each dirty rect           (2 bytes each, little endian)
+ *   x | y | w | h of each patch                (2 bytes each, little endian)
+ *     | offset from the frame | length         (4 bytes each, little endian)
+ *   patches, QOI images
+ *
+ * Dirty rects cover the pixels that differ from the previous frame (the last
+ * one for the first frame), which is all a player has to redraw. Patches cover
+ * the pixels that differ from the keyframe, sorted by y and never crossing a
+ * split, so every split of every frame is the keyframe split with the frame's
+ * patches of that split drawn over it.
+ *
+ * It only depends on the C library, so it can be built and fuzzed on the host.
+ */
+
+#pragma once
+
+#include "split_image.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ANIM_IMAGE_HEADER_SIZE      28
+#define ANIM_IMAGE_RECT_SIZE        8
+#define ANIM_IMAGE_PATCH_SIZE       16
+
+/**
+ * @brief Rectangle in image coordinates
+ */
+typedef struct {
+    uint16_t x;
+    uint16_t y;
+    uint16_t w;
+    uint16_t h;
+} anim_image_rect_t;
+
+/**
+ * @brief Parsed animation header
+ */
+typedef struct {
+    uint16_t width;                 /*!< Image width */
+    uint16_t height;                /*!< Image height */
+    uint16_t frames;                /*!< Number of frames */
+    uint16_t split_height;          /*!< Split height of the keyframe, patches stay within a split */
+    const uint8_t *base;            /*!< Start of the container */
+    const uint8_t *table;           /*!< 4 byte offsets of the keyframe, of each frame and of the end */
+    split_image_t key;              /*!< Keyframe */
+} anim_image_t;
+
+/**
+ * @brief Parsed frame
+ */
+typedef struct {
+    uint16_t dirty;                 /*!< Number of dirty rects */
+    uint16_t patches;               /*!< Number of patches */
+    const uint8_t *base;            /*!< Start of the frame, followed by the rects */
+    uint32_t size;                  /*!< Num bytes in the frame */
+} anim_image_frame_t;
+
+static inline anim_image_rect_t anim_image_read_rect(const uint8_t *p)
+{
+    anim_image_rect_t rect = {
+        .x = split_image_read_16(p),
+        .y = split_image_read_16(p + 2),
+        .w = split_image_read_16(p + 4),
+        .h = split_image_read_16(p + 6),
+    };
+    return rect;
+}
+
+static inline bool anim_image_rect_valid(const anim_image_t *anim, anim_image_rect_t rect)
+{
+    return rect.w && rect.h && rect.x + rect.w <= anim->width && rect.y + rect.h <= anim->height;
+}
+
+/**
+ * @brief Get dirty rect `index` of a frame
+ */
+static inline anim_image_rect_t anim_image_dirty(const anim_image_frame_t *frame, int index)
+{
+    return anim_image_read_rect(frame->base + 4 + index * ANIM_IMAGE_RECT_SIZE);
+}
+
+/**
+ * @brief Find patch `index` of a frame
+ *
+ * @param frame Parsed frame
+ * @param index Patch index, below frame->patches
+ * @param rect Set to the area of the image the patch covers
+ * @param len Set to the length of the patch in bytes
+ * @return Pointer to the QOI image of the patch
+ */
+static inline const uint8_t *anim_image_patch(const anim_image_frame_t *frame, int index, anim_image_rect_t *rect, uint32_t *len)
+{
+    const uint8_t *entry = frame->base + 4 + frame->dirty * ANIM_IMAGE_RECT_SIZE + index * ANIM_IMAGE_PATCH_SIZE;
+    *rect = anim_image_read_rect(entry);
+    *len = split_image_read_32(entry + 12);
+    return frame->base + split_image_read_32(entry + 8);
+}
+
+/**
+ * @brief Parse and check frame `index`
+ *
+ * The rects and patches are checked against the image and the frame size, so
+ * anim_image_dirty() and anim_image_patch() only return data inside the frame.
+ *
+ * @param anim Parsed animation
+ * @param index Frame index, below anim->frames
+ * @param frame Filled with the parsed frame on success
+ * @return true if the frame is valid
+ */
+static inline bool anim_image_frame(const anim_image_t *anim, int index, anim_image_frame_t *frame)
+{
+    uint32_t start = split_image_read_32(anim->table + (index + 1) * 4);
+    frame->base = anim->base + start;
+    frame->size = split_image_read_32(anim->table + (index + 2) * 4) - start;
+    if (frame->size < 4) {
+        return false;
+    }
+    frame->dirty = split_image_read_16(frame->base);
+    frame->patches = split_image_read_16(frame->base + 2);
+
+    uint32_t table_end = 4 + (uint32_t)frame->dirty * ANIM_IMAGE_RECT_SIZE + (uint32_t)frame->patches * ANIM_IMAGE_PATCH_SIZE;
+    if (table_end > frame->size) {
+        return false;
+    }
+    for (int i = 0; i < frame->dirty; i++) {
+        if (!anim_image_rect_valid(anim, anim_image_dirty(frame, i))) {
+            return false;
+        }
+    }
+    for (int i = 0; i < frame->patches; i++) {
+        anim_image_rect_t rect;
+        uint32_t len;
+        uint32_t offset = anim_image_patch(frame, i, &rect, &len) - frame->base;
+        if (!anim_image_rect_valid(anim, rect) || rect.y / anim->split_height != (rect.y + rect.h - 1) / anim->split_height ||
+                offset < table_end || offset > frame->size || len > frame->size - offset) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Parse and check the header of an animation
+ *
+ * Frames are only checked by anim_image_frame(). Nothing is allocated, the
+ * result points into `buf`.
+ *
+ * @param buf Animation
+ * @param size Num bytes in buf
+ * @param anim Filled with the parsed header on success
+ * @return true if buf holds a valid animation header and keyframe
+ */
+static inline bool anim_image_parse(const uint8_t *buf, size_t size, anim_image_t *anim)
+{
+    if (!buf || size < ANIM_IMAGE_HEADER_SIZE || memcmp(buf, "_AQOI__\0V1.00\0", 14) != 0) {
+        return false;
+    }
+
+    anim->width = split_image_read_16(buf + 14);
+    anim->height = split_image_read_16(buf + 16);
+    anim->frames = split_image_read_16(buf + 18);
+    anim->split_height = split_image_read_16(buf + 20);
+    anim->base = buf;
+    anim->table = buf + ANIM_IMAGE_HEADER_SIZE;
+    size_t table_size = ((size_t)anim->frames + 2) * 4;
+    if (!anim->frames || buf[22] != SPLIT_IMAGE_FORMAT_QOI || size - ANIM_IMAGE_HEADER_SIZE < table_size) {
+        return false;
+    }
+
+    /* Offsets have to be ascending and inside buf */
+    uint32_t prev = ANIM_IMAGE_HEADER_SIZE + table_size;
+    for (int i = 0; i < anim->frames + 2; i++) {
+        uint32_t offset = split_image_read_32(anim->table + i * 4);
+        if (offset < prev || offset > size) {
+            return false;
+        }
+        prev = offset;
+    }
+
+    uint32_t key = split_image_read_32(anim->table);
+    return split_image_parse(buf + key, split_image_read_32(anim->table + 4) - key, "_SQOI__", NULL, &anim->key) &&
+           anim->key.width == anim->width && anim->key.height == anim->height && anim->key.split_height == anim->split_height;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -36,6 +36,24 @@ qoi_write("image_new.qoi", rgba_pixels, &(qoi_desc){
 qoi_desc desc;
 void *rgba_pixels = qoi_read("image.qoi", &desc, 4);
 
+// Decode a QOI image row by row into a single row buffer. The compressed data
+// may be handed in as one block or in arbitrary chunks.
+qoi_dec_state dec;
+int p = qoi_decode_init(&dec, qoi_bytes, qoi_size, 4);
+unsigned char *row = malloc(dec.desc.width * 4);
+while (p && dec.y < dec.desc.height) {
+    qoi_decode_rows(&dec, qoi_bytes + p, qoi_size - p, row, 1);
+    p += dec.consumed;
+    // ... consume row
+}
+
+// Append a seek table with a decoder snapshot every 16 rows to an encoded
+// image, then start decoding at row 100 (the decoder resumes at row 96).
+int table_len;
+void *table = qoi_seek_build(qoi_bytes, qoi_size, 16, &table_len);
+// ... write qoi_bytes followed by table, later load both into seek_bytes
+p = qoi_decode_seek(&dec, seek_bytes, seek_size, 4, 100);
+
 
 
 -- Documentation
@@ -43,8 +61,14 @@ void *rgba_pixels = qoi_read("image.qoi", &desc, 4);
 This library provides the following functions;
 - qoi_read    -- read and decode a QOI file
 - qoi_decode  -- decode the raw bytes of a QOI image from memory
+- qoi_decode_into -- decode the raw bytes of a QOI image into a given buffer
 - qoi_write   -- encode and write a QOI file
 - qoi_encode  -- encode an rgba buffer into a QOI image in memory
+- qoi_encode_ex -- encode with a given effort level, for smaller images
+- qoi_decode_init -- start decoding a QOI image incrementally
+- qoi_decode_rows -- decode the next rows of an incrementally decoded image
+- qoi_seek_build  -- build a seek table to append to a QOI image
+- qoi_decode_seek -- start decoding a QOI image incrementally at a given row
 
 See the function declaration below for the signature and more information.
 
@@ -232,6 +256,27 @@ how chunks are en-/decoded. */
 #define QOI_SRGB   0
 #define QOI_LINEAR 1
 
+/* Besides 3 (RGB) and 4 (RGBA), the decoding functions accept the following
+pixel formats for their channels argument. The pixels are written in the given
+format directly, without an intermediate RGBA buffer. QOI_FMT_BPP() returns
+the number of bytes per pixel for any accepted value other than 0.
+
+QOI_FMT_RGB565        -- 16 bit, little endian (r5 g6 b5 from msb to lsb)
+QOI_FMT_RGB565_SWAP   -- 16 bit, big endian
+QOI_FMT_RGB565A8      -- 16 bit little endian, followed by an 8 bit alpha
+QOI_FMT_RGB565A8_SWAP -- 16 bit big endian, followed by an 8 bit alpha
+QOI_FMT_ARGB8888      -- 32 bit little endian, i.e. the bytes b, g, r, a
+
+The RGB565 values are truncated, not rounded. */
+
+#define QOI_FMT_RGB565        0x12
+#define QOI_FMT_RGB565_SWAP   0x22
+#define QOI_FMT_RGB565A8      0x13
+#define QOI_FMT_RGB565A8_SWAP 0x23
+#define QOI_FMT_ARGB8888      0x14
+
+#define QOI_FMT_BPP(F) ((F) & 0x0f)
+
 typedef struct {
     unsigned int width;
     unsigned int height;
@@ -239,6 +284,34 @@ typedef struct {
     unsigned char colorspace;
 } qoi_desc;
 
+typedef union {
+    struct {
+        unsigned char r, g, b, a;
+    } rgba;
+    unsigned int v;
+} qoi_rgba_t;
+
+/* The running state of an incremental decoder. It holds everything needed to
+resume decoding at an arbitrary pixel: the index of previously seen pixels, the
+previous pixel, the remainder of a pending QOI_OP_RUN and the position of the
+next pixel. The compressed data itself is not part of the state; it is handed
+to qoi_decode_rows() chunk by chunk.
+
+desc is filled from the file header by qoi_decode_init(). y is the number of
+completed rows and consumed the number of bytes qoi_decode_rows() used from the
+last chunk. All other members are private. */
+
+typedef struct {
+    qoi_desc desc;
+    qoi_rgba_t index[64];
+    qoi_rgba_t px;
+    int run;
+    int channels;
+    unsigned int x;
+    unsigned int y;
+    int consumed;
+} qoi_dec_state;
+
 #ifndef QOI_NO_STDIO
 
 /* Encode raw RGB or RGBA pixels into a QOI image and write it to the file
@@ -274,7 +347,34 @@ The returned qoi data should be free()d after use. */
 
 void *qoi_encode(const void *data, const qoi_desc *desc, int *out_len);
 
-/* Decode a QOI image from memory.
+
+/* Encoder effort levels for qoi_encode_ex(). The QOI decoder state after each
+pixel doesn't depend on the ops chosen to encode it, so qoi_encode() already
+picks the shortest ops. Higher levels instead change pixel data that won't be
+visible on the target, which makes for longer runs and more index hits. The
+output is always a plain QOI image.
+
+QOI_EFFORT_FAST   -- same as qoi_encode(); decoding is bit-exact.
+QOI_EFFORT_ALPHA  -- fully transparent pixels are encoded as transparent
+                     black, which continues runs and hits the index instead
+                     of needing a QOI_OP_RGBA. Only pixels with alpha 0 decode
+                     differently.
+QOI_EFFORT_RGB565 -- additionally rounds colors to RGB565 precision. Decoding
+                     to one of the QOI_FMT_RGB565* formats gives the same
+                     pixels as for the original image, except alpha 0 ones. */
+
+#define QOI_EFFORT_FAST   0
+#define QOI_EFFORT_ALPHA  1
+#define QOI_EFFORT_RGB565 2
+
+/* Same as qoi_encode(), with one of the QOI_EFFORT_* levels above. Returns NULL
+for an invalid effort level. */
+
+void *qoi_encode_ex(const void *data, const qoi_desc *desc, int *out_len, int effort);
+
+/* Decode a QOI image from memory. If channels is 0, the number of channels
+from the file header is used. Otherwise the output is forced into 3 (RGB), 4
+(RGBA) channels or one of the QOI_FMT_* pixel formats.
 
 The function either returns NULL on failure (invalid parameters or malloc
 failed) or a pointer to the decoded pixels. On success, the qoi_desc struct
@@ -284,6 +384,94 @@ The returned pixel data should be free()d after use. */
 
 void *qoi_decode(const void *data, int size, qoi_desc *desc, int channels);
 
+
+/* Decode a QOI image from memory into the caller supplied buffer dst of
+dst_size bytes. No memory is allocated. channels has the same meaning as for
+qoi_decode().
+
+The function either returns 0 on failure (invalid parameters or header, or
+dst_size is smaller than width * height * QOI_FMT_BPP(channels)) or the number
+of bytes written to dst. The qoi_desc struct is filled with the description
+from the file header whenever the header is valid, so on failure it can be
+used to size a buffer for another attempt. */
+
+int qoi_decode_into(void *dst, int dst_size, const void *data, int size, qoi_desc *desc, int channels);
+
+
+/* Start decoding a QOI image incrementally. data must hold at least the 14 byte
+file header. channels has the same meaning as for qoi_decode(), i.e. it may
+also be one of the QOI_FMT_* pixel formats. No memory is
+allocated; the state is entirely held in the caller supplied qoi_dec_state.
+
+The function either returns 0 on failure (invalid parameters or header) or the
+number of header bytes read. On success, state->desc is filled with the
+description from the file header. */
+
+int qoi_decode_init(qoi_dec_state *state, const void *data, int size, int channels);
+
+
+/* Decode up to n_rows rows from a chunk of the compressed stream that follows
+the header. out_rows must have room for n_rows * width * QOI_FMT_BPP(channels)
+bytes.
+
+Decoding stops when n_rows rows are complete, when the image is complete or
+when the chunk is exhausted. An op that is cut off at the end of the chunk is
+not consumed; state->consumed is set to the number of bytes used and the unused
+tail has to be passed again at the start of the next chunk. If the chunk ends
+in the middle of a row, the pixels decoded so far are left at the start of
+out_rows and the next call has to continue with out_rows pointing to the same
+row.
+
+The function either returns -1 on failure (invalid parameters) or the number
+of complete rows written to out_rows. */
+
+int qoi_decode_rows(qoi_dec_state *state, const void *data, int size, void *out_rows, int n_rows);
+
+/* A seek table may be appended to a QOI image, after the end marker, to let
+decoding start at a row other than the first. Every interval rows it holds a
+snapshot of the decoder state at the start of that row. Decoders that don't
+know about the table stop at the end marker and never look at it.
+
+struct {
+    struct {
+        uint32_t offset;       // of the next op, from the start of the image
+        uint8_t  px[4];        // previous pixel; r, g, b, a
+        uint8_t  run;          // remainder of a pending QOI_OP_RUN
+        uint8_t  reserved[3];  // 0
+        uint8_t  index[64][4]; // r, g, b, a
+    } entries[count];          // for rows interval, 2 * interval, ...
+    uint32_t interval;
+    uint32_t count;
+    char     magic[4];         // magic bytes "qsek"
+};
+
+All values are big endian, like in the file header. */
+
+/* Build a seek table with a snapshot every interval rows for the QOI image of
+size bytes in data.
+
+The function either returns NULL on failure (invalid parameters or data, or
+malloc failed) or a pointer to the table, which has to be appended to the
+image. On success out_len is set to the size in bytes of the table.
+
+The returned table should be free()d after use. */
+
+void *qoi_seek_build(const void *data, int size, int interval, int *out_len);
+
+
+/* Start decoding a QOI image incrementally at row y. If data ends in a seek
+table, decoding resumes at the closest snapshot at or before y; otherwise at
+the first row, exactly like qoi_decode_init(). size must cover the whole image
+including the seek table.
+
+The function either returns 0 on failure (invalid parameters or header) or the
+offset in data at which the compressed data has to be passed on to
+qoi_decode_rows(). state->y is set to the row decoding resumes at; rows from
+there up to y still have to be decoded. */
+
+int qoi_decode_seek(qoi_dec_state *state, const void *data, int size, int channels, unsigned int y);
+
+
 #ifdef __cplusplus
 }
 #endif
@@ -318,6 +506,16 @@ Implementation */
     (((unsigned int)'q') << 24 | ((unsigned int)'o') << 16 | \
      ((unsigned int)'i') <<  8 | ((unsigned int)'f'))
 #define QOI_HEADER_SIZE 14
+#define QOI_SEEK_MAGIC \
+    (((unsigned int)'q') << 24 | ((unsigned int)'s') << 16 | \
+     ((unsigned int)'e') <<  8 | ((unsigned int)'k'))
+#define QOI_SEEK_ENTRY_SIZE (4 + 4 + 4 + 64 * 4)
+#define QOI_SEEK_FOOTER_SIZE 12
+#define QOI_FMT_VALID(F) ( \
+    (F) == 0 || (F) == 3 || (F) == 4 || \
+    (F) == QOI_FMT_RGB565 || (F) == QOI_FMT_RGB565_SWAP || \
+    (F) == QOI_FMT_RGB565A8 || (F) == QOI_FMT_RGB565A8_SWAP || \
+    (F) == QOI_FMT_ARGB8888)
 
 /* 2GB is the max file size that this implementation can safely handle. We guard
 against anything larger than that, assuming the worst case with 5 bytes per
@@ -325,13 +523,6 @@ pixel, rounded down to a nice clean value. 400 million pixels ought to be
 enough for anybody. */
 #define QOI_PIXELS_MAX ((unsigned int)400000000)
 
-typedef union {
-        struct {
-            unsigned char r, g, b, a;
-        } rgba;
-        unsigned int v;
-    } qoi_rgba_t;
-
 static const unsigned char qoi_padding[8] = {0, 0, 0, 0, 0, 0, 0, 1};
 
 static void qoi_write_32(unsigned char *bytes, int *p, unsigned int v)
@@ -342,6 +533,28 @@ static void qoi_write_32(unsigned char *bytes, int *p, unsigned int v)
     bytes[(*p)++] = (0x000000ff & v);
 }
 
+/* Pack a pixel into one of the QOI_FMT_* formats. The bytes of the format are
+returned from the least significant byte up, so they can be stored without
+converting the pixel again for every pixel of a run. */
+static unsigned int qoi_pack_px(qoi_rgba_t px, int fmt)
+{
+    unsigned int c;
+
+    if (fmt == QOI_FMT_ARGB8888) {
+        return
+            (unsigned int)px.rgba.b |
+            (unsigned int)px.rgba.g << 8 |
+            (unsigned int)px.rgba.r << 16 |
+            (unsigned int)px.rgba.a << 24;
+    }
+
+    c = ((px.rgba.r & 0xf8) << 8) | ((px.rgba.g & 0xfc) << 3) | (px.rgba.b >> 3);
+    if (fmt == QOI_FMT_RGB565_SWAP || fmt == QOI_FMT_RGB565A8_SWAP) {
+        c = ((c & 0xff) << 8) | (c >> 8);
+    }
+    return c | (unsigned int)px.rgba.a << 16;
+}
+
 static unsigned int qoi_read_32(const unsigned char *bytes, int *p)
 {
     unsigned int a = bytes[(*p)++];
@@ -351,7 +564,7 @@ static unsigned int qoi_read_32(const unsigned char *bytes, int *p)
     return a << 24 | b << 16 | c << 8 | d;
 }
 
-void *qoi_encode(const void *data, const qoi_desc *desc, int *out_len)
+void *qoi_encode_ex(const void *data, const qoi_desc *desc, int *out_len, int effort)
 {
     int i, max_size, p, run;
     int px_len, px_end, px_pos, channels;
@@ -365,7 +578,8 @@ void *qoi_encode(const void *data, const qoi_desc *desc, int *out_len)
         desc->width == 0 || desc->height == 0 ||
         desc->channels < 3 || desc->channels > 4 ||
         desc->colorspace > 1 ||
-        desc->height >= QOI_PIXELS_MAX / desc->width
+        desc->height >= QOI_PIXELS_MAX / desc->width ||
+        effort < QOI_EFFORT_FAST || effort > QOI_EFFORT_RGB565
     ) {
         return NULL;
     }
@@ -410,6 +624,17 @@ void *qoi_encode(const void *data, const qoi_desc *desc, int *out_len)
             px.rgba.a = pixels[px_pos + 3];
         }
 
+        if (effort >= QOI_EFFORT_RGB565) {
+            px.rgba.r = (px.rgba.r & 0xf8) | (px.rgba.r >> 5);
+            px.rgba.g = (px.rgba.g & 0xfc) | (px.rgba.g >> 6);
+            px.rgba.b = (px.rgba.b & 0xf8) | (px.rgba.b >> 5);
+        }
+        if (effort >= QOI_EFFORT_ALPHA && px.rgba.a == 0) {
+            /* Transparent black continues a run of transparent pixels
+            and otherwise mostly hits index[0], where it starts out */
+            px.v = 0;
+        }
+
         if (px.v == px_prev.v) {
             run++;
             if (run == 62 || px_pos == px_end) {
@@ -478,25 +703,17 @@ void *qoi_encode(const void *data, const qoi_desc *desc, int *out_len)
     return bytes;
 }
 
-void *qoi_decode(const void *data, int size, qoi_desc *desc, int channels)
+void *qoi_encode(const void *data, const qoi_desc *desc, int *out_len)
 {
-    const unsigned char *bytes;
-    unsigned int header_magic;
-    unsigned char *pixels;
-    qoi_rgba_t index[64];
-    qoi_rgba_t px;
-    int px_len, chunks_len, px_pos;
-    int p = 0, run = 0;
-
-    if (
-        data == NULL || desc == NULL ||
-        (channels != 0 && channels != 3 && channels != 4) ||
-        size < QOI_HEADER_SIZE + (int)sizeof(qoi_padding)
-    ) {
-        return NULL;
-    }
+    return qoi_encode_ex(data, desc, out_len, QOI_EFFORT_FAST);
+}
 
-    bytes = (const unsigned char *)data;
+/* Read the file header into desc. Returns the number of bytes read or 0 if the
+header is invalid. bytes must hold at least QOI_HEADER_SIZE bytes. */
+static int qoi_read_header(const unsigned char *bytes, qoi_desc *desc)
+{
+    unsigned int header_magic;
+    int p = 0;
 
     header_magic = qoi_read_32(bytes, &p);
     desc->width = qoi_read_32(bytes, &p);
@@ -511,27 +728,82 @@ void *qoi_decode(const void *data, int size, qoi_desc *desc, int channels)
         header_magic != QOI_MAGIC ||
         desc->height >= QOI_PIXELS_MAX / desc->width
     ) {
-        return NULL;
+        return 0;
     }
+    return p;
+}
 
-    if (channels == 0) {
-        channels = desc->channels;
+void *qoi_decode(const void *data, int size, qoi_desc *desc, int channels)
+{
+    unsigned char *pixels;
+    int px_len;
+
+    if (
+        data == NULL || desc == NULL ||
+        !QOI_FMT_VALID(channels) ||
+        size < QOI_HEADER_SIZE + (int)sizeof(qoi_padding) ||
+        !qoi_read_header((const unsigned char *)data, desc)
+    ) {
+        return NULL;
     }
 
-    px_len = desc->width * desc->height * channels;
+    px_len = desc->width * desc->height * QOI_FMT_BPP(channels == 0 ? desc->channels : channels);
     pixels = (unsigned char *) QOI_MALLOC(px_len);
     if (!pixels) {
         return NULL;
     }
 
+    if (!qoi_decode_into(pixels, px_len, data, size, desc, channels)) {
+        QOI_FREE(pixels);
+        return NULL;
+    }
+    return pixels;
+}
+
+int qoi_decode_into(void *dst, int dst_size, const void *data, int size, qoi_desc *desc, int channels)
+{
+    const unsigned char *bytes;
+    unsigned char *pixels;
+    qoi_rgba_t index[64];
+    qoi_rgba_t px;
+    unsigned int packed = 0;
+    int px_len, chunks_len, px_pos, bpp;
+    int p, run = 0;
+
+    if (
+        dst == NULL || data == NULL || desc == NULL ||
+        !QOI_FMT_VALID(channels) ||
+        size < QOI_HEADER_SIZE + (int)sizeof(qoi_padding)
+    ) {
+        return 0;
+    }
+
+    bytes = (const unsigned char *)data;
+    p = qoi_read_header(bytes, desc);
+    if (!p) {
+        return 0;
+    }
+
+    if (channels == 0) {
+        channels = desc->channels;
+    }
+
+    bpp = QOI_FMT_BPP(channels);
+    px_len = desc->width * desc->height * bpp;
+    if (dst_size < px_len) {
+        return 0;
+    }
+    pixels = (unsigned char *)dst;
+
     QOI_ZEROARR(index);
     px.rgba.r = 0;
     px.rgba.g = 0;
     px.rgba.b = 0;
     px.rgba.a = 255;
+    packed = qoi_pack_px(px, channels);
 
     chunks_len = size - (int)sizeof(qoi_padding);
-    for (px_pos = 0; px_pos < px_len; px_pos += channels) {
+    for (px_pos = 0; px_pos < px_len; px_pos += bpp) {
         if (run > 0) {
             run--;
         } else if (p < chunks_len) {
@@ -563,6 +835,21 @@ void *qoi_decode(const void *data, int size, qoi_desc *desc, int channels)
             }
 
             index[QOI_COLOR_HASH(px) % 64] = px;
+            if (channels > 4) {
+                packed = qoi_pack_px(px, channels);
+            }
+        }
+
+        if (channels > 4) {
+            pixels[px_pos + 0] = packed;
+            pixels[px_pos + 1] = packed >> 8;
+            if (bpp > 2) {
+                pixels[px_pos + 2] = packed >> 16;
+            }
+            if (bpp > 3) {
+                pixels[px_pos + 3] = packed >> 24;
+            }
+            continue;
         }
 
         pixels[px_pos + 0] = px.rgba.r;
@@ -574,7 +861,273 @@ void *qoi_decode(const void *data, int size, qoi_desc *desc, int channels)
         }
     }
 
-    return pixels;
+    return px_len;
+}
+
+int qoi_decode_init(qoi_dec_state *state, const void *data, int size, int channels)
+{
+    int p;
+
+    if (
+        state == NULL || data == NULL ||
+        !QOI_FMT_VALID(channels) ||
+        size < QOI_HEADER_SIZE
+    ) {
+        return 0;
+    }
+
+    p = qoi_read_header((const unsigned char *)data, &state->desc);
+    if (!p) {
+        return 0;
+    }
+
+    QOI_ZEROARR(state->index);
+    state->px.rgba.r = 0;
+    state->px.rgba.g = 0;
+    state->px.rgba.b = 0;
+    state->px.rgba.a = 255;
+    state->run = 0;
+    state->channels = channels == 0 ? state->desc.channels : channels;
+    state->x = 0;
+    state->y = 0;
+    state->consumed = 0;
+
+    return p;
+}
+
+int qoi_decode_rows(qoi_dec_state *state, const void *data, int size, void *out_rows, int n_rows)
+{
+    const unsigned char *bytes;
+    unsigned char *pixels;
+    qoi_rgba_t *index;
+    qoi_rgba_t px;
+    unsigned int packed, x, y, width, height;
+    int p = 0, run, channels, bpp, rows = 0;
+
+    if (
+        state == NULL || out_rows == NULL || n_rows <= 0 ||
+        size < 0 || (data == NULL && size > 0)
+    ) {
+        return -1;
+    }
+
+    bytes = (const unsigned char *)data;
+    index = state->index;
+    px = state->px;
+    run = state->run;
+    channels = state->channels;
+    bpp = QOI_FMT_BPP(channels);
+    packed = qoi_pack_px(px, channels);
+    width = state->desc.width;
+    height = state->desc.height;
+    x = state->x;
+    y = state->y;
+    pixels = (unsigned char *)out_rows + x * bpp;
+
+    while (rows < n_rows && y < height) {
+        if (run > 0) {
+            run--;
+        } else {
+            int b1, op_len;
+
+            if (p >= size) {
+                break;
+            }
+
+            b1 = bytes[p];
+            op_len =
+                b1 == QOI_OP_RGBA ? 5 :
+                b1 == QOI_OP_RGB ? 4 :
+                (b1 & QOI_MASK_2) == QOI_OP_LUMA ? 2 : 1;
+            if (p + op_len > size) {
+                break;
+            }
+            p++;
+
+            if (b1 == QOI_OP_RGB) {
+                px.rgba.r = bytes[p++];
+                px.rgba.g = bytes[p++];
+                px.rgba.b = bytes[p++];
+            } else if (b1 == QOI_OP_RGBA) {
+                px.rgba.r = bytes[p++];
+                px.rgba.g = bytes[p++];
+                px.rgba.b = bytes[p++];
+                px.rgba.a = bytes[p++];
+            } else if ((b1 & QOI_MASK_2) == QOI_OP_INDEX) {
+                px = index[b1];
+            } else if ((b1 & QOI_MASK_2) == QOI_OP_DIFF) {
+                px.rgba.r += ((b1 >> 4) & 0x03) - 2;
+                px.rgba.g += ((b1 >> 2) & 0x03) - 2;
+                px.rgba.b += (b1       & 0x03) - 2;
+            } else if ((b1 & QOI_MASK_2) == QOI_OP_LUMA) {
+                int b2 = bytes[p++];
+                int vg = (b1 & 0x3f) - 32;
+                px.rgba.r += vg - 8 + ((b2 >> 4) & 0x0f);
+                px.rgba.g += vg;
+                px.rgba.b += vg - 8 + (b2       & 0x0f);
+            } else if ((b1 & QOI_MASK_2) == QOI_OP_RUN) {
+                run = (b1 & 0x3f);
+            }
+
+            index[QOI_COLOR_HASH(px) % 64] = px;
+            if (channels > 4) {
+                packed = qoi_pack_px(px, channels);
+            }
+        }
+
+        if (channels > 4) {
+            pixels[0] = packed;
+            pixels[1] = packed >> 8;
+            if (bpp > 2) {
+                pixels[2] = packed >> 16;
+            }
+            if (bpp > 3) {
+                pixels[3] = packed >> 24;
+            }
+        } else {
+            pixels[0] = px.rgba.r;
+            pixels[1] = px.rgba.g;
+            pixels[2] = px.rgba.b;
+
+            if (channels == 4) {
+                pixels[3] = px.rgba.a;
+            }
+        }
+        pixels += bpp;
+
+        if (++x == width) {
+            x = 0;
+            y++;
+            rows++;
+        }
+    }
+
+    state->px = px;
+    state->run = run;
+    state->x = x;
+    state->y = y;
+    state->consumed = p;
+    return rows;
+}
+
+void *qoi_seek_build(const void *data, int size, int interval, int *out_len)
+{
+    const unsigned char *bytes;
+    unsigned char *table, *row, *e;
+    qoi_dec_state state;
+    int i, p, q, count, table_len;
+
+    if (data == NULL || out_len == NULL || interval <= 0) {
+        return NULL;
+    }
+
+    p = qoi_decode_init(&state, data, size, 4);
+    if (!p) {
+        return NULL;
+    }
+
+    bytes = (const unsigned char *)data;
+    count = (state.desc.height - 1) / interval;
+    table_len = count * QOI_SEEK_ENTRY_SIZE + QOI_SEEK_FOOTER_SIZE;
+    table = (unsigned char *) QOI_MALLOC(table_len);
+    row = (unsigned char *) QOI_MALLOC(state.desc.width * 4);
+    if (!table || !row) {
+        QOI_FREE(table);
+        QOI_FREE(row);
+        return NULL;
+    }
+
+    for (e = table; e < table + count * QOI_SEEK_ENTRY_SIZE; e += QOI_SEEK_ENTRY_SIZE) {
+        do {
+            if (qoi_decode_rows(&state, bytes + p, size - p, row, 1) != 1) {
+                QOI_FREE(table);
+                QOI_FREE(row);
+                return NULL;
+            }
+            p += state.consumed;
+        } while (state.y % interval);
+
+        q = 0;
+        qoi_write_32(e, &q, p);
+        e[q++] = state.px.rgba.r;
+        e[q++] = state.px.rgba.g;
+        e[q++] = state.px.rgba.b;
+        e[q++] = state.px.rgba.a;
+        e[q++] = state.run;
+        e[q++] = 0;
+        e[q++] = 0;
+        e[q++] = 0;
+        for (i = 0; i < 64; i++) {
+            e[q++] = state.index[i].rgba.r;
+            e[q++] = state.index[i].rgba.g;
+            e[q++] = state.index[i].rgba.b;
+            e[q++] = state.index[i].rgba.a;
+        }
+    }
+
+    q = count * QOI_SEEK_ENTRY_SIZE;
+    qoi_write_32(table, &q, interval);
+    qoi_write_32(table, &q, count);
+    qoi_write_32(table, &q, QOI_SEEK_MAGIC);
+
+    QOI_FREE(row);
+    *out_len = table_len;
+    return table;
+}
+
+int qoi_decode_seek(qoi_dec_state *state, const void *data, int size, int channels, unsigned int y)
+{
+    const unsigned char *bytes, *e;
+    unsigned int interval, count, offset, k;
+    int i, p, q;
+
+    p = qoi_decode_init(state, data, size, channels);
+    if (!p || size < p + (int)sizeof(qoi_padding) + QOI_SEEK_FOOTER_SIZE) {
+        return p;
+    }
+
+    bytes = (const unsigned char *)data;
+    q = size - QOI_SEEK_FOOTER_SIZE;
+    interval = qoi_read_32(bytes, &q);
+    count = qoi_read_32(bytes, &q);
+    if (
+        qoi_read_32(bytes, &q) != QOI_SEEK_MAGIC ||
+        interval == 0 || y < interval ||
+        count > (unsigned int)(size - p - (int)sizeof(qoi_padding) - QOI_SEEK_FOOTER_SIZE) / QOI_SEEK_ENTRY_SIZE
+    ) {
+        return p;
+    }
+
+    k = y / interval;
+    if (k > count) {
+        k = count;
+    }
+    if (k == 0 || k * interval >= state->desc.height) {
+        return p;
+    }
+
+    e = bytes + size - QOI_SEEK_FOOTER_SIZE - (count - k + 1) * QOI_SEEK_ENTRY_SIZE;
+    q = 0;
+    offset = qoi_read_32(e, &q);
+    if (offset < (unsigned int)p || offset > (unsigned int)(e - bytes)) {
+        return p;
+    }
+
+    state->px.rgba.r = e[q++];
+    state->px.rgba.g = e[q++];
+    state->px.rgba.b = e[q++];
+    state->px.rgba.a = e[q++];
+    state->run = e[q];
+    q += 4;
+    for (i = 0; i < 64; i++) {
+        state->index[i].rgba.r = e[q++];
+        state->index[i].rgba.g = e[q++];
+        state->index[i].rgba.b = e[q++];
+        state->index[i].rgba.a = e[q++];
+    }
+    state->y = k * interval;
+
+    return offset;
 }
 
 #ifndef QOI_NO_STDIO
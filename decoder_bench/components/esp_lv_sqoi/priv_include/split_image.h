@@ -0,0 +1,268 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Parser for the split image containers written by spiffs_assets_gen.py.
+ *
+ * V1:
+ *   magic, e.g. "_SQOI__" (7 bytes) | version "\0V1.00\0" (7 bytes)
+ *   width | height | splits | split height     (2 bytes each, little endian)
+ *   length of each split                       (2 bytes each, little endian)
+ *   splits, back to back
+ *
+ * V2:
+ *   magic (7 bytes) | version "\0V2.00\0" (7 bytes)
+ *   width | height | splits | split height     (2 bytes each, little endian)
+ *   format (1 byte) | pixel format (1 byte) | alignment (2 bytes) | reserved (2 bytes)
+ *   offset of each split and of the end        (4 bytes each, little endian)
+ *   splits, each starting at a multiple of the alignment
+ *
+ * V3:
+ *   as V2, with version "\0V3.00\0" and in place of the offsets:
+ *   reach                                      (4 bytes, little endian)
+ *   offset and length of each split            (4 bytes each, little endian)
+ *   splits anywhere after the table, entries may share a split
+ *
+ * V2 and V3 offsets count from the start of the container, so a split is found
+ * without walking the table and splits aren't limited to 64 KB. The packer
+ * writes V3 when it deduplicates splits. Splits shared with other images are
+ * stored in a pool asset after all others, outside the image's own bytes, and
+ * reach is the number of bytes from the start of the container to the end of
+ * the pool. The image's size only counts its own bytes. The parser doesn't trust
+ * reach: shared splits have to lie inside the pool the caller passes.
+ *
+ * Raw images ("_SRAW__") are V2 or V3 split images with a single split holding the
+ * pixels in pixel format, ready to be drawn in place.
+ *
+ * It only depends on the C library, so it can be built and fuzzed on the host.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SPLIT_IMAGE_MAGIC_LEN       7
+#define SPLIT_IMAGE_HEADER_SIZE     22
+#define SPLIT_IMAGE_HEADER_SIZE_V2  28
+#define SPLIT_IMAGE_HEADER_SIZE_V3  32
+
+/**
+ * @brief Encoding of the splits, V2 only
+ */
+typedef enum {
+    SPLIT_IMAGE_FORMAT_UNKNOWN = 0,
+    SPLIT_IMAGE_FORMAT_JPG = 1,
+    SPLIT_IMAGE_FORMAT_PNG = 2,
+    SPLIT_IMAGE_FORMAT_QOI = 3,
+    SPLIT_IMAGE_FORMAT_RAW = 4,     /*!< Pixels stored as they are, in pixel_format */
+} split_image_format_t;
+
+/**
+ * @brief Pixel format the splits decode to, V2 only
+ */
+typedef enum {
+    SPLIT_IMAGE_PIXEL_UNKNOWN = 0,
+    SPLIT_IMAGE_PIXEL_RGB888 = 3,
+    SPLIT_IMAGE_PIXEL_RGBA8888 = 4,
+    SPLIT_IMAGE_PIXEL_RGB565 = 0x12,        /*!< Same values as the QOI_FMT_RGB565* formats of qoi.h */
+    SPLIT_IMAGE_PIXEL_RGB565A8 = 0x13,
+    SPLIT_IMAGE_PIXEL_RGB565_SWAP = 0x22,
+    SPLIT_IMAGE_PIXEL_RGB565A8_SWAP = 0x23,
+} split_image_pixel_t;
+
+/**
+ * @brief Parsed split image header
+ */
+typedef struct {
+    uint8_t version;                /*!< Header version, 1 to 3 */
+    uint8_t format;                 /*!< split_image_format_t, UNKNOWN for V1 */
+    uint8_t pixel_format;           /*!< split_image_pixel_t, UNKNOWN for V1 */
+    uint16_t align;                 /*!< Alignment of the splits in bytes, 1 for V1 */
+    uint16_t width;                 /*!< Image width */
+    uint16_t height;                /*!< Image height */
+    uint16_t splits;                /*!< Number of splits */
+    uint16_t split_height;          /*!< Height of every split but the last one */
+    const uint8_t *base;            /*!< Start of the container */
+    const uint8_t *table;           /*!< V1: 2 byte lengths, V2: 4 byte offsets, V3: 4 byte offsets and lengths */
+    const uint8_t *data;            /*!< First split, V3: first byte after the table */
+} split_image_t;
+
+/**
+ * @brief Memory the shared splits of V3 images may lie in, e.g. the mapped "split_pool.bin" asset
+ */
+typedef struct {
+    const uint8_t *mem;             /*!< Start of the pool, NULL if there is none */
+    size_t size;                    /*!< Num bytes in the pool */
+} split_image_pool_t;
+
+static inline uint16_t split_image_read_16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t split_image_read_32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/**
+ * @brief Find split `index`
+ *
+ * V2 reads two offsets, V3 an offset and a length. V1 sums the lengths of the
+ * splits before `index`.
+ *
+ * @param img Parsed split image
+ * @param index Split index, below img->splits
+ * @param len Set to the length of the split in bytes
+ * @return Pointer to the split
+ */
+static inline const uint8_t *split_image_tile(const split_image_t *img, int index, uint32_t *len)
+{
+    if (img->version == 3) {
+        *len = split_image_read_32(img->table + index * 8 + 4);
+        return img->base + split_image_read_32(img->table + index * 8);
+    }
+    if (img->version == 2) {
+        uint32_t start = split_image_read_32(img->table + index * 4);
+        *len = split_image_read_32(img->table + index * 4 + 4) - start;
+        return img->base + start;
+    }
+
+    const uint8_t *tile = img->data;
+    for (int i = 0; i < index; i++) {
+        tile += split_image_read_16(img->table + i * 2);
+    }
+    *len = split_image_read_16(img->table + index * 2);
+    return tile;
+}
+
+/**
+ * @brief Check that `len` bytes at `offset` from `buf` lie inside a pool
+ */
+static inline bool split_image_in_pool(const split_image_pool_t *pool, const uint8_t *buf, uint32_t offset, uint32_t len)
+{
+    if (!pool || !pool->mem || offset > UINTPTR_MAX - (uintptr_t)buf) {
+        return false;
+    }
+    uintptr_t start = (uintptr_t)buf + offset;
+    uintptr_t mem = (uintptr_t)pool->mem;
+    return start >= mem && start - mem <= pool->size && len <= pool->size - (start - mem);
+}
+
+/**
+ * @brief Parse and check the header of a split image
+ *
+ * All fields are checked against each other and against `size`, so the splits
+ * found through the result never reach past the end of `buf`, except for the
+ * shared splits of a V3 image, which have to lie inside `pool`. Nothing is
+ * allocated, the result points into `buf`.
+ *
+ * @param buf Split image
+ * @param size Num bytes in buf
+ * @param magic Expected magic, e.g. "_SQOI__"
+ * @param pool Pool of shared splits, NULL to keep all splits inside buf
+ * @param img Filled with the parsed header on success
+ * @return true if buf holds a valid V1, V2 or V3 split image
+ */
+static inline bool split_image_parse(const uint8_t *buf, size_t size, const char *magic, const split_image_pool_t *pool,
+                                     split_image_t *img)
+{
+    if (!buf || size < SPLIT_IMAGE_HEADER_SIZE || memcmp(buf, magic, SPLIT_IMAGE_MAGIC_LEN) != 0) {
+        return false;
+    }
+
+    if (memcmp(buf + SPLIT_IMAGE_MAGIC_LEN, "\0V1.00\0", 7) == 0) {
+        img->version = 1;
+    } else if (memcmp(buf + SPLIT_IMAGE_MAGIC_LEN, "\0V2.00\0", 7) == 0) {
+        img->version = 2;
+    } else if (memcmp(buf + SPLIT_IMAGE_MAGIC_LEN, "\0V3.00\0", 7) == 0) {
+        img->version = 3;
+    } else {
+        return false;
+    }
+
+    img->width = split_image_read_16(buf + 14);
+    img->height = split_image_read_16(buf + 16);
+    img->splits = split_image_read_16(buf + 18);
+    img->split_height = split_image_read_16(buf + 20);
+    if (!img->width || !img->height || !img->splits || !img->split_height ||
+            (uint32_t)img->splits * img->split_height < img->height ||
+            (uint32_t)(img->splits - 1) * img->split_height >= img->height) {
+        return false;
+    }
+    img->base = buf;
+
+    if (img->version == 1) {
+        size_t table_size = (size_t)img->splits * 2;
+        if (size - SPLIT_IMAGE_HEADER_SIZE < table_size) {
+            return false;
+        }
+        img->format = SPLIT_IMAGE_FORMAT_UNKNOWN;
+        img->pixel_format = SPLIT_IMAGE_PIXEL_UNKNOWN;
+        img->align = 1;
+        img->table = buf + SPLIT_IMAGE_HEADER_SIZE;
+        img->data = img->table + table_size;
+
+        size_t data_size = size - SPLIT_IMAGE_HEADER_SIZE - table_size;
+        size_t total = 0;
+        for (int i = 0; i < img->splits; i++) {
+            total += split_image_read_16(img->table + i * 2);
+        }
+        return total <= data_size;
+    }
+
+    size_t header_size = img->version == 3 ? SPLIT_IMAGE_HEADER_SIZE_V3 : SPLIT_IMAGE_HEADER_SIZE_V2;
+    size_t table_size = img->version == 3 ? (size_t)img->splits * 8 : ((size_t)img->splits + 1) * 4;
+    if (size < header_size || size - header_size < table_size) {
+        return false;
+    }
+    img->format = buf[22];
+    img->pixel_format = buf[23];
+    img->align = split_image_read_16(buf + 24);
+    img->table = buf + header_size;
+    if (!img->align || (img->align & (img->align - 1))) {
+        return false;
+    }
+
+    if (img->version == 3) {
+        /* Splits have to be aligned, after the table and inside buf, or inside the pool for shared ones */
+        img->data = img->table + table_size;
+        for (int i = 0; i < img->splits; i++) {
+            uint32_t offset = split_image_read_32(img->table + i * 8);
+            uint32_t len = split_image_read_32(img->table + i * 8 + 4);
+            if (offset < header_size + table_size || (offset & (img->align - 1))) {
+                return false;
+            }
+            if ((offset > size || len > size - offset) && !split_image_in_pool(pool, buf, offset, len)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /* Offsets have to be aligned, ascending and inside buf */
+    uint32_t prev = SPLIT_IMAGE_HEADER_SIZE_V2 + table_size;
+    for (int i = 0; i <= img->splits; i++) {
+        uint32_t offset = split_image_read_32(img->table + i * 4);
+        if (offset < prev || offset > size || (i < img->splits && (offset & (img->align - 1)))) {
+            return false;
+        }
+        prev = offset;
+    }
+    img->data = buf + split_image_read_32(img->table);
+    return true;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -4,12 +4,19 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 #include <string.h>
+#include <sys/param.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
 #include "esp_err.h"
 #include "esp_log.h"
 #include "esp_check.h"
 #include <spi_flash_mmap.h>
 #include <esp_attr.h>
 #include <esp_partition.h>
+#include <esp_heap_caps.h>
+#include <esp_rom_crc.h>
 #include "esp_mmap_assets.h"
 
 static const char *TAG = "mmap_assets";
@@ -22,6 +29,42 @@ static const char *TAG = "mmap_assets";
 #define ASSETS_FILE_MAGIC_HEAD  0x5A5A
 #define ASSETS_FILE_MAGIC_LEN   2
 
+#define ASSETS_NAME_INDEX_MAGIC "NIDX"
+#define ASSETS_SPLIT_POOL_MAGIC "_SPOOL_"   /* Start of the splits shared by split images, after all other assets */
+#define ASSETS_SPLIT_POOL_MAGIC_LEN 7
+#define ASSETS_NAME_INDEX_TAIL  8           /* Number of files and magic after the name index */
+
+#define ASSETS_CACHE_BLOCKS     CONFIG_MMAP_READ_CACHE_BLOCKS
+#define ASSETS_CACHE_BLOCK_SIZE CONFIG_MMAP_READ_CACHE_BLOCK_SIZE
+#define ASSETS_CACHE_SLOTS      (ASSETS_CACHE_BLOCKS ? ASSETS_CACHE_BLOCKS : 1)   /* Arrays can't be empty */
+#define ASSETS_CACHE_EMPTY      UINT32_MAX
+
+#ifdef CONFIG_MMU_PAGE_SIZE
+#define ASSETS_MMU_PAGE_SIZE    CONFIG_MMU_PAGE_SIZE
+#else
+#define ASSETS_MMU_PAGE_SIZE    0x10000
+#endif
+#define ASSETS_WINDOW_PAGES     4           /* Default of mmap_window_pages */
+
+#if CONFIG_MMAP_ASSET_CRC
+#define ASSETS_CRC              1
+#else
+#define ASSETS_CRC              0
+#endif
+#define ASSETS_VERIFY_TASK_PRIORITY 1
+#define ASSETS_VERIFY_TASK_STACK    3072
+
+#define ASSETS_PREFETCH_TASK_PRIORITY   1
+#define ASSETS_PREFETCH_TASK_STACK      3072
+#define ASSETS_PREFETCH_QUEUE_LEN       4
+#define ASSETS_PREFETCH_STRIDE          32  /* Smallest flash cache line */
+
+enum {
+    ASSETS_CRC_UNKNOWN,
+    ASSETS_CRC_OK,
+    ASSETS_CRC_BAD,
+};
+
 /**
  * @brief Asset table structure, contains detailed information for each asset.
  */
@@ -29,29 +72,145 @@ static const char *TAG = "mmap_assets";
 typedef struct {
     char asset_name[CONFIG_MMAP_FILE_NAME_LENGTH];  /*!< Name of the asset */
     uint32_t asset_size;          /*!< Size of the asset */
-    uint32_t asset_offset;        /*!< Offset of the asset */
+    uint32_t asset_offset;        /*!< Offset of the asset, its data starts at a multiple of CONFIG_MMAP_ASSET_ALIGN in the partition */
     uint16_t asset_width;         /*!< Width of the asset */
     uint16_t asset_height;        /*!< Height of the asset */
+#if CONFIG_MMAP_ASSET_CRC
+    uint32_t asset_crc;           /*!< CRC32 of the asset */
+#endif
 } mmap_assets_table_t;
 #pragma pack()
 
 typedef struct {
     const char *asset_mem;
     const mmap_assets_table_t *table;
+    int16_t window;                         /*!< Mapping holding the asset while it is pinned */
+    uint16_t pins;                          /*!< Number of mmap_assets_get_mem() calls not released yet */
+    uint8_t crc_state;                      /*!< ASSETS_CRC_*, once the asset was verified */
 } mmap_assets_item_t;
 
+typedef struct {
+    const uint8_t *mem;                     /*!< Address `offset` is mapped at */
+    esp_partition_mmap_handle_t handle;
+    uint32_t offset;                        /*!< Partition offset of the mapping */
+    uint32_t len;
+    uint16_t pages;                         /*!< MMU pages of the mapping, 0 if the slot is free */
+    uint16_t pins;                          /*!< Pins of the assets in the mapping */
+    uint32_t last_use;
+} mmap_assets_window_t;
+
+typedef struct {
+    mmap_assets_prefetch_cb_t done_cb;
+    void *user_ctx;
+    int count;
+    int index[];
+} prefetch_request_t;
+
 typedef struct {
     esp_partition_mmap_handle_t *mmap_handle;
     const esp_partition_t *partition;
     mmap_assets_item_t *item;
+    uint16_t *name_index;                   /*!< Asset indexes in the order of their names */
     int max_asset;
     struct {
         unsigned int mmap_enable: 1;        /*!< Flag to indicate if memory-mapped I/O is enabled */
-        unsigned int reserved: 31;          /*!< Reserved for future use */
+        unsigned int mmap_window: 1;        /*!< Flag to map pages of the assets on demand */
+        unsigned int lazy_check: 1;         /*!< Flag to verify an asset on its first mmap_assets_get_mem() */
+        unsigned int reserved: 29;          /*!< Reserved for future use */
     } flags;
     int stored_files;
+    SemaphoreHandle_t lock;                 /*!< Guards the read cache and the window */
+    struct {
+        uint8_t *data;                      /*!< ASSETS_CACHE_BLOCKS blocks, NULL if there is no read cache */
+        uint32_t block[ASSETS_CACHE_SLOTS];             /*!< Partition block held by each slot */
+        uint32_t last_use[ASSETS_CACHE_SLOTS];          /*!< Use count of each slot at its last use */
+        uint32_t use_count;
+        uint32_t last_miss;                 /*!< Last block read from flash, for read-ahead */
+        mmap_assets_cache_stats_t stats;
+    } cache;                                /*!< Block read cache, used without mmap */
+    struct {
+        mmap_assets_window_t *map;          /*!< Mappings, at most one per page */
+        int max_pages;                      /*!< Most pages mapped at once */
+        int pages;                          /*!< Pages mapped */
+        uint32_t use_count;
+    } window;                               /*!< Pages mapped on demand, with mmap_window */
+    struct {
+        SemaphoreHandle_t lock;             /*!< Serializes the checks, so each asset is read once, NULL without CONFIG_MMAP_ASSET_CRC */
+        SemaphoreHandle_t done;             /*!< Given when the task ends, NULL without background_check */
+        volatile bool stop;
+        int bad;                            /*!< Assets with a bad CRC */
+    } verify;                               /*!< Background verification task */
+    struct {
+        QueueHandle_t queue;                /*!< Requests, NULL until the first mmap_assets_prefetch() */
+        SemaphoreHandle_t done;             /*!< Given when the task ends */
+        mmap_assets_prefetch_stats_t stats;
+    } prefetch;                             /*!< Prefetch task */
 } mmap_assets_t;
 
+/* All assets are mapped at once, and the asset table is read in place */
+static inline bool assets_mapped(const mmap_assets_t *map_asset)
+{
+    return map_asset->flags.mmap_enable && !map_asset->flags.mmap_window;
+}
+
+static int name_entry_cmp(const void *a, const void *b)
+{
+    const mmap_assets_item_t *item_a = *(const mmap_assets_item_t * const *)a;
+    const mmap_assets_item_t *item_b = *(const mmap_assets_item_t * const *)b;
+    int c = strncmp(item_a->table->asset_name, item_b->table->asset_name, CONFIG_MMAP_FILE_NAME_LENGTH);
+    return c ? c : (item_a > item_b) - (item_a < item_b);
+}
+
+/*
+ * Load the name index the packer appends after the assets, or sort the names
+ * if the partition has none or holds another number of files
+ */
+static esp_err_t load_name_index(mmap_assets_t *map_asset, int stored_len, int table_len)
+{
+    int files = map_asset->max_asset;
+    uint16_t *name_index = malloc(files * sizeof(uint16_t) + 1);
+    ESP_RETURN_ON_FALSE(name_index, ESP_ERR_NO_MEM, TAG, "no mem for name index");
+
+    struct {
+        uint32_t files;
+        char magic[4];
+    } tail = {0};
+    uint32_t index_offset = ASSETS_TABLE_OFFSET + stored_len - ASSETS_NAME_INDEX_TAIL - files * sizeof(uint16_t);
+    if (files == map_asset->stored_files && stored_len >= table_len + ASSETS_NAME_INDEX_TAIL + files * (int)sizeof(uint16_t)) {
+        esp_partition_read(map_asset->partition, ASSETS_TABLE_OFFSET + stored_len - ASSETS_NAME_INDEX_TAIL, &tail, sizeof(tail));
+    }
+
+    if (tail.files == files && memcmp(tail.magic, ASSETS_NAME_INDEX_MAGIC, sizeof(tail.magic)) == 0 &&
+            esp_partition_read(map_asset->partition, index_offset, name_index, files * sizeof(uint16_t)) == ESP_OK) {
+        for (int i = 0; i < files; i++) {
+            if (name_index[i] >= files) {
+                free(name_index);
+                ESP_LOGE(TAG, "bad name index");
+                return ESP_ERR_INVALID_CRC;
+            }
+        }
+    } else {
+        ESP_LOGD(TAG, "no name index, sorting %d names", files);
+        const mmap_assets_item_t **sorted = malloc(files * sizeof(mmap_assets_item_t *) + 1);
+        if (!sorted) {
+            free(name_index);
+            ESP_LOGE(TAG, "no mem for name index");
+            return ESP_ERR_NO_MEM;
+        }
+        for (int i = 0; i < files; i++) {
+            sorted[i] = map_asset->item + i;
+        }
+        qsort(sorted, files, sizeof(mmap_assets_item_t *), name_entry_cmp);
+        for (int i = 0; i < files; i++) {
+            name_index[i] = sorted[i] - map_asset->item;
+        }
+        free(sorted);
+    }
+
+    map_asset->name_index = name_index;
+    return ESP_OK;
+}
+
 static uint32_t compute_checksum(const uint8_t *data, uint32_t length)
 {
     uint32_t checksum = 0;
@@ -61,6 +220,64 @@ static uint32_t compute_checksum(const uint8_t *data, uint32_t length)
     return checksum & 0xFFFF;
 }
 
+/* Check the CRC32 of an asset once, from flash unless all assets are mapped */
+static esp_err_t verify_asset(mmap_assets_t *map_asset, int index)
+{
+#if CONFIG_MMAP_ASSET_CRC
+    mmap_assets_item_t *item = map_asset->item + index;
+    /* Another task checking the same asset has it done once this one gets the lock */
+    xSemaphoreTake(map_asset->verify.lock, portMAX_DELAY);
+    if (item->crc_state == ASSETS_CRC_UNKNOWN) {
+        uint32_t size = item->table->asset_size;
+        uint32_t crc = 0;
+        if (assets_mapped(map_asset)) {
+            crc = esp_rom_crc32_le(0, (const uint8_t *)item->asset_mem + ASSETS_FILE_MAGIC_LEN, size);
+        } else {
+            uint32_t offset = (uint32_t)item->asset_mem + ASSETS_FILE_MAGIC_LEN;
+            uint8_t buffer[512];
+            while (size > 0) {
+                uint32_t read_size = MIN(size, sizeof(buffer));
+                esp_err_t ret = esp_partition_read(map_asset->partition, offset, buffer, read_size);
+                if (ret != ESP_OK) {
+                    xSemaphoreGive(map_asset->verify.lock);
+                    ESP_LOGE(TAG, "esp_partition_read failed");
+                    return ret;
+                }
+                crc = esp_rom_crc32_le(crc, buffer, read_size);
+                offset += read_size;
+                size -= read_size;
+            }
+        }
+        item->crc_state = crc == item->table->asset_crc ? ASSETS_CRC_OK : ASSETS_CRC_BAD;
+        if (item->crc_state == ASSETS_CRC_BAD) {
+            ESP_LOGE(TAG, "(%s) bad CRC 0x%08" PRIx32 ", stored 0x%08" PRIx32, item->table->asset_name, crc, item->table->asset_crc);
+        }
+    }
+    esp_err_t ret = item->crc_state == ASSETS_CRC_OK ? ESP_OK : ESP_ERR_INVALID_CRC;
+    xSemaphoreGive(map_asset->verify.lock);
+    return ret;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+static void verify_task(void *arg)
+{
+    mmap_assets_t *map_asset = (mmap_assets_t *)arg;
+    int bad = 0;
+
+    for (int i = 0; i < map_asset->max_asset && !map_asset->verify.stop; i++) {
+        if (verify_asset(map_asset, i) != ESP_OK) {
+            bad++;
+        }
+    }
+    ESP_LOGD(TAG, "background check of \"%s\" done, %d bad assets", map_asset->partition->label, bad);
+
+    map_asset->verify.bad = bad;
+    xSemaphoreGive(map_asset->verify.done);
+    vTaskDelete(NULL);
+}
+
 esp_err_t mmap_assets_new(const mmap_assets_config_t *config, mmap_assets_handle_t *ret_item)
 {
     esp_err_t ret = ESP_OK;
@@ -75,6 +292,18 @@ esp_err_t mmap_assets_new(const mmap_assets_config_t *config, mmap_assets_handle
     ESP_GOTO_ON_FALSE(map_asset, ESP_ERR_NO_MEM, err, TAG, "no mem for map_asset handle");
 
     map_asset->flags.mmap_enable = config->flags.mmap_enable;
+    map_asset->flags.mmap_window = config->flags.mmap_window;
+    map_asset->flags.lazy_check = config->flags.lazy_check;
+    ESP_GOTO_ON_FALSE(ASSETS_CRC || !(config->flags.lazy_check || config->flags.background_check), ESP_ERR_NOT_SUPPORTED, err, TAG,
+                      "lazy_check and background_check need CONFIG_MMAP_ASSET_CRC");
+    ESP_GOTO_ON_FALSE(!config->flags.mmap_window || config->flags.mmap_enable, ESP_ERR_INVALID_ARG, err, TAG, "mmap_window needs mmap_enable");
+
+    map_asset->lock = xSemaphoreCreateMutex();
+    ESP_GOTO_ON_FALSE(map_asset->lock, ESP_ERR_NO_MEM, err, TAG, "no mem for lock");
+#if CONFIG_MMAP_ASSET_CRC
+    map_asset->verify.lock = xSemaphoreCreateMutex();
+    ESP_GOTO_ON_FALSE(map_asset->verify.lock, ESP_ERR_NO_MEM, err, TAG, "no mem for lock");
+#endif
 
     const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, config->partition_label);
     ESP_GOTO_ON_FALSE(partition, ESP_ERR_NOT_FOUND, err, TAG, "Can not find \"%s\" in partition table", config->partition_label);
@@ -85,27 +314,47 @@ esp_err_t mmap_assets_new(const mmap_assets_config_t *config, mmap_assets_handle
     uint32_t stored_chksum = 0;
     uint32_t calculated_checksum = 0;
 
-    if (map_asset->flags.mmap_enable) {
+    esp_partition_read(partition, ASSETS_FILE_NUM_OFFSET, &stored_files, sizeof(stored_files));
+    esp_partition_read(partition, ASSETS_CHECKSUM_OFFSET, &stored_chksum, sizeof(stored_chksum));
+    esp_partition_read(partition, ASSETS_TABLE_LEN, &stored_len, sizeof(stored_len));
+    ESP_GOTO_ON_FALSE(stored_len >= 0 && (uint32_t)stored_len <= partition->size - ASSETS_TABLE_OFFSET, ESP_ERR_INVALID_SIZE, err, TAG,
+                      "bad table length %d in \"%s\"", stored_len, partition->label);
+
+    if (assets_mapped(map_asset)) {
+        /* Only the assets are mapped, not the free space of the partition after them */
+        uint32_t mmap_size = ASSETS_TABLE_OFFSET + stored_len;
         int free_pages = spi_flash_mmap_get_free_pages(ESP_PARTITION_MMAP_DATA);
         uint32_t storage_size = free_pages * 64 * 1024;
         ESP_LOGD(TAG, "The storage free size is %ld KB", storage_size / 1024);
-        ESP_LOGD(TAG, "The partition size is %ld KB", partition->size / 1024);
-        ESP_GOTO_ON_FALSE((storage_size > partition->size), ESP_ERR_INVALID_SIZE, err, TAG, "The free size is less than %s partition required", partition->label);
+        ESP_LOGD(TAG, "The assets size is %ld KB of a %ld KB partition", mmap_size / 1024, partition->size / 1024);
+        ESP_GOTO_ON_FALSE((storage_size > mmap_size), ESP_ERR_INVALID_SIZE, err, TAG, "The free size is less than %s partition required", partition->label);
 
         mmap_handle = (esp_partition_mmap_handle_t *)malloc(sizeof(esp_partition_mmap_handle_t));
-        ESP_GOTO_ON_ERROR(esp_partition_mmap(partition, 0, partition->size, ESP_PARTITION_MMAP_DATA, &root, mmap_handle), err, TAG, "esp_partition_mmap failed");
-
-        stored_files = *(int *)(root + ASSETS_FILE_NUM_OFFSET);
-        stored_chksum = *(uint32_t *)(root + ASSETS_CHECKSUM_OFFSET);
-        stored_len = *(uint32_t *)(root + ASSETS_TABLE_LEN);
+        ESP_GOTO_ON_FALSE(mmap_handle, ESP_ERR_NO_MEM, err, TAG, "no mem for mmap handle");
+        ret = esp_partition_mmap(partition, 0, mmap_size, ESP_PARTITION_MMAP_DATA, &root, mmap_handle);
+        if (ret != ESP_OK) {
+            free(mmap_handle);
+            mmap_handle = NULL;
+            ESP_LOGE(TAG, "esp_partition_mmap failed");
+            goto err;
+        }
 
         if (config->flags.full_check) {
             calculated_checksum = compute_checksum((uint8_t *)(root + ASSETS_TABLE_OFFSET), stored_len);
         }
     } else {
-        esp_partition_read(partition, ASSETS_FILE_NUM_OFFSET, &stored_files, sizeof(stored_files));
-        esp_partition_read(partition, ASSETS_CHECKSUM_OFFSET, &stored_chksum, sizeof(stored_chksum));
-        esp_partition_read(partition, ASSETS_TABLE_LEN, &stored_len, sizeof(stored_len));
+        if (map_asset->flags.mmap_window) {
+            map_asset->window.max_pages = config->mmap_window_pages ? config->mmap_window_pages : ASSETS_WINDOW_PAGES;
+            map_asset->window.map = calloc(map_asset->window.max_pages, sizeof(mmap_assets_window_t));
+            ESP_GOTO_ON_FALSE(map_asset->window.map, ESP_ERR_NO_MEM, err, TAG, "no mem for window");
+        } else if (ASSETS_CACHE_BLOCKS > 0) {
+            map_asset->cache.data = heap_caps_malloc(ASSETS_CACHE_BLOCKS * ASSETS_CACHE_BLOCK_SIZE, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+            ESP_GOTO_ON_FALSE(map_asset->cache.data, ESP_ERR_NO_MEM, err, TAG, "no mem for read cache");
+            for (int i = 0; i < ASSETS_CACHE_BLOCKS; i++) {
+                map_asset->cache.block[i] = ASSETS_CACHE_EMPTY;
+            }
+            map_asset->cache.last_miss = ASSETS_CACHE_EMPTY;
+        }
 
         if (config->flags.full_check) {
             uint32_t read_offset = ASSETS_TABLE_OFFSET;
@@ -142,10 +391,10 @@ esp_err_t mmap_assets_new(const mmap_assets_config_t *config, mmap_assets_handle
 
     map_asset->stored_files = stored_files;
 
-    item = (mmap_assets_item_t *)malloc(sizeof(mmap_assets_item_t) * config->max_files);
+    item = (mmap_assets_item_t *)calloc(config->max_files, sizeof(mmap_assets_item_t));
     ESP_GOTO_ON_FALSE(item, ESP_ERR_NO_MEM, err, TAG, "no mem for asset item");
 
-    if (map_asset->flags.mmap_enable) {
+    if (assets_mapped(map_asset)) {
         mmap_assets_table_t *table = (mmap_assets_table_t *)(root + ASSETS_TABLE_OFFSET);
         for (int i = 0; i < config->max_files; i++) {
             (item + i)->table = (table + i);
@@ -170,7 +419,7 @@ esp_err_t mmap_assets_new(const mmap_assets_config_t *config, mmap_assets_handle
 
         if (config->flags.metadata_check) {
             uint16_t magic_data, *magic_ptr = NULL;
-            if (map_asset->flags.mmap_enable) {
+            if (assets_mapped(map_asset)) {
                 magic_ptr = (uint16_t *)(item + i)->asset_mem;
             } else {
                 esp_partition_read(map_asset->partition, (int)(item + i)->asset_mem, &magic_data, ASSETS_FILE_MAGIC_LEN);
@@ -181,9 +430,28 @@ esp_err_t mmap_assets_new(const mmap_assets_config_t *config, mmap_assets_handle
         }
     }
 
+    if (map_asset->flags.mmap_window && stored_files > 0 && stored_files <= config->max_files) {
+        /* Split images read their shared splits from the pool, outside the pages mapped for them */
+        const mmap_assets_item_t *last = item + stored_files - 1;
+        char magic[ASSETS_SPLIT_POOL_MAGIC_LEN] = {0};
+        if (last->table->asset_size >= sizeof(magic)) {
+            esp_partition_read(partition, (int)last->asset_mem + ASSETS_FILE_MAGIC_LEN, magic, sizeof(magic));
+        }
+        ESP_GOTO_ON_FALSE(memcmp(magic, ASSETS_SPLIT_POOL_MAGIC, sizeof(magic)) != 0, ESP_ERR_NOT_SUPPORTED, err, TAG,
+                          "\"%s\" has splits shared by MMAP_SPLIT_DEDUP, they need mmap without a window", partition->label);
+    }
+
     map_asset->mmap_handle = mmap_handle;
     map_asset->item = item;
     map_asset->max_asset = config->max_files;
+    ESP_GOTO_ON_ERROR(load_name_index(map_asset, stored_len, config->max_files * sizeof(mmap_assets_table_t)), err, TAG, "load name index failed");
+
+    if (config->flags.background_check) {
+        map_asset->verify.done = xSemaphoreCreateBinary();
+        ESP_GOTO_ON_FALSE(map_asset->verify.done, ESP_ERR_NO_MEM, err, TAG, "no mem for background check");
+        ESP_GOTO_ON_FALSE(xTaskCreate(verify_task, "assets_verify", ASSETS_VERIFY_TASK_STACK, map_asset, ASSETS_VERIFY_TASK_PRIORITY, NULL) == pdPASS,
+                          ESP_ERR_NO_MEM, err, TAG, "no mem for background check task");
+    }
     *ret_item = (mmap_assets_handle_t)map_asset;
 
     ESP_LOGD(TAG, "new asset handle:@%p", map_asset);
@@ -195,7 +463,7 @@ esp_err_t mmap_assets_new(const mmap_assets_config_t *config, mmap_assets_handle
 
 err:
     if (item) {
-        if (false == map_asset->flags.mmap_enable) {
+        if (!assets_mapped(map_asset)) {
             free((void *)(item + 0)->table);
         }
         free(item);
@@ -207,6 +475,18 @@ err:
     }
 
     if (map_asset) {
+        if (map_asset->verify.done) {
+            vSemaphoreDelete(map_asset->verify.done);
+        }
+        free(map_asset->name_index);
+        if (map_asset->lock) {
+            vSemaphoreDelete(map_asset->lock);
+        }
+        if (map_asset->verify.lock) {
+            vSemaphoreDelete(map_asset->verify.lock);
+        }
+        free(map_asset->cache.data);
+        free(map_asset->window.map);
         free(map_asset);
     }
 
@@ -218,18 +498,46 @@ esp_err_t mmap_assets_del(mmap_assets_handle_t handle)
     ESP_RETURN_ON_FALSE(handle, ESP_ERR_INVALID_ARG, TAG, "handle is invalid");
     mmap_assets_t *map_asset = (mmap_assets_t *)(handle);
 
+    if (map_asset->prefetch.queue) {
+        /* Requests queued before are still prefetched */
+        const prefetch_request_t *stop = NULL;
+        xQueueSend(map_asset->prefetch.queue, &stop, portMAX_DELAY);
+        xSemaphoreTake(map_asset->prefetch.done, portMAX_DELAY);
+        vQueueDelete(map_asset->prefetch.queue);
+        vSemaphoreDelete(map_asset->prefetch.done);
+    }
+
+    if (map_asset->verify.done) {
+        map_asset->verify.stop = true;
+        xSemaphoreTake(map_asset->verify.done, portMAX_DELAY);
+        vSemaphoreDelete(map_asset->verify.done);
+    }
+
     if (map_asset->mmap_handle) {
         esp_partition_munmap(*(map_asset->mmap_handle));
         free(map_asset->mmap_handle);
     }
 
     if (map_asset->item) {
-        if (false == map_asset->flags.mmap_enable) {
+        if (!assets_mapped(map_asset)) {
             free((void *)(map_asset->item + 0)->table);
         }
         free(map_asset->item);
     }
 
+    free(map_asset->name_index);
+    free(map_asset->cache.data);
+    for (int i = 0; i < map_asset->window.max_pages; i++) {
+        if (map_asset->window.map[i].pages) {
+            esp_partition_munmap(map_asset->window.map[i].handle);
+        }
+    }
+    free(map_asset->window.map);
+    vSemaphoreDelete(map_asset->lock);
+    if (map_asset->verify.lock) {
+        vSemaphoreDelete(map_asset->verify.lock);
+    }
+
     if (map_asset) {
         free(map_asset);
     }
@@ -245,6 +553,111 @@ int mmap_assets_get_stored_files(mmap_assets_handle_t handle)
     return map_asset->stored_files;
 }
 
+static int cache_lookup(mmap_assets_t *map_asset, uint32_t block)
+{
+    for (int i = 0; i < ASSETS_CACHE_BLOCKS; i++) {
+        if (map_asset->cache.block[i] == block) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/*
+ * Read `count` blocks from flash into the least recently used slots, a pair of
+ * adjacent slots for two blocks so they are read at once
+ */
+static int cache_fill(mmap_assets_t *map_asset, uint32_t block, int count)
+{
+    int slot = 0;
+    uint32_t oldest = UINT32_MAX;
+    for (int i = 0; i + count <= ASSETS_CACHE_BLOCKS; i++) {
+        uint32_t last_use = map_asset->cache.last_use[i];
+        if (count > 1 && map_asset->cache.last_use[i + 1] > last_use) {
+            last_use = map_asset->cache.last_use[i + 1];
+        }
+        if (last_use < oldest) {
+            oldest = last_use;
+            slot = i;
+        }
+    }
+
+    uint32_t offset = block * ASSETS_CACHE_BLOCK_SIZE;
+    uint32_t len = count * ASSETS_CACHE_BLOCK_SIZE;
+    if (len > map_asset->partition->size - offset) {
+        len = map_asset->partition->size - offset;
+    }
+    for (int i = 0; i < count; i++) {
+        map_asset->cache.block[slot + i] = ASSETS_CACHE_EMPTY;
+    }
+    if (esp_partition_read(map_asset->partition, offset, map_asset->cache.data + slot * ASSETS_CACHE_BLOCK_SIZE, len) != ESP_OK) {
+        return -1;
+    }
+    map_asset->cache.stats.flash_reads++;
+    map_asset->cache.stats.flash_bytes += len;
+    for (int i = 0; i < count; i++) {
+        map_asset->cache.block[slot + i] = block + i;
+        map_asset->cache.last_use[slot + i] = ++map_asset->cache.use_count;
+    }
+    map_asset->cache.last_miss = block + count - 1;
+    return slot;
+}
+
+/*
+ * Read through the block cache. Reads of whole blocks that aren't cached go
+ * straight to the destination, a miss on the block after the last one read
+ * from flash also reads the next block.
+ */
+static esp_err_t cache_read(mmap_assets_t *map_asset, uint32_t offset, uint8_t *dest, uint32_t size)
+{
+    const uint32_t blocks = (map_asset->partition->size + ASSETS_CACHE_BLOCK_SIZE - 1) / ASSETS_CACHE_BLOCK_SIZE;
+    esp_err_t ret = ESP_OK;
+
+    xSemaphoreTake(map_asset->lock, portMAX_DELAY);
+    while (size > 0) {
+        uint32_t block = offset / ASSETS_CACHE_BLOCK_SIZE;
+        uint32_t in_block = offset % ASSETS_CACHE_BLOCK_SIZE;
+        int slot = cache_lookup(map_asset, block);
+
+        if (slot < 0 && in_block == 0 && size >= ASSETS_CACHE_BLOCK_SIZE) {
+            uint32_t len = size - size % ASSETS_CACHE_BLOCK_SIZE;
+            ESP_GOTO_ON_ERROR(esp_partition_read(map_asset->partition, offset, dest, len), err, TAG, "esp_partition_read failed");
+            map_asset->cache.stats.misses += len / ASSETS_CACHE_BLOCK_SIZE;
+            map_asset->cache.stats.flash_reads++;
+            map_asset->cache.stats.flash_bytes += len;
+            map_asset->cache.last_miss = block + len / ASSETS_CACHE_BLOCK_SIZE - 1;
+            offset += len;
+            dest += len;
+            size -= len;
+            continue;
+        }
+
+        if (slot >= 0) {
+            map_asset->cache.stats.hits++;
+            map_asset->cache.last_use[slot] = ++map_asset->cache.use_count;
+        } else {
+            bool sequential = block == map_asset->cache.last_miss + 1;
+            int count = (sequential && ASSETS_CACHE_BLOCKS > 1 && block + 1 < blocks && cache_lookup(map_asset, block + 1) < 0) ? 2 : 1;
+            slot = cache_fill(map_asset, block, count);
+            ESP_GOTO_ON_FALSE(slot >= 0, ESP_FAIL, err, TAG, "esp_partition_read failed");
+            map_asset->cache.stats.misses++;
+        }
+
+        uint32_t len = ASSETS_CACHE_BLOCK_SIZE - in_block;
+        if (len > size) {
+            len = size;
+        }
+        memcpy(dest, map_asset->cache.data + slot * ASSETS_CACHE_BLOCK_SIZE + in_block, len);
+        offset += len;
+        dest += len;
+        size -= len;
+    }
+
+err:
+    xSemaphoreGive(map_asset->lock);
+    return ret;
+}
+
 size_t mmap_assets_copy_mem(mmap_assets_handle_t handle, size_t offset, void *dest_buffer, size_t size)
 {
     assert(handle && "handle is invalid");
@@ -253,21 +666,128 @@ size_t mmap_assets_copy_mem(mmap_assets_handle_t handle, size_t offset, void *de
     if (true == map_asset->flags.mmap_enable) {
         memcpy(dest_buffer, (void *)offset, size);
         return size;
-    } else if (offset) {
-        esp_partition_read(map_asset->partition, offset, dest_buffer, size);
-        return size;
+    } else if (offset && offset <= map_asset->partition->size && size <= map_asset->partition->size - offset) {
+        if (map_asset->cache.data) {
+            return cache_read(map_asset, offset, dest_buffer, size) == ESP_OK ? size : 0;
+        }
+        return esp_partition_read(map_asset->partition, offset, dest_buffer, size) == ESP_OK ? size : 0;
     } else {
         ESP_LOGE(TAG, "Invalid offset: %zu.", offset);
         return 0;
     }
 }
 
+esp_err_t mmap_assets_get_cache_stats(mmap_assets_handle_t handle, mmap_assets_cache_stats_t *stats)
+{
+    ESP_RETURN_ON_FALSE(handle && stats, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    mmap_assets_t *map_asset = (mmap_assets_t *)(handle);
+
+    xSemaphoreTake(map_asset->lock, portMAX_DELAY);
+    *stats = map_asset->cache.stats;
+    xSemaphoreGive(map_asset->lock);
+    return ESP_OK;
+}
+
+/* Unmap the least recently used mapping without pinned assets */
+static bool window_evict(mmap_assets_t *map_asset)
+{
+    mmap_assets_window_t *oldest = NULL;
+    for (int i = 0; i < map_asset->window.max_pages; i++) {
+        mmap_assets_window_t *w = &map_asset->window.map[i];
+        if (w->pages && !w->pins && (!oldest || w->last_use < oldest->last_use)) {
+            oldest = w;
+        }
+    }
+    if (!oldest) {
+        return false;
+    }
+
+    esp_partition_munmap(oldest->handle);
+    map_asset->window.pages -= oldest->pages;
+    oldest->pages = 0;
+    return true;
+}
+
+/* Find or map the pages holding partition offsets [start, end) */
+static int window_map(mmap_assets_t *map_asset, uint32_t start, uint32_t end)
+{
+    for (int i = 0; i < map_asset->window.max_pages; i++) {
+        mmap_assets_window_t *w = &map_asset->window.map[i];
+        if (w->pages && w->offset <= start && end <= w->offset + w->len) {
+            return i;
+        }
+    }
+
+    /* Pages are counted from the start of the flash, as the MMU maps them */
+    const esp_partition_t *partition = map_asset->partition;
+    uint32_t first = (partition->address + start) / ASSETS_MMU_PAGE_SIZE;
+    uint32_t last = (partition->address + end - 1) / ASSETS_MMU_PAGE_SIZE;
+    int pages = last - first + 1;
+    ESP_RETURN_ON_FALSE(pages <= map_asset->window.max_pages, -1, TAG, "%d pages don't fit in a window of %d pages",
+                        pages, map_asset->window.max_pages);
+
+    uint32_t offset = first * ASSETS_MMU_PAGE_SIZE > partition->address ? first * ASSETS_MMU_PAGE_SIZE - partition->address : 0;
+    uint32_t len = MIN((last + 1) * ASSETS_MMU_PAGE_SIZE - partition->address, partition->size) - offset;
+    while (true) {
+        if (map_asset->window.pages + pages > map_asset->window.max_pages && window_evict(map_asset)) {
+            continue;
+        }
+        ESP_RETURN_ON_FALSE(map_asset->window.pages + pages <= map_asset->window.max_pages, -1, TAG,
+                            "window of %d pages is pinned", map_asset->window.max_pages);
+
+        /* Each mapping has at least one page, so a slot is free */
+        int slot = 0;
+        while (map_asset->window.map[slot].pages) {
+            slot++;
+        }
+        mmap_assets_window_t *w = &map_asset->window.map[slot];
+        const void *mem = NULL;
+        if (esp_partition_mmap(partition, offset, len, ESP_PARTITION_MMAP_DATA, &mem, &w->handle) != ESP_OK) {
+            /* Out of MMU pages, give back one of ours */
+            ESP_RETURN_ON_FALSE(window_evict(map_asset), -1, TAG, "esp_partition_mmap failed");
+            continue;
+        }
+        w->mem = mem;
+        w->offset = offset;
+        w->len = len;
+        w->pages = pages;
+        w->pins = 0;
+        map_asset->window.pages += pages;
+        return slot;
+    }
+}
+
+static const uint8_t *window_pin(mmap_assets_t *map_asset, int index)
+{
+    mmap_assets_item_t *item = map_asset->item + index;
+    const uint8_t *mem = NULL;
+
+    xSemaphoreTake(map_asset->lock, portMAX_DELAY);
+    if (item->pins == 0) {
+        uint32_t start = (uint32_t)item->asset_mem;
+        item->window = window_map(map_asset, start, start + ASSETS_FILE_MAGIC_LEN + item->table->asset_size);
+    }
+    if (item->window >= 0) {
+        mmap_assets_window_t *w = &map_asset->window.map[item->window];
+        w->pins++;
+        w->last_use = ++map_asset->window.use_count;
+        item->pins++;
+        mem = w->mem + ((uint32_t)item->asset_mem - w->offset) + ASSETS_FILE_MAGIC_LEN;
+    }
+    xSemaphoreGive(map_asset->lock);
+    return mem;
+}
+
 const uint8_t *mmap_assets_get_mem(mmap_assets_handle_t handle, int index)
 {
     assert(handle && "handle is invalid");
     mmap_assets_t *map_asset = (mmap_assets_t *)(handle);
 
-    if (map_asset->max_asset > index) {
+    if (map_asset->max_asset > index && map_asset->flags.lazy_check && verify_asset(map_asset, index) != ESP_OK) {
+        return NULL;
+    } else if (map_asset->max_asset > index && map_asset->flags.mmap_window) {
+        return window_pin(map_asset, index);
+    } else if (map_asset->max_asset > index) {
         return (const uint8_t *)((map_asset->item + index)->asset_mem + ASSETS_FILE_MAGIC_LEN);
     } else {
         ESP_LOGE(TAG, "Invalid index: %d. Maximum index is %d.", index, map_asset->max_asset);
@@ -275,6 +795,238 @@ const uint8_t *mmap_assets_get_mem(mmap_assets_handle_t handle, int index)
     }
 }
 
+esp_err_t mmap_assets_release(mmap_assets_handle_t handle, int index)
+{
+    ESP_RETURN_ON_FALSE(handle, ESP_ERR_INVALID_ARG, TAG, "handle is invalid");
+    mmap_assets_t *map_asset = (mmap_assets_t *)(handle);
+    ESP_RETURN_ON_FALSE(index >= 0 && index < map_asset->max_asset, ESP_ERR_INVALID_ARG, TAG, "Invalid index: %d", index);
+
+    if (!map_asset->flags.mmap_window) {
+        return ESP_OK;
+    }
+
+    esp_err_t ret = ESP_OK;
+    mmap_assets_item_t *item = map_asset->item + index;
+    xSemaphoreTake(map_asset->lock, portMAX_DELAY);
+    if (item->pins) {
+        map_asset->window.map[item->window].pins--;
+        if (--item->pins == 0) {
+            item->window = -1;
+        }
+    } else {
+        ESP_LOGE(TAG, "(%s) is not pinned", item->table->asset_name);
+        ret = ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreGive(map_asset->lock);
+    return ret;
+}
+
+esp_err_t mmap_assets_verify(mmap_assets_handle_t handle, int index)
+{
+    ESP_RETURN_ON_FALSE(handle, ESP_ERR_INVALID_ARG, TAG, "handle is invalid");
+    mmap_assets_t *map_asset = (mmap_assets_t *)(handle);
+    ESP_RETURN_ON_FALSE(index >= 0 && index < map_asset->max_asset, ESP_ERR_INVALID_ARG, TAG, "Invalid index: %d", index);
+
+    return verify_asset(map_asset, index);
+}
+
+esp_err_t mmap_assets_wait_verified(mmap_assets_handle_t handle, uint32_t timeout_ms)
+{
+    ESP_RETURN_ON_FALSE(handle, ESP_ERR_INVALID_ARG, TAG, "handle is invalid");
+    mmap_assets_t *map_asset = (mmap_assets_t *)(handle);
+    ESP_RETURN_ON_FALSE(map_asset->verify.done, ESP_ERR_INVALID_STATE, TAG, "no background check");
+
+    if (xSemaphoreTake(map_asset->verify.done, pdMS_TO_TICKS(timeout_ms)) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+    xSemaphoreGive(map_asset->verify.done);
+    return map_asset->verify.bad ? ESP_ERR_INVALID_CRC : ESP_OK;
+}
+
+/* Read flash into the block cache, as many blocks of the range as the cache holds */
+static uint32_t cache_prefetch(mmap_assets_t *map_asset, uint32_t offset, uint32_t size)
+{
+    uint32_t first = offset / ASSETS_CACHE_BLOCK_SIZE;
+    uint32_t last = MIN((offset + size - 1) / ASSETS_CACHE_BLOCK_SIZE, first + ASSETS_CACHE_BLOCKS - 1);
+    uint32_t bytes = 0;
+
+    xSemaphoreTake(map_asset->lock, portMAX_DELAY);
+    for (uint32_t block = first; block <= last; block++) {
+        if (cache_lookup(map_asset, block) >= 0) {
+            continue;
+        }
+        int count = (block < last && cache_lookup(map_asset, block + 1) < 0) ? 2 : 1;
+        if (cache_fill(map_asset, block, count) < 0) {
+            break;
+        }
+        /* The last block of the partition is read up to its end */
+        bytes += MIN(count * ASSETS_CACHE_BLOCK_SIZE, map_asset->partition->size - block * ASSETS_CACHE_BLOCK_SIZE);
+        block += count - 1;
+    }
+    xSemaphoreGive(map_asset->lock);
+    return bytes;
+}
+
+/* Read a byte of each cache line, so the flash cache holds the asset */
+static uint32_t touch_mem(const uint8_t *mem, uint32_t size)
+{
+    volatile const uint8_t *p = mem;
+    for (uint32_t i = 0; i < size; i += ASSETS_PREFETCH_STRIDE) {
+        (void)p[i];
+    }
+    return size;
+}
+
+static uint32_t prefetch_asset(mmap_assets_t *map_asset, int index)
+{
+    mmap_assets_item_t *item = map_asset->item + index;
+    uint32_t size = item->table->asset_size + ASSETS_FILE_MAGIC_LEN;
+
+    if (assets_mapped(map_asset)) {
+        return touch_mem((const uint8_t *)item->asset_mem, size);
+    } else if (map_asset->flags.mmap_window) {
+        /* Maps the pages of the asset, they stay mapped until they're the least recently used */
+        const uint8_t *mem = window_pin(map_asset, index);
+        if (!mem) {
+            return 0;
+        }
+        uint32_t bytes = touch_mem(mem, size - ASSETS_FILE_MAGIC_LEN);
+        mmap_assets_release((mmap_assets_handle_t)map_asset, index);
+        return bytes;
+    } else if (map_asset->cache.data) {
+        return cache_prefetch(map_asset, (uint32_t)item->asset_mem, size);
+    }
+    return 0;
+}
+
+static void prefetch_task(void *arg)
+{
+    mmap_assets_t *map_asset = (mmap_assets_t *)arg;
+    prefetch_request_t *request = NULL;
+
+    /* A NULL request from mmap_assets_del() ends the task */
+    while (xQueueReceive(map_asset->prefetch.queue, &request, portMAX_DELAY) == pdTRUE && request) {
+        uint64_t bytes = 0;
+        for (int i = 0; i < request->count; i++) {
+            bytes += prefetch_asset(map_asset, request->index[i]);
+        }
+
+        xSemaphoreTake(map_asset->lock, portMAX_DELAY);
+        map_asset->prefetch.stats.requests++;
+        map_asset->prefetch.stats.assets += request->count;
+        map_asset->prefetch.stats.bytes += bytes;
+        xSemaphoreGive(map_asset->lock);
+
+        if (request->done_cb) {
+            request->done_cb((mmap_assets_handle_t)map_asset, request->user_ctx);
+        }
+        free(request);
+    }
+
+    xSemaphoreGive(map_asset->prefetch.done);
+    vTaskDelete(NULL);
+}
+
+/* Start the prefetch task on the first request */
+static esp_err_t prefetch_start(mmap_assets_t *map_asset)
+{
+    esp_err_t ret = ESP_OK;
+
+    xSemaphoreTake(map_asset->lock, portMAX_DELAY);
+    if (!map_asset->prefetch.queue) {
+        map_asset->prefetch.done = xSemaphoreCreateBinary();
+        ESP_GOTO_ON_FALSE(map_asset->prefetch.done, ESP_ERR_NO_MEM, err, TAG, "no mem for prefetch");
+        map_asset->prefetch.queue = xQueueCreate(ASSETS_PREFETCH_QUEUE_LEN, sizeof(prefetch_request_t *));
+        ESP_GOTO_ON_FALSE(map_asset->prefetch.queue, ESP_ERR_NO_MEM, err, TAG, "no mem for prefetch queue");
+        ESP_GOTO_ON_FALSE(xTaskCreate(prefetch_task, "assets_prefetch", ASSETS_PREFETCH_TASK_STACK, map_asset, ASSETS_PREFETCH_TASK_PRIORITY, NULL) == pdPASS,
+                          ESP_ERR_NO_MEM, err, TAG, "no mem for prefetch task");
+    }
+    xSemaphoreGive(map_asset->lock);
+    return ESP_OK;
+
+err:
+    if (map_asset->prefetch.queue) {
+        vQueueDelete(map_asset->prefetch.queue);
+        map_asset->prefetch.queue = NULL;
+    }
+    if (map_asset->prefetch.done) {
+        vSemaphoreDelete(map_asset->prefetch.done);
+        map_asset->prefetch.done = NULL;
+    }
+    xSemaphoreGive(map_asset->lock);
+    return ret;
+}
+
+esp_err_t mmap_assets_prefetch(mmap_assets_handle_t handle, const int *index_list, int count, mmap_assets_prefetch_cb_t done_cb, void *user_ctx)
+{
+    ESP_RETURN_ON_FALSE(handle && index_list && count > 0, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    mmap_assets_t *map_asset = (mmap_assets_t *)(handle);
+    for (int i = 0; i < count; i++) {
+        ESP_RETURN_ON_FALSE(index_list[i] >= 0 && index_list[i] < map_asset->max_asset, ESP_ERR_INVALID_ARG, TAG, "Invalid index: %d", index_list[i]);
+    }
+
+    ESP_RETURN_ON_ERROR(prefetch_start(map_asset), TAG, "start prefetch failed");
+
+    prefetch_request_t *request = malloc(sizeof(prefetch_request_t) + count * sizeof(int));
+    ESP_RETURN_ON_FALSE(request, ESP_ERR_NO_MEM, TAG, "no mem for prefetch request");
+    request->done_cb = done_cb;
+    request->user_ctx = user_ctx;
+    request->count = count;
+    memcpy(request->index, index_list, count * sizeof(int));
+
+    if (xQueueSend(map_asset->prefetch.queue, &request, 0) != pdTRUE) {
+        free(request);
+        xSemaphoreTake(map_asset->lock, portMAX_DELAY);
+        map_asset->prefetch.stats.dropped++;
+        xSemaphoreGive(map_asset->lock);
+        ESP_LOGD(TAG, "prefetch queue is full");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+esp_err_t mmap_assets_get_prefetch_stats(mmap_assets_handle_t handle, mmap_assets_prefetch_stats_t *stats)
+{
+    ESP_RETURN_ON_FALSE(handle && stats, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    mmap_assets_t *map_asset = (mmap_assets_t *)(handle);
+
+    xSemaphoreTake(map_asset->lock, portMAX_DELAY);
+    *stats = map_asset->prefetch.stats;
+    xSemaphoreGive(map_asset->lock);
+    return ESP_OK;
+}
+
+int mmap_assets_find(mmap_assets_handle_t handle, const char *name)
+{
+    assert(handle && "handle is invalid");
+    mmap_assets_t *map_asset = (mmap_assets_t *)(handle);
+
+    if (!name) {
+        return -1;
+    }
+
+    /* Stored names are truncated to CONFIG_MMAP_FILE_NAME_LENGTH, longer names can't match */
+    bool too_long = strnlen(name, CONFIG_MMAP_FILE_NAME_LENGTH + 1) > CONFIG_MMAP_FILE_NAME_LENGTH;
+    int low = 0;
+    int high = map_asset->max_asset - 1;
+    while (low <= high) {
+        int mid = low + (high - low) / 2;
+        int index = map_asset->name_index[mid];
+        int c = strncmp(name, (map_asset->item + index)->table->asset_name, CONFIG_MMAP_FILE_NAME_LENGTH);
+        if (c == 0 && !too_long) {
+            return index;
+        }
+        if (c < 0) {
+            high = mid - 1;
+        } else {
+            low = mid + 1;
+        }
+    }
+
+    ESP_LOGD(TAG, "Asset \"%s\" not found", name);
+    return -1;
+}
+
 const char * mmap_assets_get_name(mmap_assets_handle_t handle, int index)
 {
     assert(handle && "handle is invalid");
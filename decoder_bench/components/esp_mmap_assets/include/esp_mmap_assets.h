@@ -19,20 +19,52 @@ typedef struct {
     const char *partition_label;            /*!< Label of the partition containing the assets */
     int max_files;                          /*!< Maximum number of assets supported */
     uint32_t checksum;                      /*!< Checksum of the asset table for integrity verification */
+    int mmap_window_pages;                  /*!< With mmap_window, most MMU pages mapped at once, 0 for 4 */
     struct {
         unsigned int mmap_enable: 1;        /*!< Flag to indicate if memory-mapped I/O is enabled */
         unsigned int app_bin_check: 1;      /*!< Flag to enable app header and bin file consistency check */
         unsigned int full_check: 1;         /*!< Flag to enable self-consistency check */
         unsigned int metadata_check: 1;     /*!< Flag to enable metadata verification */
-        unsigned int reserved: 28;          /*!< Reserved for future use */
+        unsigned int mmap_window: 1;        /*!< Flag to map the pages of an asset on demand, needs mmap_enable */
+        unsigned int lazy_check: 1;         /*!< Flag to verify the CRC of an asset on its first mmap_assets_get_mem(), needs CONFIG_MMAP_ASSET_CRC */
+        unsigned int background_check: 1;   /*!< Flag to verify the CRC of all assets in a low priority task, needs CONFIG_MMAP_ASSET_CRC */
+        unsigned int reserved: 25;          /*!< Reserved for future use */
     } flags;                                /*!< Configuration flags */
 } mmap_assets_config_t;
 
+/**
+ * @brief Read cache statistics, counted in CONFIG_MMAP_READ_CACHE_BLOCK_SIZE blocks.
+ */
+typedef struct {
+    uint32_t hits;                          /*!< Blocks copied from the cache */
+    uint32_t misses;                        /*!< Blocks not in the cache when read */
+    uint32_t flash_reads;                   /*!< Number of flash reads, a read-ahead reads two blocks at once */
+    uint64_t flash_bytes;                   /*!< Bytes read from flash */
+} mmap_assets_cache_stats_t;
+
+/**
+ * @brief Prefetch statistics.
+ */
+typedef struct {
+    uint32_t requests;                      /*!< Requests done */
+    uint32_t assets;                        /*!< Assets prefetched */
+    uint64_t bytes;                         /*!< Bytes touched in the flash cache or read into the read cache */
+    uint32_t dropped;                       /*!< Requests refused because the queue was full */
+} mmap_assets_prefetch_stats_t;
+
 /**
  * @brief Asset handle type, points to the asset.
  */
 typedef struct mmap_assets_t *mmap_assets_handle_t;       /*!< Type of asset handle */
 
+/**
+ * @brief Called by the prefetch task when the assets of a request are prefetched.
+ *
+ * @param[in] handle   Asset instance handle.
+ * @param[in] user_ctx User context passed to mmap_assets_prefetch().
+ */
+typedef void (*mmap_assets_prefetch_cb_t)(mmap_assets_handle_t handle, void *user_ctx);
+
 /**
  * @brief Create a new asset instance.
  *
@@ -45,12 +77,16 @@ typedef struct mmap_assets_t *mmap_assets_handle_t;       /*!< Type of asset han
  *     - ESP_ERR_NOT_FOUND: Can't find partition
  *     - ESP_ERR_INVALID_SIZE: File num mismatch
  *     - ESP_ERR_INVALID_CRC: Checksum mismatch
+ *     - ESP_ERR_NOT_SUPPORTED: lazy_check or background_check without CONFIG_MMAP_ASSET_CRC, or mmap_window
+ *       with splits shared between images by CONFIG_MMAP_SPLIT_DEDUP
  */
 esp_err_t mmap_assets_new(const mmap_assets_config_t *config, mmap_assets_handle_t *ret_item);
 
 /**
  * @brief Delete an asset instance.
  *
+ * Waits for queued prefetch requests and stops the background check.
+ *
  * @param[in] handle Asset instance handle.
  *
  * @return
@@ -62,13 +98,35 @@ esp_err_t mmap_assets_del(mmap_assets_handle_t handle);
 /**
  * @brief Get the memory of the asset at the specified index.
  *
+ * With mmap_window, the MMU pages holding the asset are mapped if they aren't
+ * yet, and the asset is pinned: its pages stay mapped until every call is
+ * matched by mmap_assets_release(). Pages without pinned assets are unmapped,
+ * least recently used first, when more than mmap_window_pages would be mapped.
+ *
  * @param[in] handle Asset instance handle.
  * @param[in] index  Index of the asset.
  *
- * @return Pointer to the asset memory, or NULL if index is invalid.
+ * @return Pointer to the asset memory, or NULL if index is invalid, with
+ *         lazy_check if the CRC of the asset is bad or, with mmap_window, if the
+ *         pinned assets leave no room to map the asset.
  */
 const uint8_t *mmap_assets_get_mem(mmap_assets_handle_t handle, int index);
 
+/**
+ * @brief Release an asset pinned by mmap_assets_get_mem().
+ *
+ * Without mmap_window, assets are always mapped and this does nothing.
+ *
+ * @param[in] handle Asset instance handle.
+ * @param[in] index  Index of the asset.
+ *
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: Invalid argument
+ *     - ESP_ERR_INVALID_STATE: The asset is not pinned
+ */
+esp_err_t mmap_assets_release(mmap_assets_handle_t handle, int index);
+
 /**
  * @brief Copy a portion of an asset's memory to a destination buffer.
  *
@@ -81,6 +139,99 @@ const uint8_t *mmap_assets_get_mem(mmap_assets_handle_t handle, int index);
  */
 size_t mmap_assets_copy_mem(mmap_assets_handle_t handle, size_t offset, void *dest_buffer, size_t size);
 
+/**
+ * @brief Get the statistics of the read cache.
+ *
+ * Without mmap_enable, mmap_assets_copy_mem() reads through a cache of
+ * CONFIG_MMAP_READ_CACHE_BLOCKS blocks. With mmap_enable, or without a cache,
+ * all counters stay 0.
+ *
+ * @param[in]  handle Asset instance handle.
+ * @param[out] stats  Filled with the statistics since mmap_assets_new().
+ *
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: Invalid argument
+ */
+esp_err_t mmap_assets_get_cache_stats(mmap_assets_handle_t handle, mmap_assets_cache_stats_t *stats);
+
+/**
+ * @brief Verify the CRC32 of an asset.
+ *
+ * The asset is read once, later calls return the same result. lazy_check and
+ * background_check verify assets the same way.
+ *
+ * @param[in] handle Asset instance handle.
+ * @param[in] index  Index of the asset.
+ *
+ * @return
+ *     - ESP_OK: The asset matches its CRC
+ *     - ESP_ERR_INVALID_CRC: The asset doesn't match its CRC
+ *     - ESP_ERR_INVALID_ARG: Invalid argument
+ *     - ESP_ERR_NOT_SUPPORTED: CONFIG_MMAP_ASSET_CRC is disabled
+ */
+esp_err_t mmap_assets_verify(mmap_assets_handle_t handle, int index);
+
+/**
+ * @brief Wait for the background check of all assets to end.
+ *
+ * @param[in] handle     Asset instance handle.
+ * @param[in] timeout_ms Longest time to wait.
+ *
+ * @return
+ *     - ESP_OK: All assets match their CRC
+ *     - ESP_ERR_INVALID_CRC: Some assets don't match their CRC
+ *     - ESP_ERR_TIMEOUT: The check hasn't ended yet
+ *     - ESP_ERR_INVALID_ARG: Invalid argument
+ *     - ESP_ERR_INVALID_STATE: The handle was created without background_check
+ */
+esp_err_t mmap_assets_wait_verified(mmap_assets_handle_t handle, uint32_t timeout_ms);
+
+/**
+ * @brief Prefetch assets in a low priority task, e.g. the next frames of an animation while the current one is flushed.
+ *
+ * Assets mapped at once are read a cache line at a time into the flash cache. With mmap_window, the
+ * pages of the assets are mapped too. Without mmap_enable, the first CONFIG_MMAP_READ_CACHE_BLOCKS
+ * blocks of the assets are read into the read cache. The task is started by the first request and
+ * takes up to 4 queued requests.
+ *
+ * @param[in] handle     Asset instance handle.
+ * @param[in] index_list Indexes of the assets, copied.
+ * @param[in] count      Number of indexes.
+ * @param[in] done_cb    Called from the prefetch task when the assets are prefetched, may be NULL.
+ * @param[in] user_ctx   Passed to done_cb.
+ *
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: Invalid argument
+ *     - ESP_ERR_NO_MEM: The queue is full, or out of memory
+ */
+esp_err_t mmap_assets_prefetch(mmap_assets_handle_t handle, const int *index_list, int count, mmap_assets_prefetch_cb_t done_cb, void *user_ctx);
+
+/**
+ * @brief Get the statistics of the prefetch task.
+ *
+ * @param[in]  handle Asset instance handle.
+ * @param[out] stats  Filled with the statistics since mmap_assets_new().
+ *
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: Invalid argument
+ */
+esp_err_t mmap_assets_get_prefetch_stats(mmap_assets_handle_t handle, mmap_assets_prefetch_stats_t *stats);
+
+/**
+ * @brief Find an asset by name.
+ *
+ * Binary search over a name index, taken from the partition or sorted in mmap_assets_new().
+ *
+ * @param[in] handle Asset instance handle.
+ * @param[in] name   Name of the asset, e.g. "bg.sqoi".
+ *
+ * @return Index of the asset, or -1 if there is no asset with this name.
+ */
+int mmap_assets_find(mmap_assets_handle_t handle, const char *name);
+
 /**
  * @brief Get the name of the asset at the specified index.
  *
@@ -3,21 +3,67 @@
 import io
 import os
 import argparse
+import html
+import json
+import hashlib
 import shutil
 import math
+import re
 import sys
 import time
+import zlib
 import qoi
 import numpy as np
 
 sys.dont_write_bytecode = True
 
 from PIL import Image
+from concurrent.futures import ProcessPoolExecutor
 from datetime import datetime
 from qoi import QOIColorSpace
 
 header_file = 'assets_generate.h'
 
+QOI_SEEK_ENTRY_SIZE = 4 + 4 + 4 + 64 * 4
+
+# Split image V2 header fields, same values as split_image.h
+SPLIT_FORMATS = {'.jpg': 1, '.png': 2, '.qoi': 3, '.raw': 4}
+SPLIT_PIXEL_FORMATS = {'RGB': 3, 'RGBA': 4, 'RGB565': 0x12, 'RGB565A8': 0x13, 'RGB565_SWAP': 0x22, 'RGB565A8_SWAP': 0x23}
+SPLIT_HEADER_SIZE_V2 = 28
+SPLIT_HEADER_SIZE_V3 = 32
+SPLIT_MAGICS = (b'_SJPG__', b'_SPNG__', b'_SQOI__', b'_SRAW__')
+
+# Split heights tried by choose_split_height(), plus the image height itself
+SPLIT_HEIGHT_CANDIDATES = (1, 2, 4, 8, 12, 16, 24, 32, 48, 64, 96, 128, 192, 256)
+
+# Bytes of frame cache per pixel, the largest the split decoders allocate
+SPLIT_CACHE_BPP = 4
+
+# Decode cost charged per pixel a redraw decodes without showing it, in bytes of flash
+SPLIT_DECODE_COST = 0.25
+
+# Animation container, see anim_image.h of esp_lv_sqoi
+ANIM_HEADER_SIZE = 28
+
+# Unchanged columns that still join two changed ones into one patch
+ANIM_PATCH_GAP = 8
+
+# Dirty rectangles per frame, LVGL invalidates the whole screen past LV_INV_BUF_SIZE areas
+ANIM_MAX_DIRTY = 8
+
+# Trailer of the name index after the assets, see name_index()
+NAME_INDEX_MAGIC = b'NIDX'
+
+# Asset holding the splits shared between images with dedup, after all other assets
+SPLIT_POOL_NAME = 'split_pool.bin'
+SPLIT_POOL_MAGIC = b'_SPOOL_'
+
+# Assets flagged in each category of the build report
+REPORT_TOP = 5
+
+# Decodes per asset for the build report, the fastest one counts
+REPORT_DECODE_RUNS = 3
+
 def generate_header_filename(path):
     asset_name = os.path.basename(path)
 
@@ -29,39 +75,182 @@ def compute_checksum(data):
     return checksum
 
 def sort_key(filename):
+    """Orders the files of the partition by extension, then by name with numbers compared by value.
+
+    Files used together stay next to each other: frame2 comes before frame10, and .sraw
+    images sort with .sqoi images, as the QOI conversion picks either for each file.
+    """
     basename, extension = os.path.splitext(filename)
-    return extension, basename
+    natural = tuple(int(part) if i % 2 else part for i, part in enumerate(re.split(r'(\d+)', basename)))
+    return '.sqoi' if extension == '.sraw' else extension, natural, extension, basename
+
+def build_qoi_seek_table(qoi_data, interval):
+    """Builds the seek table appended to a QOI image, same layout as qoi_seek_build() in qoi.h."""
+    width = int.from_bytes(qoi_data[4:8], byteorder='big')
+    height = int.from_bytes(qoi_data[8:12], byteorder='big')
+    count = (height - 1) // interval
+
+    index = [(0, 0, 0, 0)] * 64
+    r, g, b, a = 0, 0, 0, 255
+    run = 0
+    p = 14
+    entries = bytearray()
 
-def split_image(im, block_size, input_dir, ext, convert_to_qoi):
-    """Splits the image into blocks based on the block size."""
+    for y in range(count * interval):
+        for _ in range(width):
+            if run > 0:
+                run -= 1
+                continue
+
+            b1 = qoi_data[p]
+            p += 1
+            if b1 == 0xfe:
+                r, g, b = qoi_data[p], qoi_data[p + 1], qoi_data[p + 2]
+                p += 3
+            elif b1 == 0xff:
+                r, g, b, a = qoi_data[p], qoi_data[p + 1], qoi_data[p + 2], qoi_data[p + 3]
+                p += 4
+            elif (b1 & 0xc0) == 0x00:
+                r, g, b, a = index[b1]
+            elif (b1 & 0xc0) == 0x40:
+                r = (r + ((b1 >> 4) & 0x03) - 2) & 0xff
+                g = (g + ((b1 >> 2) & 0x03) - 2) & 0xff
+                b = (b + (b1 & 0x03) - 2) & 0xff
+            elif (b1 & 0xc0) == 0x80:
+                b2 = qoi_data[p]
+                p += 1
+                vg = (b1 & 0x3f) - 32
+                r = (r + vg - 8 + ((b2 >> 4) & 0x0f)) & 0xff
+                g = (g + vg) & 0xff
+                b = (b + vg - 8 + (b2 & 0x0f)) & 0xff
+            else:
+                run = b1 & 0x3f
+            index[(r * 3 + g * 5 + b * 7 + a * 11) % 64] = (r, g, b, a)
+
+        if (y + 1) % interval == 0:
+            entries += p.to_bytes(4, byteorder='big')
+            entries += bytes((r, g, b, a, run, 0, 0, 0))
+            for px in index:
+                entries += bytes(px)
+
+    footer = interval.to_bytes(4, byteorder='big') + count.to_bytes(4, byteorder='big') + b'qsek'
+    return entries + footer
+
+def apply_qoi_effort(rgba_data, effort):
+    """Changes pixels the display can't show, same as qoi_encode_ex() in qoi.h.
+
+    effort 1: fully transparent pixels become transparent black.
+    effort 2: additionally rounds colors to RGB565 precision.
+    """
+    if effort >= 2:
+        rgb = rgba_data[..., :3]
+        rgb &= np.array([0xF8, 0xFC, 0xF8], dtype=np.uint8)
+        rgb |= rgb >> np.array([5, 6, 5], dtype=np.uint8)
+    if effort >= 1:
+        rgba_data[rgba_data[..., 3] == 0] = 0
+    return rgba_data
+
+def encode_split(crop, ext, convert_to_qoi, seek_interval=0, qoi_effort=0, header_version=2):
+    """Encodes one split the way the decoders get it and returns the bytes."""
+    buf = io.BytesIO()
+    crop.save(buf, format=Image.registered_extensions()[ext.lower()], quality=100)
+    if not convert_to_qoi:
+        return buf.getvalue()
+
+    buf.seek(0)
+    with Image.open(buf) as img:
+        img = img.convert('RGBA')
+        rgb_data = apply_qoi_effort(np.array(img), qoi_effort)
+        qoi_data = qoi.encode(rgb_data, colorspace=QOIColorSpace.SRGB)
+    if seek_interval > 0:
+        seek_table = build_qoi_seek_table(qoi_data, seek_interval)
+        if header_version >= 2 or len(qoi_data) + len(seek_table) <= 0xFFFF:
+            qoi_data += seek_table
+        else:
+            print('\033[1;33mWarn:\033[0m split with seek table exceeds 64K, seek table dropped.')
+    return qoi_data
+
+def choose_split_height(im, ext, convert_to_qoi, ram_budget, seek_interval=0, qoi_effort=0, header_version=2):
+    """Picks the split height with the lowest packed size plus decode cost.
+
+    Only heights whose frame cache (width * height * SPLIT_CACHE_BPP) fits ram_budget are
+    tried. The decode cost charges SPLIT_DECODE_COST per pixel decoded above a redrawn row,
+    half a split (or half a seek interval) on average.
+    """
+    width, height = im.size
+    max_height = max(ram_budget // (width * SPLIT_CACHE_BPP), 1)
+    candidates = [h for h in SPLIT_HEIGHT_CANDIDATES if h <= min(height, max_height)]
+    if height <= max_height and height not in candidates:
+        candidates.append(height)
+    if width * SPLIT_CACHE_BPP > ram_budget:
+        print(f'\033[1;33mWarn:\033[0m one row of {width} pixels exceeds the split RAM budget of {ram_budget} bytes.')
+
+    best = None
+    for split_height in candidates:
+        splits = math.ceil(height / split_height)
+        lengths = []
+        for i in range(splits):
+            crop = im.crop((0, i * split_height, width, min((i + 1) * split_height, height)))
+            lengths.append(len(encode_split(crop, ext, convert_to_qoi, seek_interval, qoi_effort, header_version)))
+        if header_version == 1 and max(lengths) > 0xFFFF:
+            continue
+
+        size = len(create_header(width, height, splits, split_height, lengths, ext, header_version)) + sum(lengths)
+        skipped_rows = min(split_height, seek_interval or split_height) / 2
+        cost = size + SPLIT_DECODE_COST * width * skipped_rows
+        if best is None or cost < best[0]:
+            best = (cost, split_height, size)
+
+    if best is None:
+        return candidates[0]
+    print(f'split height: {best[1]}\tsize: {best[2]}\tcandidates: {candidates}')
+    return best[1]
+
+def split_image(im, block_size, ext, convert_to_qoi, seek_interval=0, qoi_effort=0, header_version=2):
+    """Splits the image into blocks based on the block size and returns the encoded blocks."""
     width, height = im.size
     splits = math.ceil(height / block_size)
 
     print(f'RES: {width} x {height}\tblock_size: {block_size}\text: {ext}')
 
+    split_data = []
     for i in range(splits):
         if i < splits - 1:
             crop = im.crop((0, i * block_size, width, (i + 1) * block_size))
         else:
             crop = im.crop((0, i * block_size, width, height))
+        split_data.append(encode_split(crop, ext, convert_to_qoi, seek_interval, qoi_effort, header_version))
+
+    return width, height, split_data
 
-        output_path = os.path.join(input_dir, str(i) + ext)
-        crop.save(output_path, quality=100)
+def encode_raw(im, swap):
+    """Converts the image to the LVGL 16-bit color format and returns the pixel format and the pixels.
 
-        if convert_to_qoi:
-            with Image.open(output_path) as img:
-                img = img.convert('RGBA')
-                rgb_data = np.array(img)
-                qoi_data = qoi.encode(rgb_data, colorspace=QOIColorSpace.SRGB)
-                temp_qoi_path = os.path.join(input_dir, str(i) + '.qoi')
-                with open(temp_qoi_path, 'wb') as f:
-                    f.write(qoi_data)
-                os.remove(output_path)
+    Colors are truncated to RGB565 like the QOI_FMT_RGB565* formats of qoi.h. Images with
+    transparent pixels get an alpha byte after each color (LV_IMG_CF_TRUE_COLOR_ALPHA).
+    swap stores each color big endian, for LV_COLOR_16_SWAP.
+    """
+    rgba = np.array(im.convert('RGBA'), dtype=np.uint16)
+    color = ((rgba[..., 0] >> 3) << 11) | ((rgba[..., 1] >> 2) << 5) | (rgba[..., 2] >> 3)
+    color = color.astype('>u2' if swap else '<u2')
+    name = 'RGB565_SWAP' if swap else 'RGB565'
+
+    alpha = rgba[..., 3].astype(np.uint8)
+    if (alpha == 255).all():
+        return SPLIT_PIXEL_FORMATS[name], color.tobytes()
 
-    return width, height, splits
+    pixels = np.empty(alpha.shape + (3,), dtype=np.uint8)
+    pixels[..., 0:2] = color.view(np.uint8).reshape(alpha.shape + (2,))
+    pixels[..., 2] = alpha
+    return SPLIT_PIXEL_FORMATS[name.replace('RGB565', 'RGB565A8')], pixels.tobytes()
 
-def create_header(width, height, splits, split_height, lenbuf, ext):
-    """Creates the header for the output file based on the format."""
+def create_header(width, height, splits, split_height, lenbuf, ext, version=1, pixel_format=0, align=1):
+    """Creates the header for the output file based on the format.
+
+    V1 stores 2 byte split lengths. V2 stores the format, pixel format and alignment of
+    the splits and 4 byte absolute offsets, see split_image.h. V2 splits start at multiples
+    of align, save_image() pads them accordingly.
+    """
     header = bytearray()
 
     if ext.lower() == '.jpg':
@@ -70,9 +259,11 @@ def create_header(width, height, splits, split_height, lenbuf, ext):
         header += bytearray('_SPNG__'.encode('UTF-8'))
     elif ext.lower() == '.qoi':
         header += bytearray('_SQOI__'.encode('UTF-8'))
+    elif ext.lower() == '.raw':
+        header += bytearray('_SRAW__'.encode('UTF-8'))
 
-    # 6 BYTES VERSION
-    header += bytearray(('\x00V1.00\x00').encode('UTF-8'))
+    # 7 BYTES VERSION
+    header += bytearray(('\x00V%d.00\x00' % version).encode('UTF-8'))
 
     # WIDTH 2 BYTES
     header += width.to_bytes(2, byteorder='little')
@@ -86,22 +277,53 @@ def create_header(width, height, splits, split_height, lenbuf, ext):
     # SPLIT HEIGHT 2 BYTES
     header += split_height.to_bytes(2, byteorder='little')
 
+    if version == 1:
+        for item_len in lenbuf:
+            # LENGTH 2 BYTES
+            header += item_len.to_bytes(2, byteorder='little')
+        return header
+
+    # FORMAT 1 BYTE, PIXEL FORMAT 1 BYTE, ALIGNMENT 2 BYTES, RESERVED 2 BYTES
+    header += SPLIT_FORMATS.get(ext.lower(), 0).to_bytes(1, byteorder='little')
+    header += pixel_format.to_bytes(1, byteorder='little')
+    header += align.to_bytes(2, byteorder='little')
+    header += bytes(2)
+
+    # OFFSET OF EACH SPLIT AND OF THE END 4 BYTES
+    offset = SPLIT_HEADER_SIZE_V2 + (splits + 1) * 4
     for item_len in lenbuf:
-        # LENGTH 2 BYTES
-        header += item_len.to_bytes(2, byteorder='little')
+        offset = (offset + align - 1) // align * align
+        header += offset.to_bytes(4, byteorder='little')
+        offset += item_len
+    header += offset.to_bytes(4, byteorder='little')
 
     return header
 
-def save_image(output_file_path, header, split_data):
-    """Saves the image with the constructed header and split data."""
+def image_data(header, splits, align=1):
+    """Returns the image with the constructed header and splits, each padded to align."""
+    data = bytearray(header)
+    for split in splits:
+        data += bytes(-len(data) % align)
+        data += split
+    return data
+
+def save_image(output_file_path, header, splits, align=1):
+    """Saves the image with the constructed header and splits, each padded to align."""
     with open(output_file_path, 'wb') as f:
-        f.write(header + split_data)
+        f.write(image_data(header, splits, align))
+
+def process_image(input_file, height_str, output_extension, convert_to_qoi=False, seek_interval=0, qoi_effort=0, header_version=2, ram_budget=0,
+                  output_dir=None, raw_max_pixels=0, raw_max_ratio=0, raw_swap=False, split_align=1):
+    """Main function to process the image and save it as .sjpg, .spng, .sqoi or .sraw.
 
-def process_image(input_file, height_str, output_extension, convert_to_qoi=False):
-    """Main function to process the image and save it as .sjpg, .spng, or .sqoi."""
+    QOI images of at most raw_max_pixels pixels are saved as raw .sraw images instead when
+    those are at most raw_max_ratio percent of the .sqoi size, see encode_raw().
+    V2 splits start at multiples of split_align bytes from the start of the image.
+    The output is written to output_dir, next to the input if None. Returns its path.
+    """
     try:
         SPLIT_HEIGHT = int(height_str)
-        if SPLIT_HEIGHT <= 0:
+        if SPLIT_HEIGHT <= 0 and ram_budget <= 0:
             raise ValueError('Height must be a positive integer')
     except ValueError as e:
         print('Error: Height must be a positive integer')
@@ -117,45 +339,321 @@ def process_image(input_file, height_str, output_extension, convert_to_qoi=False
         print('Error:', e)
         sys.exit(0)
 
-    width, height, splits = split_image(im, SPLIT_HEIGHT, input_dir, ext, convert_to_qoi)
-
-    split_data = bytearray()
-    lenbuf = []
+    pixel_format = SPLIT_PIXEL_FORMATS.get('RGBA' if convert_to_qoi else im.mode, 0)
+    if ram_budget > 0:
+        SPLIT_HEIGHT = choose_split_height(im, ext, convert_to_qoi, ram_budget, seek_interval, qoi_effort, header_version)
+    width, height, split_data = split_image(im, SPLIT_HEIGHT, ext, convert_to_qoi, seek_interval, qoi_effort, header_version)
+    lenbuf = [len(a) for a in split_data]
 
     if convert_to_qoi:
         ext = '.qoi'
 
-    for i in range(splits):
-        with open(os.path.join(input_dir, str(i) + ext), 'rb') as f:
-            a = f.read()
-        split_data += a
-        lenbuf.append(len(a))
-        os.remove(os.path.join(input_dir, str(i) + ext))
+    for i, a in enumerate(split_data):
+        if header_version == 1 and len(a) > 0xFFFF:
+            print(f'\033[1;31mError:\033[0m split {i} of {input_filename} is {len(a)} bytes, V1 headers only hold 64K splits.')
+            sys.exit(1)
 
-    header = create_header(width, height, splits, SPLIT_HEIGHT, lenbuf, ext)
-    output_file_path = os.path.join(input_dir, OUTPUT_FILE_NAME + output_extension)
-    save_image(output_file_path, header, split_data)
+    align = split_align if header_version != 1 else 1
+    header = create_header(width, height, len(split_data), SPLIT_HEIGHT, lenbuf, ext, header_version, pixel_format, align)
+
+    if convert_to_qoi and width * height <= raw_max_pixels:
+        raw_pixel_format, raw_data = encode_raw(im, raw_swap)
+        raw_header = create_header(width, height, 1, height, [len(raw_data)], '.raw', 2, raw_pixel_format, split_align)
+        raw_size = len(image_data(raw_header, [raw_data], split_align))
+        qoi_size = len(image_data(header, split_data, align))
+        if raw_size * 100 <= raw_max_ratio * qoi_size:
+            print(f'raw: {raw_size} bytes\tqoi: {qoi_size} bytes')
+            header, split_data, output_extension, align = raw_header, [raw_data], '.sraw', split_align
+
+    output_file_path = os.path.join(output_dir or input_dir, OUTPUT_FILE_NAME + output_extension)
+    save_image(output_file_path, header, split_data, align)
 
     print('Completed, saved as:', os.path.basename(output_file_path), '\n')
+    return output_file_path
+
+def convert_image_to_qoi(input_file, height_str, seek_interval=0, qoi_effort=0, header_version=2, ram_budget=0, output_dir=None,
+                         raw_max_pixels=0, raw_max_ratio=0, raw_swap=False, split_align=1):
+    return process_image(input_file, height_str, '.sqoi', convert_to_qoi=True, seek_interval=seek_interval, qoi_effort=qoi_effort,
+                         header_version=header_version, ram_budget=ram_budget, output_dir=output_dir,
+                         raw_max_pixels=raw_max_pixels, raw_max_ratio=raw_max_ratio, raw_swap=raw_swap, split_align=split_align)
+
+def anim_sequences(filenames):
+    """Groups numbered PNG files like frame0001.png, frame0002.png, ... into animations.
+
+    Returns {name: [filenames in frame order]} for every name with at least 2 frames, name
+    being the file name without the number and trailing separators.
+    """
+    sequences = {}
+    for filename in filenames:
+        base_filename, ext = os.path.splitext(filename)
+        match = re.fullmatch(r'(.*?)(\d+)', base_filename)
+        if ext.lower() == '.png' and match:
+            name = match.group(1).rstrip('_-. ') or 'anim'
+            sequences.setdefault(name, []).append((int(match.group(2)), filename))
+    return {name: [f for _, f in sorted(frames)] for name, frames in sequences.items() if len(frames) > 1}
+
+def diff_rects(mask, band_height, gap=ANIM_PATCH_GAP):
+    """Returns the (x, y, w, h) rectangles covering the True pixels of mask, none crossing a band.
+
+    In each band of band_height rows, changed columns closer than gap are joined and each
+    group is cut to the rows it changes.
+    """
+    rects = []
+    height = mask.shape[0]
+    for y0 in range(0, height, band_height):
+        band = mask[y0:y0 + band_height]
+        columns = np.flatnonzero(band.any(axis=0))
+        if not len(columns):
+            continue
+        breaks = np.flatnonzero(np.diff(columns) > gap)
+        starts = np.concatenate(([columns[0]], columns[breaks + 1]))
+        ends = np.concatenate((columns[breaks], [columns[-1]])) + 1
+        for x0, x1 in zip(starts, ends):
+            rows = np.flatnonzero(band[:, x0:x1].any(axis=1))
+            rects.append((int(x0), y0 + int(rows[0]), int(x1 - x0), int(rows[-1] - rows[0] + 1)))
+    return rects
+
+def merge_rects(rects, max_count):
+    """Merges the pair of rectangles that adds the least area until at most max_count are left."""
+    rects = list(rects)
+    while len(rects) > max_count:
+        best = None
+        for i in range(len(rects)):
+            for j in range(i + 1, len(rects)):
+                (ax, ay, aw, ah), (bx, by, bw, bh) = rects[i], rects[j]
+                x0, y0 = min(ax, bx), min(ay, by)
+                x1, y1 = max(ax + aw, bx + bw), max(ay + ah, by + bh)
+                cost = (x1 - x0) * (y1 - y0) - aw * ah - bw * bh
+                if best is None or cost < best[0]:
+                    best = (cost, i, j, (x0, y0, x1 - x0, y1 - y0))
+        _, i, j, rects[i] = best
+        del rects[j]
+    return rects
+
+def convert_frames_to_aqoi(input_files, height_str, qoi_effort=0, ram_budget=0, output_dir=None, name=None):
+    """Packs the frames of an animation into an .aqoi container and returns its path.
+
+    The first frame is the keyframe, a V2 .sqoi split image. Every frame then lists the
+    rectangles where it differs from the previous frame, for the decoder to invalidate, and
+    QOI patches of the rectangles where it differs from the keyframe. Patches never cross
+    a split, so any split of any frame is the keyframe split with its patches drawn over it.
+    """
+    split_height = int(height_str)
+    if split_height <= 0 and ram_budget <= 0:
+        print('Error: Height must be a positive integer')
+        sys.exit(1)
 
-def convert_image_to_qoi(input_file, height_str):
-    process_image(input_file, height_str, '.sqoi', convert_to_qoi=True)
+    images = [Image.open(f).convert('RGBA') for f in input_files]
+    key = images[0]
+    width, height = key.size
+    if ram_budget > 0:
+        split_height = choose_split_height(key, '.png', True, ram_budget, 0, qoi_effort, 2)
+    _, _, key_splits = split_image(key, split_height, '.png', True, 0, qoi_effort, 2)
+    key_data = create_header(width, height, len(key_splits), split_height, [len(a) for a in key_splits], '.qoi', 2,
+                             SPLIT_PIXEL_FORMATS['RGBA']) + b''.join(key_splits)
 
-def convert_image_to_simg(input_file, height_str):
+    pixels = [apply_qoi_effort(np.array(im), qoi_effort) for im in images]
+    records = []
+    changed = 0
+    for i, frame in enumerate(pixels):
+        dirty = merge_rects(diff_rects((frame != pixels[i - 1]).any(axis=2), split_height), ANIM_MAX_DIRTY)
+        patches = []
+        for x, y, w, h in diff_rects((frame != pixels[0]).any(axis=2), split_height):
+            patches.append(((x, y, w, h), qoi.encode(np.ascontiguousarray(frame[y:y + h, x:x + w]), colorspace=QOIColorSpace.SRGB)))
+        changed += sum(w * h for x, y, w, h in dirty)
+
+        record = bytearray()
+        record += len(dirty).to_bytes(2, byteorder='little') + len(patches).to_bytes(2, byteorder='little')
+        for rect in dirty:
+            record += b''.join(v.to_bytes(2, byteorder='little') for v in rect)
+        offset = len(record) + len(patches) * 16
+        for rect, data in patches:
+            record += b''.join(v.to_bytes(2, byteorder='little') for v in rect)
+            record += offset.to_bytes(4, byteorder='little') + len(data).to_bytes(4, byteorder='little')
+            offset += len(data)
+        for _, data in patches:
+            record += data
+        records.append(record)
+
+    header = bytearray(b'_AQOI__\x00V1.00\x00')
+    for v in (width, height, len(records), split_height):
+        header += v.to_bytes(2, byteorder='little')
+    header += SPLIT_FORMATS['.qoi'].to_bytes(1, byteorder='little') + SPLIT_PIXEL_FORMATS['RGBA'].to_bytes(1, byteorder='little')
+    header += bytes(4)
+
+    # OFFSET OF THE KEYFRAME, OF EACH FRAME AND OF THE END 4 BYTES
+    offset = ANIM_HEADER_SIZE + (len(records) + 2) * 4
+    for part in [key_data] + records:
+        header += offset.to_bytes(4, byteorder='little')
+        offset += len(part)
+    header += offset.to_bytes(4, byteorder='little')
+
+    output_file_path = os.path.join(output_dir or os.path.dirname(input_files[0]), name + '.aqoi')
+    save_image(output_file_path, header, [key_data] + records)
+    print(f'anim: {len(records)} frames\tkeyframe: {len(key_data)} bytes\tframes: {sum(len(r) for r in records)} bytes\t'
+          f'redrawn: {changed * 100 / (width * height * len(records)):.1f}%')
+    print('Completed, saved as:', os.path.basename(output_file_path), '\n')
+    return output_file_path
+
+def convert_image_to_simg(input_file, height_str, header_version=2, ram_budget=0, output_dir=None, split_align=1):
     input_dir, input_filename = os.path.split(input_file)
     _, ext = os.path.splitext(input_filename)
     output_extension = '.sjpg' if ext.lower() == '.jpg' else '.spng'
-    process_image(input_file, height_str, output_extension, convert_to_qoi=False)
+    return process_image(input_file, height_str, output_extension, convert_to_qoi=False, header_version=header_version, ram_budget=ram_budget,
+                         output_dir=output_dir, split_align=split_align)
+
+def split_tiles(data):
+    """Returns the splits of a V2 split image with 1 byte alignment, None for any other file."""
+    if len(data) < SPLIT_HEADER_SIZE_V2 or data[:7] not in SPLIT_MAGICS or data[7:14] != b'\x00V2.00\x00':
+        return None
+    if int.from_bytes(data[24:26], byteorder='little') != 1:
+        return None
+    splits = int.from_bytes(data[18:20], byteorder='little')
+    table = data[SPLIT_HEADER_SIZE_V2:SPLIT_HEADER_SIZE_V2 + (splits + 1) * 4]
+    offsets = [int.from_bytes(table[i * 4:i * 4 + 4], byteorder='little') for i in range(splits + 1)]
+    return [data[offsets[i]:offsets[i + 1]] for i in range(splits)]
+
+def merge_files(file_data, dedup=False, start=0, align=1, pool_entry_size=0):
+    """Concatenates the files for pack_models(), each after a 0x5A5A prefix.
 
-def pack_models(model_path, assets_c_path, out_file, assets_path, max_name_len):
+    Each file starts at a multiple of align bytes from the start of the partition, the
+    merged data starting at start, and is preceded by zero padding as needed.
+    Returns the merged data, the (offset, size) of each file and of the split pool, None
+    without one. With dedup, a file equal to an earlier one shares its copy, and V2 split
+    images with splits that repeat, in the same image or in others, are stored with a V3
+    header (4-byte offset and length per split, see split_image.h). Splits repeated within
+    an image are stored once in that image. Splits shared between images are stored once in
+    the split pool, an asset after all files starting with SPLIT_POOL_MAGIC, whose table
+    entry of pool_entry_size bytes moves the merged data. The size of each image only counts
+    its own bytes, the reach in its V3 header covers the pool.
+    """
     merged_data = bytearray()
+    layout = [None] * len(file_data)
+
+    def pad():
+        merged_data.extend(bytes(-(start + len(merged_data) + 2) % align))
+
+    if not dedup:
+        for i, data in enumerate(file_data):
+            pad()
+            layout[i] = (len(merged_data), len(data))
+            merged_data.extend(b'\x5A' * 2)
+            merged_data.extend(data)
+        return merged_data, layout, None
+
+    # The size without dedup for the report, which counts the pool's table and name index entries
+    verbatim = 0
+    for data in file_data:
+        verbatim += -(start + verbatim + 2) % align + 2 + len(data)
+
+    first = {}
+    tiles = {}
+    owners = {}
+    for i, data in enumerate(file_data):
+        if data in first:
+            continue
+        first[data] = i
+        tiles[i] = split_tiles(data)
+        for tile in set(tiles[i] or ()):
+            owners[tile] = owners.get(tile, 0) + 1
+    if any(count > 1 for count in owners.values()):
+        start += pool_entry_size
+
+    pool = {}
+    pending = []
+    stored_tiles = 0
+    total_tiles = 0
+    for i, data in enumerate(file_data):
+        if first[data] != i:
+            continue
+
+        pad()
+        offset = len(merged_data)
+        merged_data.extend(b'\x5A' * 2)
+        base = len(merged_data)
+        split_list = tiles[i]
+        if not split_list or (len(set(split_list)) == len(split_list) and all(owners[t] == 1 for t in split_list)):
+            layout[i] = (offset, len(data))
+            merged_data.extend(data)
+            continue
+
+        merged_data.extend(bytes(SPLIT_HEADER_SIZE_V3 + len(split_list) * 8))
+        local = {}
+        entries = []
+        for tile in split_list:
+            if owners[tile] > 1:
+                pool.setdefault(tile, None)
+                entries.append(tile)
+                continue
+            if tile not in local:
+                local[tile] = (len(merged_data) - base, len(tile))
+                merged_data.extend(tile)
+            entries.append(local[tile])
+        stored_tiles += len(local)
+        total_tiles += len(split_list)
+        layout[i] = (offset, len(merged_data) - base)
+        pending.append((i, base, entries))
+
+    pool_layout = None
+    if pool:
+        pad()
+        pool_offset = len(merged_data)
+        merged_data.extend(b'\x5A' * 2)
+        merged_data.extend(SPLIT_POOL_MAGIC)
+        for tile in pool:
+            pool[tile] = len(merged_data)
+            merged_data.extend(tile)
+        pool_layout = (pool_offset, len(merged_data) - pool_offset - 2)
+        stored_tiles += len(pool)
+
+    for i, base, entries in pending:
+        header = bytearray(file_data[i][:SPLIT_HEADER_SIZE_V2])
+        header[7:14] = b'\x00V3.00\x00'
+        shared = any(isinstance(entry, bytes) for entry in entries)
+        header += (len(merged_data) - base if shared else layout[i][1]).to_bytes(4, byteorder='little')
+        for entry in entries:
+            tile_offset, tile_len = (pool[entry] - base, len(entry)) if isinstance(entry, bytes) else entry
+            header += tile_offset.to_bytes(4, byteorder='little') + tile_len.to_bytes(4, byteorder='little')
+        merged_data[base:base + len(header)] = header
+
+    for i, data in enumerate(file_data):
+        layout[i] = layout[first[data]]
+
+    saved = verbatim - len(merged_data) - (pool_entry_size + 2 if pool else 0)
+    print(f'Dedup: {len(file_data) - len(first)} duplicate files, {total_tiles - stored_tiles} duplicate splits, '
+          f'{saved} bytes saved ({saved * 100 / max(verbatim, 1):.1f}%)')
+    return merged_data, layout, pool_layout
+
+def name_index(fixed_names):
+    """Returns the name index appended to the assets for mmap_assets_find().
+
+    It lists the 2-byte table index of each file, in the byte order of the stored names,
+    followed by the number of files and NAME_INDEX_MAGIC, and is empty past 65535 files.
+    """
+    if len(fixed_names) > 0xFFFF:
+        return b''
+    index = bytearray()
+    for i in sorted(range(len(fixed_names)), key=lambda i: fixed_names[i]):
+        index += i.to_bytes(2, byteorder='little')
+    return index + len(fixed_names).to_bytes(4, byteorder='little') + NAME_INDEX_MAGIC
+
+def pack_models(model_path, assets_c_path, out_file, assets_path, max_name_len, dedup=False, align=1, crc=False):
+    """Packs the files of model_path into out_file and writes the mmap_generate_*.h header.
+
+    The data of each file starts at a multiple of align bytes in the partition.
+    With crc, each table entry ends with the CRC32 of the file data. With dedup, splits shared
+    between images are packed into a SPLIT_POOL_NAME file after the others, see merge_files().
+
+    Returns the (name, data, width, height) of each file, in partition order.
+    """
     file_info_list = []
+    file_data = []
+    split_heights = {}
 
     file_list = sorted(os.listdir(model_path), key=sort_key)
     for filename in file_list:
         file_path = os.path.join(model_path, filename)
         file_name = os.path.basename(file_path)
-        file_size = os.path.getsize(file_path)
 
         try:
             img = Image.open(file_path)
@@ -163,7 +661,7 @@ def pack_models(model_path, assets_c_path, out_file, assets_path, max_name_len):
         except Exception as e:
             # print("Error:", e)
             _, file_extension = os.path.splitext(file_path)
-            if file_extension.lower() in ['.sjpg', '.spng', '.sqoi']:
+            if file_extension.lower() in ['.sjpg', '.spng', '.sqoi', '.sraw', '.aqoi']:
                 offset = 14
                 with open(file_path, 'rb') as f:
                     f.seek(offset)
@@ -171,32 +669,41 @@ def pack_models(model_path, assets_c_path, out_file, assets_path, max_name_len):
                     height_bytes = f.read(2)
                     width = int.from_bytes(width_bytes, byteorder='little')
                     height = int.from_bytes(height_bytes, byteorder='little')
+                    f.seek(2, os.SEEK_CUR)
+                    split_heights[file_name] = int.from_bytes(f.read(2), byteorder='little')
             else:
                 width, height = 0, 0
 
-        file_info_list.append((file_name, len(merged_data), file_size, width, height))
-        # Add 0x5A5A prefix to merged_data
-        merged_data.extend(b'\x5A' * 2)
-
+        file_info_list.append((file_name, width, height))
         with open(file_path, 'rb') as bin_file:
-            bin_data = bin_file.read()
-
-        merged_data.extend(bin_data)
+            file_data.append(bin_file.read())
 
+    # Add 0x5A5A prefix to each file
+    entry_size = int(max_name_len) + (16 if crc else 12)
+    merged_data, layout, pool_layout = merge_files(file_data, dedup, 12 + len(file_info_list) * entry_size, align, entry_size)
+    if pool_layout:
+        file_info_list.append((SPLIT_POOL_NAME, 0, 0))
+        file_data.append(bytes(merged_data[pool_layout[0] + 2:pool_layout[0] + 2 + pool_layout[1]]))
+        layout.append(pool_layout)
+    file_info_list = [(name, offset, size, width, height) for (name, width, height), (offset, size) in zip(file_info_list, layout)]
     total_files = len(file_info_list)
 
     mmap_table = bytearray()
+    fixed_names = []
     for file_name, offset, file_size, width, height in file_info_list:
         if len(file_name) > int(max_name_len):
             print(f'\033[1;33mWarn:\033[0m "{file_name}" exceeds {max_name_len} bytes and will be truncated.')
         fixed_name = file_name.ljust(int(max_name_len), '\0')[:int(max_name_len)]
-        mmap_table.extend(fixed_name.encode('utf-8'))
+        fixed_names.append(fixed_name.encode('utf-8'))
+        mmap_table.extend(fixed_names[-1])
         mmap_table.extend(file_size.to_bytes(4, byteorder='little'))
         mmap_table.extend(offset.to_bytes(4, byteorder='little'))
         mmap_table.extend(width.to_bytes(2, byteorder='little'))
         mmap_table.extend(height.to_bytes(2, byteorder='little'))
+        if crc:
+            mmap_table.extend(zlib.crc32(merged_data[offset + 2:offset + 2 + file_size]).to_bytes(4, byteorder='little'))
 
-    combined_data = mmap_table + merged_data
+    combined_data = mmap_table + merged_data + name_index(fixed_names)
     combined_checksum = compute_checksum(combined_data)
     combined_data_length = len(combined_data).to_bytes(4, byteorder='little')
     header_data = total_files.to_bytes(4, byteorder='little') + combined_checksum.to_bytes(4, byteorder='little')
@@ -232,7 +739,148 @@ def pack_models(model_path, assets_c_path, out_file, assets_path, max_name_len):
 
         output_header.write('};\n')
 
+        if split_heights:
+            output_header.write('\n/* Split height of each split image */\n')
+            for file_name, split_height in split_heights.items():
+                enum_name = file_name.replace('.', '_')
+                output_header.write(f'#define MMAP_{asset_name.upper()}_{enum_name.upper()}_SPLIT_HEIGHT    {split_height}\n')
+
     print(f'All bin files have been merged into {out_file}')
+    return [(name, data, width, height) for (name, _, _, width, height), data in zip(file_info_list, file_data)]
+
+def split_list(data):
+    """Returns the magic and splits of a V1 or V2 split image, None for any other file."""
+    if len(data) < 22 or data[:7] not in SPLIT_MAGICS:
+        return None
+    splits = int.from_bytes(data[18:20], byteorder='little')
+    if data[7:14] == b'\x00V1.00\x00':
+        offset = 22 + splits * 2
+        split_data = []
+        for i in range(splits):
+            length = int.from_bytes(data[22 + i * 2:24 + i * 2], byteorder='little')
+            split_data.append(data[offset:offset + length])
+            offset += length
+        return data[:7], split_data
+    if data[7:14] == b'\x00V2.00\x00':
+        table = data[SPLIT_HEADER_SIZE_V2:SPLIT_HEADER_SIZE_V2 + (splits + 1) * 4]
+        offsets = [int.from_bytes(table[i * 4:i * 4 + 4], byteorder='little') for i in range(splits + 1)]
+        return data[:7], [data[offsets[i]:offsets[i + 1]] for i in range(splits)]
+    return None
+
+def decode_split(magic, split):
+    """Decodes a split like the esp_lv_* decoders do, raw splits are drawn in place."""
+    if magic == b'_SQOI__':
+        qoi.decode(bytes(split))
+    elif magic != b'_SRAW__':
+        Image.open(io.BytesIO(split)).load()
+
+def asset_report(name, data, width, height):
+    """Describes an asset for the build report and times its decode on the host.
+
+    decode_us is the time to decode the whole image once, the mean over all frames for
+    an .aqoi animation (the keyframe plus the frame's patches). It is None for files
+    that aren't images. Only relative values are meaningful, the target is many times slower.
+    """
+    ext = os.path.splitext(name)[1].lower()
+    entry = {'name': name, 'format': ext.lstrip('.'), 'width': width, 'height': height, 'split_height': 0, 'tiles': 0, 'frames': 0,
+             'bytes': len(data), 'rgb565_bytes': width * height * 2}
+    decodes = []
+    parsed = split_list(data)
+    if parsed:
+        magic, split_data = parsed
+        entry['split_height'] = int.from_bytes(data[20:22], byteorder='little')
+        entry['tiles'] = len(split_data)
+        decodes.append((lambda: [decode_split(magic, split) for split in split_data], 1))
+    elif data[:14] == b'_AQOI__\x00V1.00\x00':
+        frames = int.from_bytes(data[18:20], byteorder='little')
+        offsets = [int.from_bytes(data[ANIM_HEADER_SIZE + i * 4:ANIM_HEADER_SIZE + i * 4 + 4], byteorder='little') for i in range(frames + 2)]
+        magic, key = split_list(data[offsets[0]:offsets[1]])
+        patches = []
+        for i in range(frames):
+            frame = data[offsets[i + 1]:offsets[i + 2]]
+            dirty = int.from_bytes(frame[0:2], byteorder='little')
+            for j in range(int.from_bytes(frame[2:4], byteorder='little')):
+                entry_offset = 4 + dirty * 8 + j * 16
+                patch_offset = int.from_bytes(frame[entry_offset + 8:entry_offset + 12], byteorder='little')
+                patch_len = int.from_bytes(frame[entry_offset + 12:entry_offset + 16], byteorder='little')
+                patches.append(frame[patch_offset:patch_offset + patch_len])
+        entry.update(split_height=int.from_bytes(data[20:22], byteorder='little'), tiles=len(key) + len(patches), frames=frames)
+        decodes.append((lambda: [decode_split(magic, split) for split in key], 1))
+        decodes.append((lambda: [qoi.decode(bytes(patch)) for patch in patches], 1 / frames))
+    elif data[:4] == b'qoif':
+        entry['tiles'] = 1
+        decodes.append((lambda: qoi.decode(bytes(data)), 1))
+    elif width and height:
+        entry['tiles'] = 1
+        decodes.append((lambda: Image.open(io.BytesIO(data)).load(), 1))
+
+    entry['ratio'] = round(len(data) / entry['rgb565_bytes'], 3) if entry['rgb565_bytes'] else None
+    entry['decode_us'] = None
+    if decodes:
+        total = 0
+        for decode, weight in decodes:
+            best = None
+            for _ in range(REPORT_DECODE_RUNS):
+                start = time.perf_counter()
+                decode()
+                elapsed = time.perf_counter() - start
+                best = elapsed if best is None else min(best, elapsed)
+            total += best * weight
+        entry['decode_us'] = round(total * 1e6)
+    return entry
+
+def write_report(assets, image_file, partition_size):
+    """Writes <image>_report.json and .html next to the folder of image_file.
+
+    Each asset is flagged with the categories it is among the worst REPORT_TOP of: 'size'
+    (packed bytes) and 'decode' (host decode time), plus 'ratio' if it is larger than
+    raw RGB565.
+    """
+    entries = [asset_report(name, data, width, height) for name, data, width, height in assets]
+    offenders = {
+        'size': [e['name'] for e in sorted(entries, key=lambda e: -e['bytes'])[:REPORT_TOP]],
+        'decode': [e['name'] for e in sorted((e for e in entries if e['decode_us']), key=lambda e: -e['decode_us'])[:REPORT_TOP]],
+        'ratio': [e['name'] for e in entries if e['ratio'] is not None and e['ratio'] > 1],
+    }
+    for e in entries:
+        e['offender'] = [category for category, names in offenders.items() if e['name'] in names]
+
+    target_path = os.path.dirname(image_file)
+    report_path = os.path.join(os.path.dirname(target_path), os.path.basename(target_path) + '_report')
+    report = {
+        'image': os.path.basename(image_file),
+        'partition_size': partition_size,
+        'image_size': os.path.getsize(image_file),
+        'assets': entries,
+        'offenders': offenders,
+    }
+    with open(report_path + '.json', 'w') as f:
+        json.dump(report, f, indent=2)
+
+    columns = ('name', 'format', 'width', 'height', 'split_height', 'tiles', 'frames', 'bytes', 'rgb565_bytes', 'ratio', 'decode_us')
+    with open(report_path + '.html', 'w') as f:
+        f.write('<!DOCTYPE html>\n<html><head><meta charset="utf-8"><title>{} report</title>\n'.format(html.escape(report['image'])))
+        f.write('<style>body{font-family:sans-serif}table{border-collapse:collapse}td,th{border:1px solid #ccc;padding:2px 6px;text-align:right}'
+                'td:first-child{text-align:left}.bad{background:#fcc}</style></head><body>\n')
+        f.write('<h1>{}</h1>\n<p>{} of {} bytes used, host decode times</p>\n'.format(html.escape(report['image']), report['image_size'], partition_size))
+        f.write('<table>\n<tr>' + ''.join(f'<th>{c}</th>' for c in columns) + '</tr>\n')
+        flagged = {'bytes': 'size', 'decode_us': 'decode', 'ratio': 'ratio'}
+        for e in entries:
+            f.write('<tr>')
+            for c in columns:
+                bad = ' class="bad"' if flagged.get(c) in e['offender'] else ''
+                f.write(f'<td{bad}>{html.escape(str(e[c]) if e[c] is not None else "")}</td>')
+            f.write('</tr>\n')
+        f.write('</table>\n</body></html>\n')
+
+    print(f'Build report: {report_path}.json, {report_path}.html')
+    names = {e['name']: e for e in entries}
+    if offenders['size']:
+        print('  largest:', ', '.join(f'{n} ({names[n]["bytes"]} bytes)' for n in offenders['size']))
+    if offenders['decode']:
+        print('  slowest to decode:', ', '.join(f'{n} ({names[n]["decode_us"]} us)' for n in offenders['decode']))
+    if offenders['ratio']:
+        print('  \033[1;33mlarger than RGB565:\033[0m', ', '.join(offenders['ratio']))
 
 
 def parse_hex(value):
@@ -241,9 +889,36 @@ def parse_hex(value):
     except ValueError:
         raise argparse.ArgumentTypeError(f'Invalid hex value: {value}')
 
-def copy_assets_to_build(assets_path, target_path, support_spng, support_sjpg, support_qoi, support_format, split_height):
+def convert_asset(job):
+    """Converts one asset for copy_assets_to_build(), runs in a worker process."""
+    (convert_to_qoi, input_file, target_path, split_height, qoi_seek_interval, qoi_effort, header_version, split_ram_budget,
+     raw_max_pixels, raw_max_ratio, raw_swap, split_align) = job
+    if isinstance(input_file, tuple):
+        return convert_frames_to_aqoi(input_file[1:], split_height, qoi_effort, split_ram_budget, target_path, input_file[0])
+    if convert_to_qoi:
+        return convert_image_to_qoi(input_file, split_height, qoi_seek_interval, qoi_effort, header_version, split_ram_budget, target_path,
+                                    raw_max_pixels, raw_max_ratio, raw_swap, split_align)
+    return convert_image_to_simg(input_file, split_height, header_version, split_ram_budget, target_path, split_align)
+
+def asset_cache_key(job, script_digest):
+    """Hashes the input file, the conversion settings and this script into a cache entry name."""
+    h = hashlib.sha256(script_digest)
+    input_files = job[1][1:] if isinstance(job[1], tuple) else (job[1],)
+    for input_file in input_files:
+        with open(input_file, 'rb') as f:
+            h.update(f.read())
+    h.update(repr((job[0],) + job[3:]).encode('UTF-8'))
+    return h.hexdigest()
+
+def copy_assets_to_build(assets_path, target_path, support_spng, support_sjpg, support_qoi, support_format, split_height, qoi_seek_interval=0, qoi_effort=0, header_version=2, split_ram_budget=0,
+                         raw_max_pixels=0, raw_max_ratio=0, raw_swap=False, cache_path=None, anim_sequence=False, split_align=1):
     """
     Copy assets to target_path based on sdkconfig
+
+    With anim_sequence and QOI, numbered PNG frames of the same size are packed into one
+    .aqoi animation each, see anim_sequences(). Images are converted in a process pool. With cache_path, every converted image is also
+    kept there under the hash of its input and settings, and unchanged images are copied
+    from the cache instead of being converted again. Entries this run doesn't use are removed.
     """
     format_string = support_format
     spng_enable = True if support_spng == 'ON' else False
@@ -252,24 +927,76 @@ def copy_assets_to_build(assets_path, target_path, support_spng, support_sjpg, s
 
     format_list = format_string.split(',')
     format_tuple = tuple(format_list)
-    for filename in os.listdir(assets_path):
+    jobs = []
+    filenames = os.listdir(assets_path)
+    if anim_sequence and qoi_enable and not spng_enable and '.png' in format_tuple:
+        for name, frames in sorted(anim_sequences(filenames).items()):
+            sizes = {Image.open(os.path.join(assets_path, f)).size for f in frames}
+            if len(sizes) > 1:
+                print(f'\033[1;33mWarn:\033[0m frames of {name} differ in size, packed as separate images.')
+                continue
+            input_files = (name,) + tuple(os.path.join(assets_path, f) for f in frames)
+            jobs.append((True, input_files, target_path, split_height, 0, qoi_effort, 2, split_ram_budget, 0, 0, False, 1))
+            filenames = [f for f in filenames if f not in frames]
+
+    for filename in filenames:
         if any(filename.endswith(suffix) for suffix in format_tuple):
-            shutil.copyfile(os.path.join(assets_path, filename), os.path.join(target_path, filename))
-            if filename.endswith('.jpg') and sjpg_enable:
-                convert_image_to_simg(os.path.join(target_path, filename), split_height)
-                os.remove(os.path.join(target_path, filename))
-            elif filename.endswith('.png') and spng_enable:
-                convert_image_to_simg(os.path.join(target_path, filename), split_height)
-                os.remove(os.path.join(target_path, filename))
-            elif filename.endswith('.png') and qoi_enable:
-                convert_image_to_qoi(os.path.join(target_path, filename), split_height)
-                os.remove(os.path.join(target_path, filename))
-            elif filename.endswith('.jpg') and qoi_enable:
-                convert_image_to_qoi(os.path.join(target_path, filename), split_height)
-                os.remove(os.path.join(target_path, filename))
+            input_file = os.path.join(assets_path, filename)
+            if (filename.endswith('.jpg') and sjpg_enable) or (filename.endswith('.png') and spng_enable):
+                jobs.append((False, input_file, target_path, split_height, 0, 0, header_version, split_ram_budget, 0, 0, False, split_align))
+            elif (filename.endswith('.png') or filename.endswith('.jpg')) and qoi_enable:
+                jobs.append((True, input_file, target_path, split_height, qoi_seek_interval, qoi_effort, header_version, split_ram_budget,
+                             raw_max_pixels, raw_max_ratio, raw_swap, split_align))
+            else:
+                shutil.copyfile(input_file, os.path.join(target_path, filename))
         else:
             print(f'No match found for file: {filename}, format_tuple: {format_tuple}')
 
+    if not jobs:
+        return
+
+    cached = {}
+    if cache_path:
+        os.makedirs(cache_path, exist_ok=True)
+        with open(os.path.abspath(__file__), 'rb') as f:
+            script_digest = hashlib.sha256(f.read()).digest()
+        cached = {job: asset_cache_key(job, script_digest) for job in jobs}
+
+    pending = []
+    used = set()
+    for job in jobs:
+        if isinstance(job[1], tuple):
+            base_filename, output_extensions = job[1][0], ('.aqoi',)
+        else:
+            base_filename, ext = os.path.splitext(os.path.basename(job[1]))
+            # QOI jobs may be saved as raw images, see process_image()
+            output_extensions = ('.sqoi', '.sraw') if job[0] else ('.sjpg' if ext.lower() == '.jpg' else '.spng',)
+        cache_file = os.path.join(cache_path, cached[job]) if cache_path else None
+        hit = next((e for e in output_extensions if cache_file and os.path.exists(cache_file + e)), None)
+        if hit:
+            used.add(cache_file + hit)
+            shutil.copyfile(cache_file + hit, os.path.join(target_path, base_filename + hit))
+            print('Unchanged, taken from cache:', base_filename + hit)
+        else:
+            pending.append((job, cache_file))
+
+    if len(pending) > 1:
+        with ProcessPoolExecutor(max_workers=min(len(pending), os.cpu_count() or 1)) as pool:
+            outputs = list(pool.map(convert_asset, [job for job, _ in pending]))
+    else:
+        outputs = [convert_asset(job) for job, _ in pending]
+
+    for (job, cache_file), output_file_path in zip(pending, outputs):
+        if cache_file:
+            cache_file += os.path.splitext(output_file_path)[1]
+            used.add(cache_file)
+            shutil.copyfile(output_file_path, cache_file)
+
+    if cache_path:
+        for cache_file in os.listdir(cache_path):
+            if os.path.join(cache_path, cache_file) not in used:
+                os.remove(os.path.join(cache_path, cache_file))
+
 if __name__ == '__main__':
     parser = argparse.ArgumentParser(description='Assert generator tool')
     parser.add_argument('-d1', '--project_path')
@@ -283,6 +1010,19 @@ if __name__ == '__main__':
     parser.add_argument('-d9', '--split_height')
     parser.add_argument('-d10', '--max_name_len')
     parser.add_argument('-d11', '--support_qoi')
+    parser.add_argument('-d12', '--qoi_seek_interval', type=int, default=0)
+    parser.add_argument('-d13', '--qoi_effort', type=int, default=0)
+    parser.add_argument('-d14', '--split_header_version', type=int, default=2)
+    parser.add_argument('-d15', '--split_ram_budget', type=int, default=0)
+    parser.add_argument('-d16', '--raw_max_pixels', type=int, default=0)
+    parser.add_argument('-d17', '--raw_max_ratio', type=int, default=0)
+    parser.add_argument('-d18', '--raw_swap', default='OFF')
+    parser.add_argument('-d19', '--split_dedup', default='OFF')
+    parser.add_argument('-d20', '--anim_sequence', default='OFF')
+    parser.add_argument('-d21', '--build_report', default='OFF')
+    parser.add_argument('-d22', '--asset_align', type=int, default=1)
+    parser.add_argument('-d23', '--split_align', type=int, default=1)
+    parser.add_argument('-d24', '--asset_crc', default='OFF')
 
     args = parser.parse_args()
 
@@ -290,8 +1030,26 @@ if __name__ == '__main__':
     print('--support_spng:',  args.support_spng)
     print('--support_sjpg:',  args.support_sjpg)
     print('--support_qoi:',  args.support_qoi)
+    print('--build_report:',  args.build_report)
+    print('--asset_align:',  args.asset_align)
+    print('--asset_crc:',  args.asset_crc)
     if args.support_spng != 'OFF' or args.support_sjpg != 'OFF':
         print('--split_height:', args.split_height)
+    if args.support_spng != 'OFF' or args.support_sjpg != 'OFF' or args.support_qoi != 'OFF':
+        print('--split_header_version:', args.split_header_version)
+        print('--split_ram_budget:', args.split_ram_budget)
+        print('--split_dedup:', args.split_dedup)
+        print('--split_align:', args.split_align)
+    if args.support_qoi != 'OFF':
+        print('--qoi_seek_interval:', args.qoi_seek_interval)
+        print('--qoi_effort:', args.qoi_effort)
+        print('--raw_max_pixels:', args.raw_max_pixels)
+        print('--anim_sequence:', args.anim_sequence)
+
+    for name, align in (('asset_align', args.asset_align), ('split_align', args.split_align)):
+        if align < 1 or align & (align - 1):
+            print(f'\033[1;31mError:\033[0m {name} must be a power of two, not {align}.')
+            sys.exit(1)
 
     image_file = args.image_file
     target_path = os.path.dirname(image_file)
@@ -300,8 +1058,15 @@ if __name__ == '__main__':
         shutil.rmtree(target_path)
     os.makedirs(target_path)
 
-    copy_assets_to_build(args.assets_path, target_path, args.support_spng, args.support_sjpg, args.support_qoi, args.support_format, args.split_height)
-    pack_models(target_path, args.main_path, image_file, args.assets_path, args.max_name_len)
+    # The cache sits next to target_path, which is recreated on every build
+    cache_path = os.path.join(os.path.dirname(target_path), '.cache', os.path.basename(target_path))
+    copy_assets_to_build(args.assets_path, target_path, args.support_spng, args.support_sjpg, args.support_qoi, args.support_format, args.split_height, args.qoi_seek_interval, args.qoi_effort, args.split_header_version, args.split_ram_budget,
+                         args.raw_max_pixels, args.raw_max_ratio, args.raw_swap == 'ON', cache_path, args.anim_sequence == 'ON', args.split_align)
+    # Splits are only aligned in flash if the image holding them is
+    assets = pack_models(target_path, args.main_path, image_file, args.assets_path, args.max_name_len, args.split_dedup == 'ON',
+                         max(args.asset_align, args.split_align), args.asset_crc == 'ON')
+    if args.build_report == 'ON':
+        write_report(assets, image_file, args.size)
 
     total_size = os.path.getsize(os.path.join(target_path, image_file))
     recommended_size = int(math.ceil(total_size/1024))
@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2022-2024 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2022-2026 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -14,7 +14,7 @@
 #include "esp_mmap_assets.h"
 
 #define MMAP_DRIVE_B_FILES           3
-#define MMAP_DRIVE_B_CHECKSUM        0xED6D
+#define MMAP_DRIVE_B_CHECKSUM        0xEEA6
 
 enum MMAP_DRIVE_B_LISTS {
     MMAP_DRIVE_B_NAVI_52_JPG = 0,        /*!< navi_52.jpg */
@@ -4,6 +4,7 @@
  * SPDX-License-Identifier: CC0-1.0
  */
 
+#include <inttypes.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
@@ -13,6 +14,7 @@
 #include "esp_lv_fs.h"
 #include "esp_lv_sjpg.h"
 #include "esp_lv_spng.h"
+#include "esp_lv_sqoi.h"
 
 #include "perf_test_main.h"
 
@@ -77,6 +79,16 @@ esp_err_t test_mmap_drive_new(void)
     };
     mmap_assets_new(&asset_cfg_a, &mmap_drive_a_handle);
 
+    /* Images packed with CONFIG_MMAP_SPLIT_DEDUP read the splits they share from the pool */
+    int split_pool = mmap_assets_find(mmap_drive_a_handle, "split_pool.bin");
+    if (split_pool >= 0) {
+        const uint8_t *pool = mmap_assets_get_mem(mmap_drive_a_handle, split_pool);
+        size_t pool_size = mmap_assets_get_size(mmap_drive_a_handle, split_pool);
+        esp_lv_split_jpg_set_split_pool(pool, pool_size);
+        esp_lv_split_png_set_split_pool(pool, pool_size);
+        esp_lv_split_qoi_set_split_pool(pool, pool_size);
+    }
+
     const mmap_assets_config_t asset_cfg_b = {
         .partition_label = "assets_B",
         .max_files = MMAP_DRIVE_B_FILES,
@@ -90,6 +102,15 @@ esp_err_t test_mmap_drive_new(void)
 
 esp_err_t test_mmap_drive_del(void)
 {
+    mmap_assets_cache_stats_t stats;
+    if (mmap_assets_get_cache_stats(mmap_drive_b_handle, &stats) == ESP_OK) {
+        ESP_LOGI(TAG, "Drive B read cache: hits %" PRIu32 ", misses %" PRIu32 ", flash reads %" PRIu32 ", %" PRIu64 " bytes",
+                 stats.hits, stats.misses, stats.flash_reads, stats.flash_bytes);
+    }
+
+    esp_lv_split_jpg_set_split_pool(NULL, 0);
+    esp_lv_split_png_set_split_pool(NULL, 0);
+    esp_lv_split_qoi_set_split_pool(NULL, 0);
     mmap_assets_del(mmap_drive_a_handle);
     mmap_assets_del(mmap_drive_b_handle);
 
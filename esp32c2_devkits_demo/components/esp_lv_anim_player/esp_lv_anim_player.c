@@ -0,0 +1,514 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <string.h>
+#include "esp_log.h"
+#include "esp_err.h"
+#include "esp_check.h"
+#include "esp_timer.h"
+#include "esp_lv_qoi.h"
+#include "esp_lv_anim_player.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+#define PLAYER_FPS_WINDOW_US    1000000
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef struct esp_lv_anim_player_t {
+    lv_obj_t *img;
+    mmap_assets_handle_t assets;
+    int first;                          //Asset index of the first frame
+    int count;                          //Num frames
+    uint16_t fps;
+    esp_lv_anim_player_loop_t loop;
+    bool predecode;
+    bool prefetch;
+    bool playing;
+    lv_timer_t *timer;
+    esp_lv_qoi_anim_handle_t anim;      //Set for a ".aqoi" animation
+    lv_img_dsc_t src[2];                //Sources of separate frames, alternated so LVGL never sees the same source twice
+    int pinned[2];                      //Asset pinned by each source with mmap_window, -1 if none
+    uint8_t *buf[2];                    //Predecoded frames, NULL if not predecoding
+    lv_coord_t width;                   //Size of the predecoded frames
+    lv_coord_t height;
+    int back;                           //Index of the src and buf for the next frame
+    int next_frame;                     //Frame predecoded into buf[back], -1 if none
+    int64_t start_us;                   //Time of the first frame
+    uint32_t pos;                       //Position of the frame shown, counted in frames since start_us
+    int64_t draw_start_us;              //Start of the image's draw, 0 if not drawing
+    uint32_t frame_us;                  //Time spent on the frame shown
+    uint32_t next_us;                   //Time spent predecoding the next frame
+    uint64_t decode_total_us;
+    uint32_t decode_max_us;
+    uint32_t frames;
+    uint32_t dropped;
+    int64_t window_start_us;            //Achieved fps is counted over windows of PLAYER_FPS_WINDOW_US
+    uint32_t window_frames;
+    float window_fps;
+} esp_lv_anim_player_t;
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static esp_err_t player_load(esp_lv_anim_player_t *player, int first, int count, esp_lv_qoi_anim_handle_t *ret_old);
+static void player_restart(esp_lv_anim_player_t *player);
+static void player_show(esp_lv_anim_player_t *player, int frame);
+static void player_predecode(esp_lv_anim_player_t *player, int frame);
+static void player_prefetch(esp_lv_anim_player_t *player, int frame);
+static int player_frame(const esp_lv_anim_player_t *player, uint32_t pos);
+static uint32_t player_last_pos(const esp_lv_anim_player_t *player);
+static void player_free_bufs(esp_lv_anim_player_t *player);
+static void player_unpin(esp_lv_anim_player_t *player, int slot);
+static void player_timer_cb(lv_timer_t *timer);
+static void player_draw_cb(lv_event_t *e);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static const char *TAG = "anim_player";
+
+/**********************
+ *      MACROS
+ **********************/
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+esp_err_t esp_lv_anim_player_new(const esp_lv_anim_player_config_t *config, esp_lv_anim_player_handle_t *ret_handle)
+{
+    ESP_RETURN_ON_FALSE(config && ret_handle && config->img && config->assets && config->fps, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+
+    esp_lv_anim_player_t *player = calloc(1, sizeof(esp_lv_anim_player_t));
+    ESP_RETURN_ON_FALSE(player, ESP_ERR_NO_MEM, TAG, "Not enough memory for player allocation");
+
+    player->img = config->img;
+    player->assets = config->assets;
+    player->fps = config->fps;
+    player->loop = config->loop;
+    player->predecode = config->flags.predecode;
+    player->prefetch = config->flags.prefetch;
+    player->pinned[0] = -1;
+    player->pinned[1] = -1;
+
+    esp_err_t ret = player_load(player, config->first, config->count, NULL);
+    if (ret != ESP_OK) {
+        free(player);
+        return ret;
+    }
+
+    player->timer = lv_timer_create(player_timer_cb, LV_MAX(1000 / player->fps, 1), player);
+    if (!player->timer) {
+        player_free_bufs(player);
+        if (player->anim) {
+            esp_lv_qoi_anim_del(player->anim);
+            mmap_assets_release(player->assets, player->first);
+        }
+        free(player);
+        ESP_LOGE(TAG, "Not enough memory for timer allocation");
+        return ESP_ERR_NO_MEM;
+    }
+    lv_timer_pause(player->timer);
+
+    lv_obj_add_event_cb(player->img, player_draw_cb, LV_EVENT_DRAW_MAIN_BEGIN, player);
+    lv_obj_add_event_cb(player->img, player_draw_cb, LV_EVENT_DRAW_MAIN_END, player);
+    player_restart(player);
+
+    *ret_handle = player;
+    ESP_LOGD(TAG, "new player @%p, frames %d, %d fps", player, player->count, player->fps);
+
+    ESP_LOGI(TAG, "anim player create success, version: %d.%d.%d", ESP_LV_ANIM_PLAYER_VER_MAJOR, ESP_LV_ANIM_PLAYER_VER_MINOR, ESP_LV_ANIM_PLAYER_VER_PATCH);
+    return ESP_OK;
+}
+
+esp_err_t esp_lv_anim_player_set_range(esp_lv_anim_player_handle_t handle, int first, int count)
+{
+    ESP_RETURN_ON_FALSE(handle, ESP_ERR_INVALID_ARG, TAG, "invalid player handle pointer");
+
+    esp_lv_qoi_anim_handle_t old_anim = NULL;
+    int old_first = handle->first;
+    ESP_RETURN_ON_ERROR(player_load(handle, first, count, &old_anim), TAG, "load frames failed");
+    player_restart(handle);
+
+    /* The image shows the new source now, the old animation can go */
+    if (old_anim) {
+        esp_lv_qoi_anim_del(old_anim);
+        mmap_assets_release(handle->assets, old_first);
+    }
+
+    /* A single frame without a loop is shown already */
+    if (player_last_pos(handle) == 0) {
+        return esp_lv_anim_player_stop(handle);
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_lv_anim_player_start(esp_lv_anim_player_handle_t handle)
+{
+    ESP_RETURN_ON_FALSE(handle, ESP_ERR_INVALID_ARG, TAG, "invalid player handle pointer");
+
+    handle->decode_total_us = 0;
+    handle->decode_max_us = 0;
+    handle->frames = 0;
+    handle->dropped = 0;
+    handle->window_fps = 0;
+    player_restart(handle);
+
+    /* A single frame without a loop is shown already */
+    if (player_last_pos(handle) == 0) {
+        return esp_lv_anim_player_stop(handle);
+    }
+    handle->playing = true;
+    lv_timer_resume(handle->timer);
+    lv_timer_reset(handle->timer);
+    return ESP_OK;
+}
+
+esp_err_t esp_lv_anim_player_stop(esp_lv_anim_player_handle_t handle)
+{
+    ESP_RETURN_ON_FALSE(handle, ESP_ERR_INVALID_ARG, TAG, "invalid player handle pointer");
+
+    handle->playing = false;
+    lv_timer_pause(handle->timer);
+    return ESP_OK;
+}
+
+bool esp_lv_anim_player_is_playing(esp_lv_anim_player_handle_t handle)
+{
+    return handle && handle->playing;
+}
+
+esp_err_t esp_lv_anim_player_get_stats(esp_lv_anim_player_handle_t handle, esp_lv_anim_player_stats_t *stats)
+{
+    ESP_RETURN_ON_FALSE(handle && stats, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+
+    stats->fps = handle->window_fps;
+    stats->frames = handle->frames;
+    stats->dropped = handle->dropped;
+    stats->decode_avg_us = handle->frames ? handle->decode_total_us / handle->frames : 0;
+    stats->decode_max_us = LV_MAX(handle->decode_max_us, handle->frame_us);
+    return ESP_OK;
+}
+
+esp_err_t esp_lv_anim_player_del(esp_lv_anim_player_handle_t handle)
+{
+    ESP_RETURN_ON_FALSE(handle, ESP_ERR_INVALID_ARG, TAG, "invalid player handle pointer");
+    ESP_LOGD(TAG, "delete player @%p", handle);
+
+    lv_timer_del(handle->timer);
+    while (lv_obj_remove_event_cb_with_user_data(handle->img, player_draw_cb, handle));
+    lv_img_set_src(handle->img, NULL);
+    lv_obj_invalidate(handle->img);
+
+    player_free_bufs(handle);
+    player_unpin(handle, 0);
+    player_unpin(handle, 1);
+    if (handle->anim) {
+        esp_lv_qoi_anim_del(handle->anim);
+        mmap_assets_release(handle->assets, handle->first);
+    }
+    free(handle);
+    return ESP_OK;
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+/**
+ * Point the player at frames of its assets. A ".aqoi" animation replacing the
+ * current one is returned in ret_old, to be deleted once the image shows the new one.
+ * An animation keeps its asset pinned until it's deleted.
+ */
+static esp_err_t player_load(esp_lv_anim_player_t *player, int first, int count, esp_lv_qoi_anim_handle_t *ret_old)
+{
+    int stored = mmap_assets_get_stored_files(player->assets);
+    ESP_RETURN_ON_FALSE(first >= 0 && count > 0 && first + count <= stored, ESP_ERR_INVALID_ARG, TAG, "invalid frames [%d, %d) of %d assets", first, first + count, stored);
+
+    const uint8_t *mem = mmap_assets_get_mem(player->assets, first);
+    ESP_RETURN_ON_FALSE(mem, ESP_ERR_INVALID_STATE, TAG, "asset %d not mapped", first);
+    int size = mmap_assets_get_size(player->assets, first);
+    esp_lv_qoi_anim_handle_t anim = NULL;
+    if (count == 1 && size >= 7 && !memcmp(mem, "_AQOI__", 7)) {
+        esp_err_t ret = esp_lv_qoi_anim_new(mem, size, &anim);
+        if (ret != ESP_OK) {
+            mmap_assets_release(player->assets, first);
+            ESP_LOGE(TAG, "open animation failed");
+            return ret;
+        }
+        count = esp_lv_qoi_anim_get_frames(anim);
+    }
+
+    if (ret_old) {
+        *ret_old = player->anim;
+    }
+    player_free_bufs(player);
+    player->anim = anim;
+    player->first = first;
+    player->count = count;
+
+    /* An animation only decodes the splits that change, so it's never predecoded */
+    if (player->predecode && !anim && count > 1) {
+        lv_img_dsc_t asset = {
+            .header.cf = LV_IMG_CF_RAW_ALPHA,
+            .data = mem,
+            .data_size = size,
+        };
+        lv_img_header_t header;
+        if (lv_img_decoder_get_info(&asset, &header) == LV_RES_OK) {
+            size_t buf_size = (size_t)header.w * header.h * LV_IMG_PX_SIZE_ALPHA_BYTE;
+            player->buf[0] = malloc(buf_size);
+            player->buf[1] = malloc(buf_size);
+            player->width = header.w;
+            player->height = header.h;
+        }
+        if (!player->buf[0] || !player->buf[1]) {
+            player_free_bufs(player);
+            ESP_LOGW(TAG, "Not enough memory to predecode frames, decoding them while drawing");
+        }
+    }
+    if (!anim) {
+        mmap_assets_release(player->assets, first);
+    }
+    return ESP_OK;
+}
+
+/**
+ * Show the first frame and restart the clock
+ */
+static void player_restart(esp_lv_anim_player_t *player)
+{
+    player->pos = 0;
+    player->next_frame = -1;
+    player->next_us = 0;
+    player->start_us = esp_timer_get_time();
+    player->window_start_us = player->start_us;
+    player->window_frames = 0;
+
+    if (player->anim) {
+        lv_img_set_src(player->img, esp_lv_qoi_anim_get_src(player->anim));
+        player_unpin(player, 0);
+        player_unpin(player, 1);
+    }
+    player_show(player, 0);
+    player_predecode(player, player_frame(player, 1));
+    player_prefetch(player, player_frame(player, 1));
+}
+
+static void player_show(esp_lv_anim_player_t *player, int frame)
+{
+    if (player->anim) {
+        esp_lv_qoi_anim_set_frame(player->anim, frame, player->img);
+    } else {
+        lv_img_dsc_t *src = &player->src[player->back];
+        if (player->next_frame != frame) {
+            /* Not predecoded, LVGL decodes it while drawing */
+            int index = player->first + frame;
+            player_unpin(player, player->back);
+            const uint8_t *data = mmap_assets_get_mem(player->assets, index);
+            if (!data) {
+                ESP_LOGW(TAG, "Frame %d not mapped, skipped", frame);
+                return;
+            }
+            memset(src, 0, sizeof(lv_img_dsc_t));
+            src->header.cf = LV_IMG_CF_RAW_ALPHA;
+            src->data = data;
+            src->data_size = mmap_assets_get_size(player->assets, index);
+            player->pinned[player->back] = index;
+            player->next_us = 0;
+        }
+        lv_img_set_src(player->img, src);
+        /* The frame shown before isn't drawn anymore */
+        player_unpin(player, player->back ^ 1);
+        player->back ^= 1;
+        player->next_frame = -1;
+    }
+
+    int64_t now = esp_timer_get_time();
+    player->decode_max_us = LV_MAX(player->decode_max_us, player->frame_us);
+    player->frame_us = player->next_us;
+    player->next_us = 0;
+    player->frames++;
+    player->window_frames++;
+    if (now - player->window_start_us >= PLAYER_FPS_WINDOW_US) {
+        player->window_fps = player->window_frames * 1000000.0f / (now - player->window_start_us);
+        player->window_start_us = now;
+        player->window_frames = 0;
+    }
+}
+
+/**
+ * Decode `frame` into the back buffer, so showing it only needs a copy
+ */
+static void player_predecode(esp_lv_anim_player_t *player, int frame)
+{
+    if (!player->buf[0]) {
+        return;
+    }
+
+    int64_t start = esp_timer_get_time();
+    int index = player->first + frame;
+    lv_img_dsc_t asset = {
+        .header.cf = LV_IMG_CF_RAW_ALPHA,
+        .data = mmap_assets_get_mem(player->assets, index),
+        .data_size = mmap_assets_get_size(player->assets, index),
+    };
+    if (!asset.data) {
+        return;
+    }
+    lv_img_decoder_dsc_t dsc;
+    if (lv_img_decoder_open(&dsc, &asset, lv_color_black(), 0) != LV_RES_OK) {
+        mmap_assets_release(player->assets, index);
+        return;
+    }
+
+    /* The source may still point at a frame in flash, not drawn anymore once it's overwritten */
+    player_unpin(player, player->back);
+    uint8_t *buf = player->buf[player->back];
+    uint32_t line = player->width * LV_IMG_PX_SIZE_ALPHA_BYTE;
+    bool ok = dsc.header.w == player->width && dsc.header.h == player->height;
+    if (ok && dsc.img_data) {
+        /* Decoded by the decoder already, e.g. a full PNG, or a raw image without alpha */
+        ok = dsc.header.cf == LV_IMG_CF_TRUE_COLOR_ALPHA || dsc.header.cf == LV_IMG_CF_RAW_ALPHA;
+        if (ok) {
+            memcpy(buf, dsc.img_data, line * player->height);
+        }
+    } else {
+        for (lv_coord_t y = 0; ok && y < player->height; y++) {
+            ok = lv_img_decoder_read_line(&dsc, 0, y, player->width, buf + y * line) == LV_RES_OK;
+        }
+    }
+    lv_img_decoder_close(&dsc);
+    mmap_assets_release(player->assets, index);
+
+    if (ok) {
+        lv_img_dsc_t *src = &player->src[player->back];
+        memset(src, 0, sizeof(lv_img_dsc_t));
+        src->header.cf = LV_IMG_CF_TRUE_COLOR_ALPHA;
+        src->header.w = player->width;
+        src->header.h = player->height;
+        src->data = buf;
+        src->data_size = line * player->height;
+        player->next_frame = frame;
+        player->next_us = esp_timer_get_time() - start;
+        player->decode_total_us += player->next_us;
+    }
+}
+
+/**
+ * Have the assets task read `frame` into the flash cache while the current one is drawn
+ */
+static void player_prefetch(esp_lv_anim_player_t *player, int frame)
+{
+    /* A predecoded frame is read already, an animation is a single asset */
+    if (!player->prefetch || player->buf[0] || player->anim) {
+        return;
+    }
+
+    int index = player->first + frame;
+    if (mmap_assets_prefetch(player->assets, &index, 1, NULL, NULL) != ESP_OK) {
+        ESP_LOGD(TAG, "Frame %d not prefetched", frame);
+    }
+}
+
+/**
+ * Map a position, counted in frames since the start, to a frame
+ */
+static int player_frame(const esp_lv_anim_player_t *player, uint32_t pos)
+{
+    int count = player->count;
+    switch (player->loop) {
+    case ESP_LV_ANIM_PLAYER_LOOP_NONE:
+        return LV_MIN(pos, (uint32_t)count - 1);
+    case ESP_LV_ANIM_PLAYER_LOOP_PINGPONG:
+        if (count > 1) {
+            int p = pos % (2 * count - 2);
+            return p < count ? p : 2 * count - 2 - p;
+        }
+        return 0;
+    default:
+        return pos % count;
+    }
+}
+
+/**
+ * Last position worth showing, the last frame without a loop
+ */
+static uint32_t player_last_pos(const esp_lv_anim_player_t *player)
+{
+    return player->loop == ESP_LV_ANIM_PLAYER_LOOP_NONE ? (uint32_t)player->count - 1 : UINT32_MAX;
+}
+
+/**
+ * Release the asset pinned by a source, with mmap_window
+ */
+static void player_unpin(esp_lv_anim_player_t *player, int slot)
+{
+    if (player->pinned[slot] >= 0) {
+        mmap_assets_release(player->assets, player->pinned[slot]);
+        player->pinned[slot] = -1;
+    }
+}
+
+static void player_free_bufs(esp_lv_anim_player_t *player)
+{
+    for (int i = 0; i < 2; i++) {
+        free(player->buf[i]);
+        player->buf[i] = NULL;
+    }
+    player->next_frame = -1;
+}
+
+static void player_timer_cb(lv_timer_t *timer)
+{
+    esp_lv_anim_player_t *player = timer->user_data;
+
+    /* Frames follow the clock, not the ticks, so a late tick skips frames */
+    uint64_t elapsed = esp_timer_get_time() - player->start_us;
+    uint32_t pos = LV_MIN(elapsed * player->fps / 1000000, (uint64_t)player_last_pos(player));
+    if (pos <= player->pos) {
+        return;
+    }
+    player->dropped += pos - player->pos - 1;
+    player->pos = pos;
+    player_show(player, player_frame(player, pos));
+
+    if (pos == player_last_pos(player)) {
+        esp_lv_anim_player_stop(player);
+        return;
+    }
+
+    /* Draw this frame first, then decode the next one while waiting for its tick */
+    if (player->buf[0]) {
+        lv_refr_now(lv_obj_get_disp(player->img));
+        player_predecode(player, player_frame(player, pos + 1));
+    } else {
+        player_prefetch(player, player_frame(player, pos + 1));
+    }
+}
+
+/**
+ * Count the time LVGL spends drawing the image, decoding included
+ */
+static void player_draw_cb(lv_event_t *e)
+{
+    esp_lv_anim_player_t *player = lv_event_get_user_data(e);
+
+    if (lv_event_get_code(e) == LV_EVENT_DRAW_MAIN_BEGIN) {
+        player->draw_start_us = esp_timer_get_time();
+    } else if (player->draw_start_us) {
+        uint32_t us = esp_timer_get_time() - player->draw_start_us;
+        player->frame_us += us;
+        player->decode_total_us += us;
+        player->draw_start_us = 0;
+    }
+}
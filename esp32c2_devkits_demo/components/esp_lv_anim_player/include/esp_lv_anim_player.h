@@ -0,0 +1,143 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include "lvgl.h"
+#include "esp_mmap_assets.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief What a player does after the last frame
+ */
+typedef enum {
+    ESP_LV_ANIM_PLAYER_LOOP_NONE,           /*!< Stop on the last frame */
+    ESP_LV_ANIM_PLAYER_LOOP_RESTART,        /*!< Continue with the first frame */
+    ESP_LV_ANIM_PLAYER_LOOP_PINGPONG,       /*!< Play backwards to the first frame, then forwards again */
+} esp_lv_anim_player_loop_t;
+
+/**
+ * @brief Player configuration
+ */
+typedef struct {
+    lv_obj_t *img;                          /*!< Image object showing the frames, it has to outlive the player */
+    mmap_assets_handle_t assets;            /*!< Assets holding the frames */
+    int first;                              /*!< Asset index of the first frame, or of a ".aqoi" animation */
+    int count;                              /*!< Number of frames, each one an asset, 1 for a ".aqoi" animation */
+    uint16_t fps;                           /*!< Target frames per second */
+    esp_lv_anim_player_loop_t loop;         /*!< What to do after the last frame */
+    struct {
+        unsigned int predecode: 1;          /*!< Decode the next frame into RAM after the current one was drawn, needs two frame buffers */
+        unsigned int prefetch: 1;           /*!< Prefetch the next frame with mmap_assets_prefetch() while the current one is drawn, if not predecoding */
+        unsigned int reserved: 30;          /*!< Reserved for future use */
+    } flags;                                /*!< Configuration flags */
+} esp_lv_anim_player_config_t;
+
+/**
+ * @brief Player statistics, since the player was last started
+ */
+typedef struct {
+    float fps;                              /*!< Frames shown per second, over the last second */
+    uint32_t frames;                        /*!< Frames shown */
+    uint32_t dropped;                       /*!< Frames skipped because the player was late */
+    uint32_t decode_avg_us;                 /*!< Average time spent decoding and drawing a frame */
+    uint32_t decode_max_us;                 /*!< Longest time spent decoding and drawing a frame */
+} esp_lv_anim_player_stats_t;
+
+/**
+ * @brief Type of handle for an animation player
+ */
+typedef struct esp_lv_anim_player_t *esp_lv_anim_player_handle_t;
+
+/**
+ * @brief Create a player, stopped on the first frame
+ *
+ * Frames are advanced by an LVGL timer, on the time the player was started rather
+ * than on the number of ticks, so frames are dropped when drawing can't keep up.
+ * A ".aqoi" animation (esp_lv_qoi) only redraws what changes between frames.
+ * All player functions have to be called with the LVGL lock held.
+ *
+ * @param config Player configuration
+ * @param ret_handle Pointer to the handle where the player handle will be stored
+ * @return
+ *     - ESP_OK on success
+ *     - ESP_ERR_INVALID_ARG if the configuration or the frames are invalid
+ *     - ESP_ERR_NO_MEM if out of memory
+ */
+esp_err_t esp_lv_anim_player_new(const esp_lv_anim_player_config_t *config, esp_lv_anim_player_handle_t *ret_handle);
+
+/**
+ * @brief Switch a player to other frames of its assets
+ *
+ * The player shows the first of the new frames and keeps playing if it was,
+ * unless the new range is a single frame without a loop.
+ *
+ * @param handle Player handle
+ * @param first Asset index of the first frame, or of a ".aqoi" animation
+ * @param count Number of frames, 1 for a ".aqoi" animation
+ * @return
+ *     - ESP_OK on success
+ *     - ESP_ERR_INVALID_ARG if the handle or the frames are invalid
+ *     - ESP_ERR_NO_MEM if out of memory
+ */
+esp_err_t esp_lv_anim_player_set_range(esp_lv_anim_player_handle_t handle, int first, int count);
+
+/**
+ * @brief Start playing from the first frame, and reset the statistics
+ *
+ * @param handle Player handle
+ * @return
+ *     - ESP_OK on success
+ *     - ESP_ERR_INVALID_ARG if the handle is invalid
+ */
+esp_err_t esp_lv_anim_player_start(esp_lv_anim_player_handle_t handle);
+
+/**
+ * @brief Stop playing, the current frame stays shown
+ *
+ * @param handle Player handle
+ * @return
+ *     - ESP_OK on success
+ *     - ESP_ERR_INVALID_ARG if the handle is invalid
+ */
+esp_err_t esp_lv_anim_player_stop(esp_lv_anim_player_handle_t handle);
+
+/**
+ * @brief Check if a player is playing
+ *
+ * @param handle Player handle
+ * @return true until stopped, or until the last frame with ESP_LV_ANIM_PLAYER_LOOP_NONE
+ */
+bool esp_lv_anim_player_is_playing(esp_lv_anim_player_handle_t handle);
+
+/**
+ * @brief Get the statistics of a player
+ *
+ * @param handle Player handle
+ * @param stats Filled with the statistics
+ * @return
+ *     - ESP_OK on success
+ *     - ESP_ERR_INVALID_ARG if an argument is invalid
+ */
+esp_err_t esp_lv_anim_player_get_stats(esp_lv_anim_player_handle_t handle, esp_lv_anim_player_stats_t *stats);
+
+/**
+ * @brief Delete a player, the image object keeps no source from it
+ *
+ * @param handle Player handle
+ * @return
+ *     - ESP_OK on success
+ *     - ESP_ERR_INVALID_ARG if the handle is invalid
+ */
+esp_err_t esp_lv_anim_player_del(esp_lv_anim_player_handle_t handle);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
@@ -0,0 +1,30 @@
+/*
+ * SPDX-FileCopyrightText: 2022-2026 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * @file
+ * @brief This file was generated by esp_mmap_assets, don't modify it
+ */
+
+#pragma once
+
+#include "esp_mmap_assets.h"
+
+#define MMAP_SPIFFS_ASSETS_FILES           4
+#define MMAP_SPIFFS_ASSETS_CHECKSUM        0xB10F
+
+enum MMAP_SPIFFS_ASSETS_LISTS {
+    MMAP_SPIFFS_ASSETS_ANIM_AQOI = 0,        /*!< anim.aqoi */
+    MMAP_SPIFFS_ASSETS_FRAME_A_SQOI = 1,        /*!< frame_a.sqoi */
+    MMAP_SPIFFS_ASSETS_FRAME_B_SQOI = 2,        /*!< frame_b.sqoi */
+    MMAP_SPIFFS_ASSETS_FRAME_C_SQOI = 3,        /*!< frame_c.sqoi */
+};
+
+/* Split height of each split image */
+#define MMAP_SPIFFS_ASSETS_ANIM_AQOI_SPLIT_HEIGHT    8
+#define MMAP_SPIFFS_ASSETS_FRAME_A_SQOI_SPLIT_HEIGHT    8
+#define MMAP_SPIFFS_ASSETS_FRAME_B_SQOI_SPLIT_HEIGHT    8
+#define MMAP_SPIFFS_ASSETS_FRAME_C_SQOI_SPLIT_HEIGHT    8
@@ -0,0 +1,278 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <inttypes.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_check.h"
+
+#include "unity.h"
+#include "unity_test_runner.h"
+#include "unity_test_utils_memory.h"
+
+#include "esp_lv_qoi.h"
+#include "esp_lv_anim_player.h"
+#include "mmap_generate_spiffs_assets.h"
+#include "lvgl.h"
+
+static const char *TAG = "anim player test";
+
+#define TEST_LCD_H_RES      100
+#define TEST_LCD_V_RES      100
+#define TEST_TICK_MS        5
+
+static uint32_t flush_count;
+
+static void test_flush_callback(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_map)
+{
+    flush_count++;
+    lv_disp_flush_ready(drv);
+}
+
+static void test_lvgl_init(lv_disp_drv_t **disp_drv, lv_disp_draw_buf_t **disp_buf)
+{
+    /* LVGL init */
+    lv_init();
+
+    *disp_buf = heap_caps_malloc(sizeof(lv_disp_draw_buf_t), MALLOC_CAP_DEFAULT);
+    TEST_ASSERT_NOT_NULL(*disp_buf);
+
+    /* Initialize LVGL draw buffers */
+    uint32_t buffer_size = TEST_LCD_H_RES * TEST_LCD_V_RES;
+    lv_color_t *buf1 = heap_caps_malloc(buffer_size * sizeof(lv_color_t), MALLOC_CAP_DEFAULT);
+    TEST_ASSERT_NOT_NULL(buf1);
+    lv_disp_draw_buf_init(*disp_buf, buf1, NULL, buffer_size);
+
+    *disp_drv = heap_caps_malloc(sizeof(lv_disp_drv_t), MALLOC_CAP_DEFAULT);
+    TEST_ASSERT_NOT_NULL(*disp_drv);
+    /* Descriptor of a display driver */
+    lv_disp_drv_init(*disp_drv);
+    (*disp_drv)->hor_res = TEST_LCD_H_RES;
+    (*disp_drv)->ver_res = TEST_LCD_V_RES;
+    (*disp_drv)->flush_cb = test_flush_callback;
+    (*disp_drv)->draw_buf = *disp_buf;
+
+    /* Finally register the driver */
+    lv_disp_drv_register(*disp_drv);
+    flush_count = 0;
+}
+
+static void test_lvgl_deinit(lv_disp_drv_t *disp_drv, lv_disp_draw_buf_t *disp_buf)
+{
+    free(disp_drv->draw_buf->buf1);
+    free(disp_drv->draw_buf);
+    free(disp_drv);
+    lv_deinit();
+}
+
+static mmap_assets_handle_t test_assets_new(void)
+{
+    mmap_assets_handle_t assets = NULL;
+    const mmap_assets_config_t config = {
+        .partition_label = "assets",
+        .max_files = MMAP_SPIFFS_ASSETS_FILES,
+        .checksum = MMAP_SPIFFS_ASSETS_CHECKSUM,
+        .flags = {
+            .mmap_enable = true,
+        },
+    };
+
+    TEST_ESP_OK(mmap_assets_new(&config, &assets));
+    return assets;
+}
+
+/* Run LVGL until the player stops or `ms` pass */
+static void test_play(esp_lv_anim_player_handle_t player, uint32_t ms)
+{
+    for (uint32_t t = 0; t < ms && esp_lv_anim_player_is_playing(player); t += TEST_TICK_MS) {
+        lv_tick_inc(TEST_TICK_MS);
+        lv_timer_handler();
+        vTaskDelay(pdMS_TO_TICKS(TEST_TICK_MS));
+    }
+}
+
+static void test_play_frames(bool predecode, bool prefetch)
+{
+    lv_disp_drv_t *disp_drv = NULL;
+    lv_disp_draw_buf_t *disp_buf = NULL;
+    esp_lv_qoi_decoder_handle_t qoi_handle = NULL;
+    esp_lv_anim_player_handle_t player = NULL;
+
+    test_lvgl_init(&disp_drv, &disp_buf);
+    TEST_ESP_OK(esp_lv_qoi_init(&qoi_handle));
+    mmap_assets_handle_t assets = test_assets_new();
+
+    lv_obj_t *img = lv_img_create(lv_scr_act());
+    lv_obj_set_align(img, LV_ALIGN_TOP_LEFT);
+
+    const esp_lv_anim_player_config_t config = {
+        .img = img,
+        .assets = assets,
+        .first = MMAP_SPIFFS_ASSETS_FRAME_A_SQOI,
+        .count = 3,
+        .fps = 20,
+        .loop = ESP_LV_ANIM_PLAYER_LOOP_NONE,
+        .flags = {
+            .predecode = predecode,
+            .prefetch = prefetch,
+        },
+    };
+    TEST_ESP_OK(esp_lv_anim_player_new(&config, &player));
+    TEST_ASSERT_FALSE(esp_lv_anim_player_is_playing(player));
+    TEST_ESP_OK(esp_lv_anim_player_start(player));
+    test_play(player, 3000);
+
+    /* Without a loop the player stops on the last frame, shown or dropped on the way */
+    esp_lv_anim_player_stats_t stats;
+    TEST_ESP_OK(esp_lv_anim_player_get_stats(player, &stats));
+    ESP_LOGI(TAG, "frames %"PRIu32", dropped %"PRIu32", decode avg %"PRIu32" us, max %"PRIu32" us",
+             stats.frames, stats.dropped, stats.decode_avg_us, stats.decode_max_us);
+    TEST_ASSERT_FALSE(esp_lv_anim_player_is_playing(player));
+    TEST_ASSERT_EQUAL_UINT32(config.count, stats.frames + stats.dropped);
+    TEST_ASSERT_GREATER_THAN_UINT32(0, stats.decode_max_us);
+    TEST_ASSERT_GREATER_THAN_UINT32(0, flush_count);
+
+    TEST_ESP_OK(esp_lv_anim_player_del(player));
+    TEST_ESP_OK(mmap_assets_del(assets));
+    TEST_ESP_OK(esp_lv_qoi_deinit(qoi_handle));
+    test_lvgl_deinit(disp_drv, disp_buf);
+    vTaskDelay(pdMS_TO_TICKS(10));  // Let the idle task free the prefetch task
+}
+
+TEST_CASE("Play a range of assets", "[anim_player][frames]")
+{
+    test_play_frames(false, false);
+}
+
+TEST_CASE("Play a range of predecoded assets", "[anim_player][predecode]")
+{
+    test_play_frames(true, false);
+}
+
+TEST_CASE("Play a range of prefetched assets", "[anim_player][prefetch]")
+{
+    test_play_frames(false, true);
+}
+
+TEST_CASE("Play a single frame", "[anim_player][single]")
+{
+    lv_disp_drv_t *disp_drv = NULL;
+    lv_disp_draw_buf_t *disp_buf = NULL;
+    esp_lv_qoi_decoder_handle_t qoi_handle = NULL;
+    esp_lv_anim_player_handle_t player = NULL;
+
+    test_lvgl_init(&disp_drv, &disp_buf);
+    TEST_ESP_OK(esp_lv_qoi_init(&qoi_handle));
+    mmap_assets_handle_t assets = test_assets_new();
+
+    lv_obj_t *img = lv_img_create(lv_scr_act());
+    lv_obj_set_align(img, LV_ALIGN_TOP_LEFT);
+
+    const esp_lv_anim_player_config_t config = {
+        .img = img,
+        .assets = assets,
+        .first = MMAP_SPIFFS_ASSETS_FRAME_A_SQOI,
+        .count = 1,
+        .fps = 20,
+        .loop = ESP_LV_ANIM_PLAYER_LOOP_NONE,
+    };
+    TEST_ESP_OK(esp_lv_anim_player_new(&config, &player));
+
+    /* The only frame is the last one, shown already, so the player stops right away */
+    TEST_ESP_OK(esp_lv_anim_player_start(player));
+    TEST_ASSERT_FALSE(esp_lv_anim_player_is_playing(player));
+    test_play(player, 200);
+    TEST_ASSERT_FALSE(esp_lv_anim_player_is_playing(player));
+
+    /* The same when switching a playing player to a single frame */
+    TEST_ESP_OK(esp_lv_anim_player_set_range(player, MMAP_SPIFFS_ASSETS_FRAME_A_SQOI, 3));
+    TEST_ESP_OK(esp_lv_anim_player_start(player));
+    TEST_ASSERT_TRUE(esp_lv_anim_player_is_playing(player));
+    TEST_ESP_OK(esp_lv_anim_player_set_range(player, MMAP_SPIFFS_ASSETS_FRAME_B_SQOI, 1));
+    TEST_ASSERT_FALSE(esp_lv_anim_player_is_playing(player));
+    test_play(player, 200);
+    TEST_ASSERT_FALSE(esp_lv_anim_player_is_playing(player));
+
+    TEST_ESP_OK(esp_lv_anim_player_del(player));
+    TEST_ESP_OK(mmap_assets_del(assets));
+    TEST_ESP_OK(esp_lv_qoi_deinit(qoi_handle));
+    test_lvgl_deinit(disp_drv, disp_buf);
+}
+
+TEST_CASE("Play a QOI animation", "[anim_player][aqoi]")
+{
+    lv_disp_drv_t *disp_drv = NULL;
+    lv_disp_draw_buf_t *disp_buf = NULL;
+    esp_lv_qoi_decoder_handle_t qoi_handle = NULL;
+    esp_lv_anim_player_handle_t player = NULL;
+
+    test_lvgl_init(&disp_drv, &disp_buf);
+    TEST_ESP_OK(esp_lv_qoi_init(&qoi_handle));
+    mmap_assets_handle_t assets = test_assets_new();
+
+    lv_obj_t *img = lv_img_create(lv_scr_act());
+    lv_obj_set_align(img, LV_ALIGN_TOP_LEFT);
+
+    const esp_lv_anim_player_config_t config = {
+        .img = img,
+        .assets = assets,
+        .first = MMAP_SPIFFS_ASSETS_ANIM_AQOI,
+        .count = 1,
+        .fps = 30,
+        .loop = ESP_LV_ANIM_PLAYER_LOOP_PINGPONG,
+    };
+    TEST_ESP_OK(esp_lv_anim_player_new(&config, &player));
+    TEST_ESP_OK(esp_lv_anim_player_start(player));
+    test_play(player, 1500);
+
+    esp_lv_anim_player_stats_t stats;
+    TEST_ESP_OK(esp_lv_anim_player_get_stats(player, &stats));
+    ESP_LOGI(TAG, "%.1f fps, frames %"PRIu32", dropped %"PRIu32", decode avg %"PRIu32" us", stats.fps, stats.frames,
+             stats.dropped, stats.decode_avg_us);
+    TEST_ASSERT_TRUE(esp_lv_anim_player_is_playing(player));
+    TEST_ASSERT_GREATER_THAN_UINT32(1, stats.frames);
+    TEST_ASSERT_TRUE(stats.fps > 0);
+
+    /* Switch to separate frames while playing */
+    TEST_ESP_OK(esp_lv_anim_player_set_range(player, MMAP_SPIFFS_ASSETS_FRAME_A_SQOI, 3));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, esp_lv_anim_player_set_range(player, MMAP_SPIFFS_ASSETS_FRAME_A_SQOI, MMAP_SPIFFS_ASSETS_FILES));
+    test_play(player, 200);
+    TEST_ESP_OK(esp_lv_anim_player_stop(player));
+    TEST_ASSERT_FALSE(esp_lv_anim_player_is_playing(player));
+
+    TEST_ESP_OK(esp_lv_anim_player_del(player));
+    TEST_ESP_OK(mmap_assets_del(assets));
+    TEST_ESP_OK(esp_lv_qoi_deinit(qoi_handle));
+    test_lvgl_deinit(disp_drv, disp_buf);
+}
+
+// Some resources are lazy allocated in the LCD driver, the threadhold is left for that case
+#define TEST_MEMORY_LEAK_THRESHOLD  (500)
+
+static size_t before_free_8bit;
+static size_t before_free_32bit;
+
+void setUp(void)
+{
+    before_free_8bit = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    before_free_32bit = heap_caps_get_free_size(MALLOC_CAP_32BIT);
+}
+
+void tearDown(void)
+{
+    size_t after_free_8bit = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    size_t after_free_32bit = heap_caps_get_free_size(MALLOC_CAP_32BIT);
+    unity_utils_check_leak(before_free_8bit, after_free_8bit, "8BIT", TEST_MEMORY_LEAK_THRESHOLD);
+    unity_utils_check_leak(before_free_32bit, after_free_32bit, "32BIT", TEST_MEMORY_LEAK_THRESHOLD);
+}
+
+void app_main(void)
+{
+    printf("ESP anim player TEST \n");
+    unity_run_menu();
+}
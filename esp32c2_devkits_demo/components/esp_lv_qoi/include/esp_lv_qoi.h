@@ -7,6 +7,7 @@
 #pragma once
 
 #include "esp_err.h"
+#include "lvgl.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -37,6 +38,84 @@ esp_err_t esp_lv_qoi_init(esp_lv_qoi_decoder_handle_t *ret_handle);
  */
 esp_err_t esp_lv_qoi_deinit(esp_lv_qoi_decoder_handle_t handle);
 
+/**
+ * @brief Register the pool of splits shared by deduplicated images
+ *
+ * With CONFIG_MMAP_SPLIT_DEDUP, V3 split images read the splits they share with
+ * other images from the "split_pool.bin" asset, outside their own bytes. The
+ * decoder only follows those to the registered pool, so such images don't
+ * decode until it's registered. The pool has to stay mapped while they're drawn.
+ *
+ * @param pool Pool, e.g. mmap_assets_get_mem() of "split_pool.bin", NULL to unregister it
+ * @param size Num bytes in pool
+ * @return
+ *     - ESP_OK on success
+ *     - ESP_ERR_INVALID_ARG if pool is NULL and size isn't 0
+ */
+esp_err_t esp_lv_qoi_set_split_pool(const void *pool, size_t size);
+
+/**
+ * @brief Type of handle for a QOI animation
+ */
+typedef void *esp_lv_qoi_anim_handle_t;
+
+/**
+ * @brief Open a QOI animation (".aqoi" asset) for an LVGL image
+ *
+ * The animation is drawn by the decoder, split by split, without a frame buffer.
+ * Nothing is copied, `data` has to stay valid until the animation is deleted.
+ *
+ * @param data Animation, e.g. from mmap_assets_get_mem()
+ * @param size Num bytes in data
+ * @param ret_handle Pointer to the handle where the animation handle will be stored
+ * @return
+ *     - ESP_OK on success
+ *     - ESP_ERR_INVALID_ARG if data isn't a valid animation
+ *     - ESP_ERR_NO_MEM if out of memory
+ */
+esp_err_t esp_lv_qoi_anim_new(const void *data, size_t size, esp_lv_qoi_anim_handle_t *ret_handle);
+
+/**
+ * @brief Get the image source of an animation, to be set once with lv_img_set_src()
+ *
+ * @param handle Animation handle
+ * @return Image source, NULL for an invalid handle
+ */
+const lv_img_dsc_t *esp_lv_qoi_anim_get_src(esp_lv_qoi_anim_handle_t handle);
+
+/**
+ * @brief Get the number of frames of an animation
+ *
+ * @param handle Animation handle
+ * @return Number of frames, 0 for an invalid handle
+ */
+uint16_t esp_lv_qoi_anim_get_frames(esp_lv_qoi_anim_handle_t handle);
+
+/**
+ * @brief Show a frame of an animation
+ *
+ * Only the areas of `img` that differ from the frame shown before are invalidated,
+ * so LVGL decodes and flushes just those. Call it with the LVGL lock held.
+ *
+ * @param handle Animation handle
+ * @param frame Frame index, below the number of frames
+ * @param img Unscaled, unrotated image object showing the animation's source, NULL to invalidate nothing
+ * @return
+ *     - ESP_OK on success
+ *     - ESP_ERR_INVALID_ARG if the handle or frame is invalid
+ */
+esp_err_t esp_lv_qoi_anim_set_frame(esp_lv_qoi_anim_handle_t handle, uint16_t frame, lv_obj_t *img);
+
+/**
+ * @brief Delete an animation
+ *
+ * @param handle Animation handle
+ * @return
+ *     - ESP_OK on success
+ *     - ESP_ERR_INVALID_ARG if the handle is invalid
+ */
+esp_err_t esp_lv_qoi_anim_del(esp_lv_qoi_anim_handle_t handle);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
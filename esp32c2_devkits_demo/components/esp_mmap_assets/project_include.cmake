@@ -2,67 +2,80 @@
 #
 # Create a spiffs image of the specified directory on the host during build and optionally
 # have the created image flashed using `idf.py flash`
+#
+# Set MMAP_PACK_TOOL to a host build of qoi_bench/mmap_pack to pack QOI assets with it
+# instead of spiffs_assets_gen.py, without Pillow, numpy and qoi.
+set(MMAP_PACK_TOOL "" CACHE FILEPATH "Native asset packer, spiffs_assets_gen.py if empty")
+
 function(spiffs_create_partition_assets partition base_dir)
     set(options FLASH_IN_PROJECT)
     set(multi DEPENDS)
     cmake_parse_arguments(arg "${options}" "" "${multi}" "${ARGN}")
 
-    # Try to install Pillow using pip
-    idf_build_get_property(python PYTHON)
-    execute_process(
-        COMMAND ${python} -c "import PIL"
-        RESULT_VARIABLE PIL_FOUND
-        OUTPUT_QUIET
-        ERROR_QUIET
-    )
-
-    if(PIL_FOUND EQUAL 0)
-        message(STATUS "Pillow is installed.")
+    if(MMAP_PACK_TOOL)
+        if(NOT EXISTS "${MMAP_PACK_TOOL}")
+            message(FATAL_ERROR "MMAP_PACK_TOOL '${MMAP_PACK_TOOL}' not found. Build it with `make pack` in qoi_bench.")
+        endif()
+        message(STATUS "Packing assets with ${MMAP_PACK_TOOL}")
+        set(pack_command ${MMAP_PACK_TOOL})
     else()
-        message(STATUS "Pillow not found. Attempting to install it using pip...")
-
+        # Try to install Pillow using pip
+        idf_build_get_property(python PYTHON)
         execute_process(
-            COMMAND ${python} -m pip install -U Pillow
-            RESULT_VARIABLE result
-            OUTPUT_VARIABLE output
-            ERROR_VARIABLE error
-            OUTPUT_STRIP_TRAILING_WHITESPACE
-            ERROR_STRIP_TRAILING_WHITESPACE
+            COMMAND ${python} -c "import PIL"
+            RESULT_VARIABLE PIL_FOUND
+            OUTPUT_QUIET
+            ERROR_QUIET
         )
 
-        if(result)
-            message(FATAL_ERROR "Failed to install Pillow using pip. Please install it manually.\nError: ${error}")
+        if(PIL_FOUND EQUAL 0)
+            message(STATUS "Pillow is installed.")
         else()
-            message(STATUS "Pillow successfully installed.")
+            message(STATUS "Pillow not found. Attempting to install it using pip...")
+
+            execute_process(
+                COMMAND ${python} -m pip install -U Pillow
+                RESULT_VARIABLE result
+                OUTPUT_VARIABLE output
+                ERROR_VARIABLE error
+                OUTPUT_STRIP_TRAILING_WHITESPACE
+                ERROR_STRIP_TRAILING_WHITESPACE
+            )
+
+            if(result)
+                message(FATAL_ERROR "Failed to install Pillow using pip. Please install it manually.\nError: ${error}")
+            else()
+                message(STATUS "Pillow successfully installed.")
+            endif()
         endif()
-    endif()
-
-    # Try to install qoi using pip
-    execute_process(
-        COMMAND ${python} -c "import qoi"
-        RESULT_VARIABLE QOI_FOUND
-        OUTPUT_QUIET
-        ERROR_QUIET
-    )
-
-    if(QOI_FOUND EQUAL 0)
-        message(STATUS "qoi is installed.")
-    else()
-        message(STATUS "qoi not found. Attempting to install it using pip...")
 
+        # Try to install qoi using pip
         execute_process(
-            COMMAND ${python} -m pip install -U qoi
-            RESULT_VARIABLE result
-            OUTPUT_VARIABLE output
-            ERROR_VARIABLE error
-            OUTPUT_STRIP_TRAILING_WHITESPACE
-            ERROR_STRIP_TRAILING_WHITESPACE
+            COMMAND ${python} -c "import qoi"
+            RESULT_VARIABLE QOI_FOUND
+            OUTPUT_QUIET
+            ERROR_QUIET
         )
 
-        if(result)
-            message(FATAL_ERROR "Failed to install qoi using pip. Please install it manually.\nError: ${error}")
+        if(QOI_FOUND EQUAL 0)
+            message(STATUS "qoi is installed.")
         else()
-            message(STATUS "qoi successfully installed.")
+            message(STATUS "qoi not found. Attempting to install it using pip...")
+
+            execute_process(
+                COMMAND ${python} -m pip install -U qoi
+                RESULT_VARIABLE result
+                OUTPUT_VARIABLE output
+                ERROR_VARIABLE error
+                OUTPUT_STRIP_TRAILING_WHITESPACE
+                ERROR_STRIP_TRAILING_WHITESPACE
+            )
+
+            if(result)
+                message(FATAL_ERROR "Failed to install qoi using pip. Please install it manually.\nError: ${error}")
+            else()
+                message(STATUS "qoi successfully installed.")
+            endif()
         endif()
     endif()
 
@@ -94,18 +107,55 @@ function(spiffs_create_partition_assets partition base_dir)
 
         set(image_file ${CMAKE_BINARY_DIR}/mmap_build/${base_dir_name}/${partition}.bin)
         set(MVMODEL_EXE ${TARGET_COMPONENT_PATH}/spiffs_assets_gen.py)
+        if(NOT MMAP_PACK_TOOL)
+            set(pack_command python ${MVMODEL_EXE})
+        endif()
 
         set(MMAP_SUPPORT_SPNG "$<IF:$<STREQUAL:${CONFIG_MMAP_SUPPORT_SPNG},y>,ON,OFF>")
         set(MMAP_SUPPORT_SJPG "$<IF:$<STREQUAL:${CONFIG_MMAP_SUPPORT_SJPG},y>,ON,OFF>")
         set(MMAP_SUPPORT_QOI "$<IF:$<STREQUAL:${CONFIG_MMAP_SUPPORT_QOI},y>,ON,OFF>")
+        set(MMAP_SPLIT_DEDUP "$<IF:$<STREQUAL:${CONFIG_MMAP_SPLIT_DEDUP},y>,ON,OFF>")
+        set(MMAP_ANIM_SEQUENCE "$<IF:$<STREQUAL:${CONFIG_MMAP_ANIM_SEQUENCE},y>,ON,OFF>")
+        set(MMAP_BUILD_REPORT "$<IF:$<STREQUAL:${CONFIG_MMAP_BUILD_REPORT},y>,ON,OFF>")
+        set(MMAP_ASSET_CRC "$<IF:$<STREQUAL:${CONFIG_MMAP_ASSET_CRC},y>,ON,OFF>")
 
         if(NOT DEFINED CONFIG_MMAP_SPLIT_HEIGHT OR CONFIG_MMAP_SPLIT_HEIGHT STREQUAL "")
             set(CONFIG_MMAP_SPLIT_HEIGHT 0)  # Default value
         endif()
 
+        if(NOT DEFINED CONFIG_MMAP_SPLIT_RAM_BUDGET OR CONFIG_MMAP_SPLIT_RAM_BUDGET STREQUAL "")
+            set(CONFIG_MMAP_SPLIT_RAM_BUDGET 0)  # Default value, fixed split height
+        endif()
+
+        if(NOT DEFINED CONFIG_MMAP_SPLIT_HEADER_VERSION OR CONFIG_MMAP_SPLIT_HEADER_VERSION STREQUAL "")
+            set(CONFIG_MMAP_SPLIT_HEADER_VERSION 2)  # Default value
+        endif()
+
+        if(NOT CONFIG_MMAP_SUPPORT_RAW)
+            set(CONFIG_MMAP_RAW_MAX_PIXELS 0)  # Default value, no raw images
+            set(CONFIG_MMAP_RAW_MAX_RATIO 0)
+        elseif(NOT CONFIG_LV_COLOR_DEPTH_16)
+            message(WARNING "MMAP_SUPPORT_RAW needs LV_COLOR_DEPTH 16, images are stored as QOI.")
+            set(CONFIG_MMAP_RAW_MAX_PIXELS 0)
+            set(CONFIG_MMAP_RAW_MAX_RATIO 0)
+        endif()
+        set(MMAP_RAW_SWAP "$<IF:$<STREQUAL:${CONFIG_LV_COLOR_16_SWAP},y>,ON,OFF>")
+
+        if(NOT DEFINED CONFIG_MMAP_SPLIT_ALIGN OR CONFIG_MMAP_SPLIT_ALIGN STREQUAL "")
+            set(CONFIG_MMAP_SPLIT_ALIGN 1)  # Default value, splits not aligned
+        endif()
+
+        if(NOT DEFINED CONFIG_MMAP_QOI_SEEK_INTERVAL OR CONFIG_MMAP_QOI_SEEK_INTERVAL STREQUAL "")
+            set(CONFIG_MMAP_QOI_SEEK_INTERVAL 0)  # Default value
+        endif()
+
+        if(NOT DEFINED CONFIG_MMAP_QOI_EFFORT OR CONFIG_MMAP_QOI_EFFORT STREQUAL "")
+            set(CONFIG_MMAP_QOI_EFFORT 0)  # Default value
+        endif()
+
         add_custom_target(spiffs_${partition}_bin ALL
             COMMENT "Move and Pack assets..."
-            COMMAND python ${MVMODEL_EXE}
+            COMMAND ${pack_command}
             -d1 ${PROJECT_DIR}
             -d2 ${CMAKE_CURRENT_LIST_DIR}
             -d3 ${base_dir_full_path}
@@ -117,6 +167,19 @@ function(spiffs_create_partition_assets partition base_dir)
             -d9 ${CONFIG_MMAP_SPLIT_HEIGHT}
             -d10 ${CONFIG_MMAP_FILE_NAME_LENGTH}
             -d11 ${MMAP_SUPPORT_QOI}
+            -d12 ${CONFIG_MMAP_QOI_SEEK_INTERVAL}
+            -d13 ${CONFIG_MMAP_QOI_EFFORT}
+            -d14 ${CONFIG_MMAP_SPLIT_HEADER_VERSION}
+            -d15 ${CONFIG_MMAP_SPLIT_RAM_BUDGET}
+            -d16 ${CONFIG_MMAP_RAW_MAX_PIXELS}
+            -d17 ${CONFIG_MMAP_RAW_MAX_RATIO}
+            -d18 ${MMAP_RAW_SWAP}
+            -d19 ${MMAP_SPLIT_DEDUP}
+            -d20 ${MMAP_ANIM_SEQUENCE}
+            -d21 ${MMAP_BUILD_REPORT}
+            -d22 ${CONFIG_MMAP_ASSET_ALIGN}
+            -d23 ${CONFIG_MMAP_SPLIT_ALIGN}
+            -d24 ${MMAP_ASSET_CRC}
             DEPENDS ${arg_DEPENDS}
             VERBATIM)
 
@@ -4,12 +4,16 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <inttypes.h>
+#include <sys/param.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "esp_err.h"
 #include "esp_log.h"
 #include "esp_check.h"
 #include "string.h"
+#include "spi_flash_mmap.h"
 
 #include "unity.h"
 #include "unity_test_runner.h"
@@ -120,6 +124,222 @@ TEST_CASE("test assets mmap table", "[mmap_assets][mmap_disable]")
     mmap_assets_del(asset_handle);
 }
 
+TEST_CASE("test assets find by name", "[mmap_assets][find]")
+{
+    mmap_assets_handle_t asset_handle;
+
+    const mmap_assets_config_t config = {
+        .partition_label = "assets",
+        .max_files = MMAP_SPIFFS_ASSETS_FILES,
+        .checksum = MMAP_SPIFFS_ASSETS_CHECKSUM,
+        .flags = {
+            .mmap_enable = true,
+        },
+    };
+
+    TEST_ESP_OK(mmap_assets_new(&config, &asset_handle));
+
+    for (int i = 0; i < MMAP_SPIFFS_ASSETS_FILES; i++) {
+        char name[CONFIG_MMAP_FILE_NAME_LENGTH + 1] = {0};
+        strncpy(name, mmap_assets_get_name(asset_handle, i), CONFIG_MMAP_FILE_NAME_LENGTH);
+        TEST_ASSERT_EQUAL(i, mmap_assets_find(asset_handle, name));
+    }
+    TEST_ASSERT_EQUAL(MMAP_SPIFFS_ASSETS_PNG_QOI, mmap_assets_find(asset_handle, "png.qoi"));
+    TEST_ASSERT_EQUAL(-1, mmap_assets_find(asset_handle, "png"));
+    TEST_ASSERT_EQUAL(-1, mmap_assets_find(asset_handle, "png.qoi2"));
+    TEST_ASSERT_EQUAL(-1, mmap_assets_find(asset_handle, ""));
+
+    mmap_assets_del(asset_handle);
+}
+
+TEST_CASE("test assets read cache", "[mmap_assets][read_cache]")
+{
+    mmap_assets_handle_t mmap_handle;
+    mmap_assets_handle_t read_handle;
+
+    mmap_assets_config_t config = {
+        .partition_label = "assets",
+        .max_files = MMAP_SPIFFS_ASSETS_FILES,
+        .checksum = MMAP_SPIFFS_ASSETS_CHECKSUM,
+        .flags = {
+            .mmap_enable = true,
+        },
+    };
+
+    TEST_ESP_OK(mmap_assets_new(&config, &mmap_handle));
+    config.flags.mmap_enable = false;
+    TEST_ESP_OK(mmap_assets_new(&config, &read_handle));
+
+    /* Read each asset in small pieces, as a decoder does */
+    uint8_t load_data[37];
+    for (int i = 0; i < MMAP_SPIFFS_ASSETS_FILES; i++) {
+        const uint8_t *mem = mmap_assets_get_mem(mmap_handle, i);
+        size_t offset = (size_t)mmap_assets_get_mem(read_handle, i);
+        int size = mmap_assets_get_size(read_handle, i);
+
+        for (int pos = 0; pos < size; pos += sizeof(load_data)) {
+            size_t len = MIN(sizeof(load_data), size - pos);
+            TEST_ASSERT_EQUAL(len, mmap_assets_copy_mem(read_handle, offset + pos, load_data, len));
+            TEST_ASSERT_EQUAL_MEMORY(mem + pos, load_data, len);
+        }
+    }
+    TEST_ASSERT_EQUAL(0, mmap_assets_copy_mem(read_handle, SIZE_MAX - 1, load_data, sizeof(load_data)));
+
+    mmap_assets_cache_stats_t stats;
+    TEST_ESP_OK(mmap_assets_get_cache_stats(read_handle, &stats));
+    ESP_LOGI(TAG, "hits %" PRIu32 ", misses %" PRIu32 ", flash reads %" PRIu32 ", %" PRIu64 " bytes",
+             stats.hits, stats.misses, stats.flash_reads, stats.flash_bytes);
+#if CONFIG_MMAP_READ_CACHE_BLOCKS
+    TEST_ASSERT_GREATER_THAN_UINT32(stats.misses, stats.hits);
+    TEST_ASSERT_GREATER_THAN_UINT32(0, stats.flash_reads);
+#endif
+
+    TEST_ESP_OK(mmap_assets_get_cache_stats(mmap_handle, &stats));
+    TEST_ASSERT_EQUAL_UINT32(0, stats.flash_reads);
+
+    mmap_assets_del(read_handle);
+    mmap_assets_del(mmap_handle);
+}
+
+TEST_CASE("test assets mmap window", "[mmap_assets][mmap_window]")
+{
+    mmap_assets_handle_t mmap_handle;
+    mmap_assets_handle_t window_handle;
+
+    mmap_assets_config_t config = {
+        .partition_label = "assets",
+        .max_files = MMAP_SPIFFS_ASSETS_FILES,
+        .checksum = MMAP_SPIFFS_ASSETS_CHECKSUM,
+        .flags = {
+            .mmap_enable = true,
+        },
+    };
+
+    TEST_ESP_OK(mmap_assets_new(&config, &mmap_handle));
+    config.mmap_window_pages = 2;
+    config.flags.mmap_window = true;
+    config.flags.metadata_check = true;
+    if (mmap_assets_find(mmap_handle, "split_pool.bin") >= 0) {
+        /* Splits shared by CONFIG_MMAP_SPLIT_DEDUP are outside the pages of the images using them */
+        TEST_ASSERT_EQUAL(ESP_ERR_NOT_SUPPORTED, mmap_assets_new(&config, &window_handle));
+        mmap_assets_del(mmap_handle);
+        return;
+    }
+    int free_pages = spi_flash_mmap_get_free_pages(SPI_FLASH_MMAP_DATA);
+    TEST_ESP_OK(mmap_assets_new(&config, &window_handle));
+    TEST_ASSERT_EQUAL(free_pages, spi_flash_mmap_get_free_pages(SPI_FLASH_MMAP_DATA));
+
+    for (int i = 0; i < MMAP_SPIFFS_ASSETS_FILES; i++) {
+        const uint8_t *mem = mmap_assets_get_mem(window_handle, i);
+        TEST_ASSERT_NOT_NULL(mem);
+        TEST_ASSERT_EQUAL_MEMORY(mmap_assets_get_mem(mmap_handle, i), mem, mmap_assets_get_size(window_handle, i));
+        TEST_ASSERT_GREATER_OR_EQUAL(free_pages - 2, spi_flash_mmap_get_free_pages(SPI_FLASH_MMAP_DATA));
+        TEST_ESP_OK(mmap_assets_release(window_handle, i));
+    }
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, mmap_assets_release(window_handle, 0));
+
+    mmap_assets_del(window_handle);
+    TEST_ASSERT_EQUAL(free_pages, spi_flash_mmap_get_free_pages(SPI_FLASH_MMAP_DATA));
+    mmap_assets_del(mmap_handle);
+}
+
+TEST_CASE("test assets verify", "[mmap_assets][verify]")
+{
+    mmap_assets_handle_t asset_handle;
+
+    mmap_assets_config_t config = {
+        .partition_label = "assets",
+        .max_files = MMAP_SPIFFS_ASSETS_FILES,
+        .checksum = MMAP_SPIFFS_ASSETS_CHECKSUM,
+        .flags = {
+            .mmap_enable = true,
+            .lazy_check = true,
+            .background_check = true,
+        },
+    };
+
+#if CONFIG_MMAP_ASSET_CRC
+    TEST_ESP_OK(mmap_assets_new(&config, &asset_handle));
+    TEST_ESP_OK(mmap_assets_wait_verified(asset_handle, 1000));
+    for (int i = 0; i < MMAP_SPIFFS_ASSETS_FILES; i++) {
+        TEST_ESP_OK(mmap_assets_verify(asset_handle, i));
+        TEST_ASSERT_NOT_NULL(mmap_assets_get_mem(asset_handle, i));
+    }
+    mmap_assets_del(asset_handle);
+    vTaskDelay(pdMS_TO_TICKS(10));  // Let the idle task free the verification task
+#else
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_SUPPORTED, mmap_assets_new(&config, &asset_handle));
+    config.flags.lazy_check = false;
+    config.flags.background_check = false;
+    TEST_ESP_OK(mmap_assets_new(&config, &asset_handle));
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_SUPPORTED, mmap_assets_verify(asset_handle, 0));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, mmap_assets_wait_verified(asset_handle, 0));
+    mmap_assets_del(asset_handle);
+#endif
+}
+
+static void test_prefetch_done(mmap_assets_handle_t handle, void *user_ctx)
+{
+    xSemaphoreGive((SemaphoreHandle_t)user_ctx);
+}
+
+TEST_CASE("test assets prefetch", "[mmap_assets][prefetch]")
+{
+    mmap_assets_handle_t asset_handle;
+    SemaphoreHandle_t done = xSemaphoreCreateBinary();
+    TEST_ASSERT_NOT_NULL(done);
+
+    mmap_assets_config_t config = {
+        .partition_label = "assets",
+        .max_files = MMAP_SPIFFS_ASSETS_FILES,
+        .checksum = MMAP_SPIFFS_ASSETS_CHECKSUM,
+        .flags = {
+            .mmap_enable = false,
+        },
+    };
+
+    TEST_ESP_OK(mmap_assets_new(&config, &asset_handle));
+    int index = MMAP_SPIFFS_ASSETS_FILES - 1;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, mmap_assets_prefetch(asset_handle, &index, 0, NULL, NULL));
+    TEST_ESP_OK(mmap_assets_prefetch(asset_handle, &index, 1, test_prefetch_done, done));
+    TEST_ASSERT_TRUE(xSemaphoreTake(done, pdMS_TO_TICKS(1000)));
+
+    mmap_assets_prefetch_stats_t stats;
+    TEST_ESP_OK(mmap_assets_get_prefetch_stats(asset_handle, &stats));
+    ESP_LOGI(TAG, "requests %" PRIu32 ", assets %" PRIu32 ", %" PRIu64 " bytes", stats.requests, stats.assets, stats.bytes);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.requests);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.assets);
+
+#if CONFIG_MMAP_READ_CACHE_BLOCKS
+    /* The start of the asset is read from the cache */
+    mmap_assets_cache_stats_t cache_stats;
+    TEST_ESP_OK(mmap_assets_get_cache_stats(asset_handle, &cache_stats));
+    uint32_t flash_reads = cache_stats.flash_reads;
+    uint8_t load_data[16];
+    size_t len = MIN(sizeof(load_data), mmap_assets_get_size(asset_handle, index));
+    TEST_ASSERT_EQUAL(len, mmap_assets_copy_mem(asset_handle, (size_t)mmap_assets_get_mem(asset_handle, index), load_data, len));
+    TEST_ESP_OK(mmap_assets_get_cache_stats(asset_handle, &cache_stats));
+    TEST_ASSERT_EQUAL_UINT32(flash_reads, cache_stats.flash_reads);
+#endif
+
+    /* Queued requests are done before the instance is deleted */
+    for (int i = 0; i < MMAP_SPIFFS_ASSETS_FILES; i++) {
+        mmap_assets_prefetch(asset_handle, &i, 1, NULL, NULL);
+    }
+    mmap_assets_del(asset_handle);
+
+    config.flags.mmap_enable = true;
+    TEST_ESP_OK(mmap_assets_new(&config, &asset_handle));
+    TEST_ESP_OK(mmap_assets_prefetch(asset_handle, &index, 1, test_prefetch_done, done));
+    TEST_ASSERT_TRUE(xSemaphoreTake(done, pdMS_TO_TICKS(1000)));
+    TEST_ESP_OK(mmap_assets_get_prefetch_stats(asset_handle, &stats));
+    TEST_ASSERT_EQUAL_UINT64(mmap_assets_get_size(asset_handle, index) + 2, stats.bytes);
+    mmap_assets_del(asset_handle);
+
+    vSemaphoreDelete(done);
+    vTaskDelay(pdMS_TO_TICKS(10));  // Let the idle task free the prefetch task
+}
+
 // Some resources are lazy allocated in the LCD driver, the threadhold is left for that case
 #define TEST_MEMORY_LEAK_THRESHOLD  (500)
 
@@ -5,6 +5,7 @@
  */
 
 #include <dirent.h>
+#include <inttypes.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <time.h>
@@ -15,6 +16,7 @@
 
 #include "esp_lv_spng.h"
 #include "esp_lv_qoi.h"
+#include "esp_lv_anim_player.h"
 #include "mmap_generate_spiffs_assets.h"
 
 static const char *TAG = "1_28_ui";
@@ -31,7 +33,9 @@ static void btn_press_right_cb(void *handle, void *arg);
 
 static void image_mmap_init();
 
-#define MAX_COUNTERS        3
+#define ANIM_FPS            30
+#define UI_POLL_MS          50
+#define STATS_INTERVAL_MS   1000
 
 typedef enum {
     THEME_SELECT_CHILD,
@@ -40,13 +44,6 @@ typedef enum {
     THEME_MAX_NUM,
 } theme_select_t;
 
-typedef struct {
-    int64_t start;
-    int64_t acc;
-    char str1[15];
-    char str2[15];
-} PerfCounter;
-
 static theme_select_t theme_select = THEME_SELECT_CHILD;
 static bool anmi_do_run = true;
 
@@ -54,32 +51,9 @@ static mmap_assets_handle_t asset_handle;
 static esp_lv_spng_decoder_handle_t spng_decoder;
 static esp_lv_qoi_decoder_handle_t qoi_decoder;
 
-static PerfCounter perf_counters[MAX_COUNTERS] = {0};
-
-static void perfmon_start(int ctr, const char* fmt1, const char* fmt2, ...)
-{
-    va_list args;
-    va_start(args, fmt2);
-    vsnprintf(perf_counters[ctr].str1, sizeof(perf_counters[ctr].str1), fmt1, args);
-    vsnprintf(perf_counters[ctr].str2, sizeof(perf_counters[ctr].str2), fmt2, args);
-    va_end(args);
-
-    perf_counters[ctr].start = esp_timer_get_time();
-}
-
-static void perfmon_end(int ctr, int count)
-{
-    int64_t time_diff = esp_timer_get_time() - perf_counters[ctr].start;
-    float time_in_sec = (float)time_diff / 1000000;
-    float frequency = count / time_in_sec;
-
-    printf("Perf ctr[%d], [%8s][%8s]: %.2f FPS (%.2f ms)\n",
-           ctr, perf_counters[ctr].str1, perf_counters[ctr].str2, frequency, time_in_sec * 1000 / count);
-}
-
 void ui_1_28_start()
 {
-    static lv_img_dsc_t img_dsc_motive;
+    esp_lv_anim_player_handle_t player = NULL;
 
     app_btn_register_callback(BSP_BUTTON_NUM + BSP_ADC_BUTTON_PREV, BUTTON_PRESS_UP, btn_press_left_cb, NULL);
     app_btn_register_callback(BSP_BUTTON_NUM + BSP_ADC_BUTTON_ENTER, BUTTON_PRESS_UP, btn_press_OK_cb, NULL);
@@ -89,6 +63,12 @@ void ui_1_28_start()
     esp_lv_split_png_init(&spng_decoder);
     esp_lv_qoi_init(&qoi_decoder);
 
+    /* Images packed with CONFIG_MMAP_SPLIT_DEDUP read the splits they share from the pool */
+    int split_pool = mmap_assets_find(asset_handle, "split_pool.bin");
+    if (split_pool >= 0) {
+        esp_lv_qoi_set_split_pool(mmap_assets_get_mem(asset_handle, split_pool), mmap_assets_get_size(asset_handle, split_pool));
+    }
+
     bsp_display_lock(0);
 
     ESP_LOGI(TAG, "screen size:[%d,%d]", LV_HOR_RES, LV_VER_RES);
@@ -111,10 +91,11 @@ void ui_1_28_start()
     bsp_display_unlock();
 
     theme_select_t theme_last = THEME_MAX_NUM;
-    uint8_t list = 100;
+    bool run_last = false;
+    uint32_t stats_elapsed = 0;
     uint8_t img_ossfet = 0;
-    int fps_count = 0;
 
+    /*Frames are stepped by the player's LVGL timer, this loop only follows the buttons*/
     while (1) {
         bsp_display_lock(0);
 
@@ -122,39 +103,53 @@ void ui_1_28_start()
             theme_last = theme_select;
             if (THEME_SELECT_CHILD == theme_select) {
                 lv_img_set_src(obj_img_bg, &yellow_bg);
-                img_ossfet = MMAP_SPIFFS_ASSETS_CHILD0001_SQOI;
+                img_ossfet = MMAP_SPIFFS_ASSETS_CHILD_AQOI;
             } else if (THEME_SELECT_CLEAN == theme_select) {
                 lv_img_set_src(obj_img_bg, &blue_bg);
-                img_ossfet = MMAP_SPIFFS_ASSETS_CLEAN0001_SQOI;
+                img_ossfet = MMAP_SPIFFS_ASSETS_CLEAN_AQOI;
             } else if (THEME_SELECT_QUICK == theme_select) {
                 lv_img_set_src(obj_img_bg, &red_bg);
-                img_ossfet = MMAP_SPIFFS_ASSETS_QUICK0001_SQOI;
+                img_ossfet = MMAP_SPIFFS_ASSETS_QUICK_AQOI;
+            }
+
+            if (!player) {
+                const esp_lv_anim_player_config_t config = {
+                    .img = obj_img_run_particles,
+                    .assets = asset_handle,
+                    .first = img_ossfet,
+                    .count = 1,
+                    .fps = ANIM_FPS,
+                    .loop = ESP_LV_ANIM_PLAYER_LOOP_RESTART,
+                };
+                ESP_ERROR_CHECK(esp_lv_anim_player_new(&config, &player));
+            } else {
+                ESP_ERROR_CHECK(esp_lv_anim_player_set_range(player, img_ossfet, 1));
             }
         }
-        if (true == anmi_do_run) {
-            list++;
-            lv_obj_clear_flag(obj_img_run_particles, LV_OBJ_FLAG_HIDDEN);
-            img_dsc_motive.data_size = mmap_assets_get_size(asset_handle, img_ossfet + (list) % 23);
-            img_dsc_motive.data = mmap_assets_get_mem(asset_handle, img_ossfet + (list) % 23);
-            lv_img_set_src(obj_img_run_particles, &img_dsc_motive);
-
-            if (fps_count % 10 == 0) {
-                perfmon_start(0, "PFS", "qoi");
-                // printf_stack();
-            } else if (fps_count % 10 == 9) {
-                perfmon_end(0, 10);
+        if (run_last ^ anmi_do_run) {
+            run_last = anmi_do_run;
+            if (true == run_last) {
+                lv_obj_clear_flag(obj_img_run_particles, LV_OBJ_FLAG_HIDDEN);
+                esp_lv_anim_player_start(player);
+            } else {
+                lv_obj_add_flag(obj_img_run_particles, LV_OBJ_FLAG_HIDDEN);
+                esp_lv_anim_player_stop(player);
             }
-            fps_count++;
-        } else {
-            list = 0;
-            lv_obj_add_flag(obj_img_run_particles, LV_OBJ_FLAG_HIDDEN);
+            stats_elapsed = 0;
+        }
+        if (true == run_last && (stats_elapsed += UI_POLL_MS) >= STATS_INTERVAL_MS) {
+            esp_lv_anim_player_stats_t stats;
+            esp_lv_anim_player_get_stats(player, &stats);
+            printf("Perf [anim][qoi]: %.2f FPS, dropped %"PRIu32"/%"PRIu32", decode %.2f ms (max %.2f ms)\n",
+                   stats.fps, stats.dropped, stats.frames + stats.dropped, stats.decode_avg_us / 1000.0f, stats.decode_max_us / 1000.0f);
+            stats_elapsed = 0;
         }
-        lv_refr_now(NULL);
         bsp_display_unlock();
 
-        vTaskDelay(pdMS_TO_TICKS(1));
+        vTaskDelay(pdMS_TO_TICKS(UI_POLL_MS));
     }
 
+    esp_lv_anim_player_del(player);
     mmap_assets_del(asset_handle);
     esp_lv_split_png_deinit(spng_decoder);
 }
@@ -0,0 +1,1406 @@
+/*
+
+SPDX-License-Identifier: MIT
+
+
+Command line tool to pack an esp_mmap_assets partition image
+
+A native replacement for spiffs_assets_gen.py in QOI mode. It takes the same
+-d1 .. -d24 arguments, see esp_mmap_assets/project_include.cmake, and writes
+the same partition image and mmap_generate_<assets>.h byte for byte:
+	- PNG files are cut into splits, QOI encoded with qoi_encode_ex() at the
+	  configured effort, optionally followed by a seek table, and stored in a
+	  V1 or V2 "_SQOI__" split image
+	- small PNG files may be stored as "_SRAW__" images of RGB565 pixels instead
+	- other files matching the format list are copied as they are
+	- all files are sorted, prefixed with 0x5A5A and listed in the mmap table;
+	  with split_dedup, repeated files and splits are stored once; a name
+	  index after the files lists them in the order of their names
+	- with asset_align and split_align, assets and the splits of V2 split
+	  images start at multiples of those in the partition
+	- with asset_crc, each mmap table entry ends with the CRC32 of the asset
+	- with build_report, a JSON and an HTML report list the size, splits and
+	  host decode time of each asset
+
+SJPG/SPNG conversion, JPEG input and .aqoi animations (anim_sequence) need
+the Pillow encoders and are left to spiffs_assets_gen.py. Image sizes in the mmap table are read with stb_image,
+which knows fewer formats than Pillow; unknown files get 0 x 0.
+
+Requires:
+	-"stb_image.h" (https://github.com/nothings/stb/blob/master/stb_image.h)
+	-"qoi.h" (https://github.com/phoboslab/qoi/blob/master/qoi.h)
+
+Compile with:
+	make pack
+
+*/
+
+
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_NO_LINEAR
+#include "stb_image.h"
+
+#define QOI_IMPLEMENTATION
+#include "qoi.h"
+
+#include <stdio.h>
+#include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <time.h>
+
+
+#define ERROR(...) printf("\033[1;31mError:\033[0m " __VA_ARGS__), puts(""), exit(1)
+#define WARN(...) printf("\033[1;33mWarn:\033[0m " __VA_ARGS__), puts("")
+
+// Split image V2 header, same values as split_image.h
+#define SPLIT_HEADER_SIZE 22
+#define SPLIT_HEADER_SIZE_V2 28
+#define SPLIT_HEADER_SIZE_V3 32
+#define SPLIT_FORMAT_QOI 3
+#define SPLIT_FORMAT_RAW 4
+#define SPLIT_PIXEL_RGBA8888 4
+#define SPLIT_PIXEL_RGB565 0x12
+#define SPLIT_PIXEL_RGB565A8 0x13
+#define SPLIT_PIXEL_RGB565_SWAP 0x22
+#define SPLIT_PIXEL_RGB565A8_SWAP 0x23
+
+// Same as choose_split_height() in spiffs_assets_gen.py
+static const int split_height_candidates[] = {1, 2, 4, 8, 12, 16, 24, 32, 48, 64, 96, 128, 192, 256};
+#define SPLIT_CACHE_BPP 4
+#define SPLIT_DECODE_COST 0.25
+
+// Asset holding the splits shared between images with dedup, see merge_files()
+// in spiffs_assets_gen.py
+#define SPLIT_POOL_NAME "split_pool.bin"
+#define SPLIT_POOL_MAGIC "_SPOOL_"
+
+// Build report, see write_report() in spiffs_assets_gen.py
+#define REPORT_TOP 5
+#define REPORT_DECODE_RUNS 3
+
+typedef struct {
+	const char *main_path;
+	const char *assets_path;
+	unsigned long size;
+	const char *image_file;
+	int support_spng;
+	int support_sjpg;
+	int support_qoi;
+	const char *support_format;
+	int split_height;
+	int max_name_len;
+	int qoi_seek_interval;
+	int qoi_effort;
+	int header_version;
+	int split_ram_budget;
+	int raw_max_pixels;
+	int raw_max_ratio;
+	int raw_swap;
+	int split_dedup;
+	int build_report;
+	int asset_align;
+	int split_align;
+	int asset_crc;
+} options_t;
+
+typedef struct {
+	char *name;
+	unsigned char *data;
+	int size;
+	int width;
+	int height;
+	int split_height;               // 0 if not a split image
+} asset_t;
+
+typedef struct {
+	unsigned char *data;
+	int len;
+	int cap;
+} buffer_t;
+
+
+// -----------------------------------------------------------------------------
+// Buffers and files
+
+static void buffer_append(buffer_t *b, const void *data, int len) {
+	if (b->len + len > b->cap) {
+		b->cap = (b->len + len) * 2;
+		b->data = realloc(b->data, b->cap);
+		if (!b->data) {
+			ERROR("out of memory");
+		}
+	}
+	memcpy(b->data + b->len, data, len);
+	b->len += len;
+}
+
+static void buffer_append_le(buffer_t *b, unsigned int v, int bytes) {
+	unsigned char le[4];
+	for (int i = 0; i < bytes; i++) {
+		le[i] = v >> (i * 8);
+	}
+	buffer_append(b, le, bytes);
+}
+
+static unsigned char *read_file(const char *path, int *size) {
+	FILE *f = fopen(path, "rb");
+	if (!f) {
+		ERROR("can't open %s", path);
+	}
+	fseek(f, 0, SEEK_END);
+	*size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	unsigned char *data = malloc(*size ? *size : 1);
+	if (!data || fread(data, 1, *size, f) != (size_t)*size) {
+		ERROR("can't read %s", path);
+	}
+	fclose(f);
+	return data;
+}
+
+static void make_dirs(const char *path) {
+	char *p = strdup(path);
+	for (char *s = p + 1; *s; s++) {
+		if (*s == '/') {
+			*s = '\0';
+			mkdir(p, 0777);
+			*s = '/';
+		}
+	}
+	if (mkdir(p, 0777) != 0 && errno != EEXIST) {
+		ERROR("can't create %s", path);
+	}
+	free(p);
+}
+
+static int ends_with(const char *s, const char *suffix) {
+	size_t ls = strlen(s), lx = strlen(suffix);
+	return ls >= lx && strcmp(s + ls - lx, suffix) == 0;
+}
+
+// The extension as os.path.splitext() sees it: from the last dot, unless the
+// name only starts with dots
+static const char *ext_of(const char *name) {
+	const char *dot = strrchr(name, '.');
+	const char *p = name;
+	while (*p == '.') {
+		p++;
+	}
+	return dot && dot >= p ? dot : name + strlen(name);
+}
+
+
+// -----------------------------------------------------------------------------
+// Split images, see process_image() in spiffs_assets_gen.py
+
+// Encode rows [y, y + h) of an RGBA image as one split
+static unsigned char *encode_split(const unsigned char *rgba, int width, int y, int h, const options_t *opt, int *len) {
+	qoi_desc desc = {
+		.width = width,
+		.height = h,
+		.channels = 4,
+		.colorspace = QOI_SRGB
+	};
+	unsigned char *encoded = qoi_encode_ex(rgba + (size_t)y * width * 4, &desc, len, opt->qoi_effort);
+	if (!encoded) {
+		ERROR("can't encode QOI split");
+	}
+	if (opt->qoi_seek_interval > 0) {
+		int table_len;
+		unsigned char *table = qoi_seek_build(encoded, *len, opt->qoi_seek_interval, &table_len);
+		if (!table) {
+			ERROR("can't build QOI seek table");
+		}
+		if (opt->header_version >= 2 || *len + table_len <= 0xffff) {
+			encoded = realloc(encoded, *len + table_len);
+			memcpy(encoded + *len, table, table_len);
+			*len += table_len;
+		}
+		else {
+			WARN("split with seek table exceeds 64K, seek table dropped.");
+		}
+		free(table);
+	}
+	return encoded;
+}
+
+static int split_header_size(int splits, int version) {
+	return version == 1
+		? SPLIT_HEADER_SIZE + splits * 2
+		: SPLIT_HEADER_SIZE_V2 + (splits + 1) * 4;
+}
+
+static int choose_split_height(const unsigned char *rgba, int width, int height, const options_t *opt) {
+	int max_height = opt->split_ram_budget / (width * SPLIT_CACHE_BPP);
+	int candidates[sizeof(split_height_candidates) / sizeof(int) + 1];
+	int count = 0;
+
+	if (max_height < 1) {
+		max_height = 1;
+	}
+	for (int i = 0; i < (int)(sizeof(split_height_candidates) / sizeof(int)); i++) {
+		int h = split_height_candidates[i];
+		if (h <= height && h <= max_height) {
+			candidates[count++] = h;
+		}
+	}
+	if (height <= max_height && candidates[count - 1] != height) {
+		candidates[count++] = height;
+	}
+	if (width * SPLIT_CACHE_BPP > opt->split_ram_budget) {
+		WARN("one row of %d pixels exceeds the split RAM budget of %d bytes.", width, opt->split_ram_budget);
+	}
+
+	int best = 0, best_size = 0;
+	double best_cost = 0;
+	for (int c = 0; c < count; c++) {
+		int split_height = candidates[c];
+		int splits = (height + split_height - 1) / split_height;
+		int size = split_header_size(splits, opt->header_version);
+		int too_large = 0;
+		for (int i = 0; i < splits; i++) {
+			int h = i < splits - 1 ? split_height : height - i * split_height;
+			int len;
+			free(encode_split(rgba, width, i * split_height, h, opt, &len));
+			size += len;
+			too_large |= len > 0xffff;
+		}
+		if (opt->header_version == 1 && too_large) {
+			continue;
+		}
+
+		int seek = opt->qoi_seek_interval ? opt->qoi_seek_interval : split_height;
+		double skipped_rows = (split_height < seek ? split_height : seek) / 2.0;
+		double cost = size + SPLIT_DECODE_COST * width * skipped_rows;
+		if (!best || cost < best_cost) {
+			best = split_height;
+			best_size = size;
+			best_cost = cost;
+		}
+	}
+
+	if (!best) {
+		return candidates[0];
+	}
+	printf("split height: %d\tsize: %d\n", best, best_size);
+	return best;
+}
+
+static void write_split_header(buffer_t *out, const char *magic, int version, int width, int height,
+	int splits, int split_height, int format, int pixel_format, int align, const int *lengths
+) {
+	buffer_append(out, magic, 7);
+	buffer_append(out, version == 1 ? "\0V1.00\0" : "\0V2.00\0", 7);
+	buffer_append_le(out, width, 2);
+	buffer_append_le(out, height, 2);
+	buffer_append_le(out, splits, 2);
+	buffer_append_le(out, split_height, 2);
+	if (version == 1) {
+		for (int i = 0; i < splits; i++) {
+			buffer_append_le(out, lengths[i], 2);
+		}
+		return;
+	}
+
+	buffer_append_le(out, format, 1);
+	buffer_append_le(out, pixel_format, 1);
+	buffer_append_le(out, align, 2);
+	buffer_append_le(out, 0, 2);
+	unsigned int offset = split_header_size(splits, 2);
+	for (int i = 0; i < splits; i++) {
+		offset = (offset + align - 1) / align * align;
+		buffer_append_le(out, offset, 4);
+		offset += lengths[i];
+	}
+	buffer_append_le(out, offset, 4);
+}
+
+// Append a split after the zero padding that makes it start at a multiple of align
+static void append_split(buffer_t *out, const unsigned char *split, int len, int align) {
+	static const unsigned char zeros[256];
+	for (int pad = (align - out->len % align) % align; pad > 0; pad -= sizeof(zeros)) {
+		buffer_append(out, zeros, pad < (int)sizeof(zeros) ? pad : (int)sizeof(zeros));
+	}
+	buffer_append(out, split, len);
+}
+
+// Convert RGBA pixels to the LVGL 16 bit color format, see encode_raw() in
+// spiffs_assets_gen.py. Truncated to RGB565 like the QOI_FMT_RGB565* formats,
+// with an alpha byte after each color if any pixel is transparent.
+static unsigned char *encode_raw(const unsigned char *rgba, int px_len, int swap, int *pixel_format, int *len) {
+	int alpha = 0;
+	for (int i = 0; i < px_len; i++) {
+		alpha |= rgba[i * 4 + 3] != 255;
+	}
+
+	int bpp = alpha ? 3 : 2;
+	unsigned char *pixels = malloc((size_t)px_len * bpp);
+	for (int i = 0; i < px_len; i++) {
+		const unsigned char *px = rgba + i * 4;
+		unsigned int color = (px[0] >> 3) << 11 | (px[1] >> 2) << 5 | px[2] >> 3;
+		pixels[i * bpp + 0] = swap ? color >> 8 : color;
+		pixels[i * bpp + 1] = swap ? color : color >> 8;
+		if (alpha) {
+			pixels[i * bpp + 2] = px[3];
+		}
+	}
+
+	*pixel_format = swap
+		? (alpha ? SPLIT_PIXEL_RGB565A8_SWAP : SPLIT_PIXEL_RGB565_SWAP)
+		: (alpha ? SPLIT_PIXEL_RGB565A8 : SPLIT_PIXEL_RGB565);
+	*len = px_len * bpp;
+	return pixels;
+}
+
+// Convert an image to QOI, or to a raw image if that is small enough.
+// Returns the extension of the result, ".sqoi" or ".sraw".
+static const char *convert_image_to_qoi(const char *input_file, const options_t *opt, asset_t *asset) {
+	int width, height, channels;
+	unsigned char *rgba = stbi_load(input_file, &width, &height, &channels, 4);
+	if (!rgba) {
+		ERROR("can't decode %s", input_file);
+	}
+	if (width > 0xffff || height > 0xffff) {
+		ERROR("%s is larger than 65535 pixels", input_file);
+	}
+
+	int split_height = opt->split_height;
+	if (split_height <= 0 && opt->split_ram_budget <= 0) {
+		ERROR("Height must be a positive integer");
+	}
+	if (opt->split_ram_budget > 0) {
+		split_height = choose_split_height(rgba, width, height, opt);
+	}
+	int splits = (height + split_height - 1) / split_height;
+	printf("RES: %d x %d\tblock_size: %d\text: %s\n", width, height, split_height, ext_of(input_file));
+
+	unsigned char **split_data = malloc(splits * sizeof(unsigned char *));
+	int *lengths = malloc(splits * sizeof(int));
+	for (int i = 0; i < splits; i++) {
+		int h = i < splits - 1 ? split_height : height - i * split_height;
+		split_data[i] = encode_split(rgba, width, i * split_height, h, opt, &lengths[i]);
+		if (opt->header_version == 1 && lengths[i] > 0xffff) {
+			ERROR("split %d of %s is %d bytes, V1 headers only hold 64K splits.", i, input_file, lengths[i]);
+		}
+	}
+
+	int align = opt->header_version == 1 ? 1 : opt->split_align;
+	buffer_t out = {0};
+	write_split_header(&out, "_SQOI__", opt->header_version, width, height, splits, split_height,
+		SPLIT_FORMAT_QOI, SPLIT_PIXEL_RGBA8888, align, lengths);
+	for (int i = 0; i < splits; i++) {
+		append_split(&out, split_data[i], lengths[i], align);
+		free(split_data[i]);
+	}
+
+	const char *ext = ".sqoi";
+	if (width * height <= opt->raw_max_pixels) {
+		buffer_t raw = {0};
+		int pixel_format, raw_len;
+		unsigned char *pixels = encode_raw(rgba, width * height, opt->raw_swap, &pixel_format, &raw_len);
+		write_split_header(&raw, "_SRAW__", 2, width, height, 1, height, SPLIT_FORMAT_RAW, pixel_format, opt->split_align, &raw_len);
+		append_split(&raw, pixels, raw_len, opt->split_align);
+		free(pixels);
+
+		if ((long long)raw.len * 100 <= (long long)opt->raw_max_ratio * out.len) {
+			printf("raw: %d bytes\tqoi: %d bytes\n", raw.len, out.len);
+			free(out.data);
+			out = raw;
+			split_height = height;
+			ext = ".sraw";
+		}
+		else {
+			free(raw.data);
+		}
+	}
+
+	asset->data = out.data;
+	asset->size = out.len;
+	asset->width = width;
+	asset->height = height;
+	asset->split_height = split_height;
+
+	free(lengths);
+	free(split_data);
+	stbi_image_free(rgba);
+	return ext;
+}
+
+
+// -----------------------------------------------------------------------------
+// Assets and the partition image, see copy_assets_to_build() and pack_models()
+
+// Image size of a copied file, as pack_models() finds it
+static void asset_info(asset_t *asset) {
+	const char *ext = ext_of(asset->name);
+	int channels;
+
+	if (stbi_info_from_memory(asset->data, asset->size, &asset->width, &asset->height, &channels)) {
+		return;
+	}
+	if (asset->size >= 14 && memcmp(asset->data, "qoif", 4) == 0) {
+		asset->width = asset->data[4] << 24 | asset->data[5] << 16 | asset->data[6] << 8 | asset->data[7];
+		asset->height = asset->data[8] << 24 | asset->data[9] << 16 | asset->data[10] << 8 | asset->data[11];
+		return;
+	}
+	if (strcasecmp(ext, ".sjpg") == 0 || strcasecmp(ext, ".spng") == 0 || strcasecmp(ext, ".sqoi") == 0 ||
+		strcasecmp(ext, ".sraw") == 0) {
+		unsigned char header[8] = {0};
+		memcpy(header, asset->data + 14, asset->size >= 22 ? 8 : (asset->size > 14 ? asset->size - 14 : 0));
+		asset->width = header[0] | header[1] << 8;
+		asset->height = header[2] | header[3] << 8;
+		asset->split_height = header[6] | header[7] << 8;
+		return;
+	}
+	asset->width = asset->height = 0;
+}
+
+static int format_matches(const char *filename, const char *support_format) {
+	const char *s = support_format;
+	for (;;) {
+		const char *comma = strchr(s, ',');
+		size_t len = comma ? (size_t)(comma - s) : strlen(s);
+		size_t name_len = strlen(filename);
+		if (name_len >= len && memcmp(filename + name_len - len, s, len) == 0) {
+			return 1;
+		}
+		if (!comma) {
+			return 0;
+		}
+		s = comma + 1;
+	}
+}
+
+static int load_assets(const options_t *opt, asset_t **out_assets) {
+	DIR *dir = opendir(opt->assets_path);
+	if (!dir) {
+		ERROR("can't open %s", opt->assets_path);
+	}
+
+	asset_t *assets = NULL;
+	int count = 0;
+	struct dirent *file;
+	while ((file = readdir(dir))) {
+		char path[4096];
+		struct stat st;
+		snprintf(path, sizeof(path), "%s/%s", opt->assets_path, file->d_name);
+		if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) {
+			continue;
+		}
+		if (!format_matches(file->d_name, opt->support_format)) {
+			printf("No match found for file: %s, format_tuple: %s\n", file->d_name, opt->support_format);
+			continue;
+		}
+
+		int is_png = ends_with(file->d_name, ".png");
+		int is_jpg = ends_with(file->d_name, ".jpg");
+		if ((is_jpg && opt->support_sjpg) || (is_png && opt->support_spng) || (is_jpg && opt->support_qoi)) {
+			ERROR("%s: SJPG, SPNG and JPEG to QOI conversion need spiffs_assets_gen.py", file->d_name);
+		}
+
+		assets = realloc(assets, (count + 1) * sizeof(asset_t));
+		asset_t *asset = &assets[count++];
+		memset(asset, 0, sizeof(asset_t));
+		if (is_png && opt->support_qoi) {
+			const char *ext = ext_of(file->d_name);
+			const char *out_ext = convert_image_to_qoi(path, opt, asset);
+			asset->name = malloc(ext - file->d_name + strlen(out_ext) + 1);
+			sprintf(asset->name, "%.*s%s", (int)(ext - file->d_name), file->d_name, out_ext);
+			printf("Completed, saved as: %s \n\n", asset->name);
+		}
+		else {
+			asset->name = strdup(file->d_name);
+			asset->data = read_file(path, &asset->size);
+			asset_info(asset);
+		}
+	}
+	closedir(dir);
+
+	*out_assets = assets;
+	return count;
+}
+
+static int memcmp_len(const char *a, size_t la, const char *b, size_t lb) {
+	int c = memcmp(a, b, la < lb ? la : lb);
+	return c ? c : (la > lb) - (la < lb);
+}
+
+// Compare names as text, with runs of digits compared by value
+static int natural_cmp(const char *a, size_t la, const char *b, size_t lb) {
+	size_t i = 0, j = 0;
+	for (;;) {
+		size_t si = i, sj = j;
+		while (i < la && !isdigit((unsigned char)a[i])) {
+			i++;
+		}
+		while (j < lb && !isdigit((unsigned char)b[j])) {
+			j++;
+		}
+		int c = memcmp_len(a + si, i - si, b + sj, j - sj);
+		if (c || i == la || j == lb) {
+			return c ? c : (i < la) - (j < lb);
+		}
+
+		si = i, sj = j;
+		while (i < la && isdigit((unsigned char)a[i])) {
+			i++;
+		}
+		while (j < lb && isdigit((unsigned char)b[j])) {
+			j++;
+		}
+		while (si < i && a[si] == '0') {
+			si++;
+		}
+		while (sj < j && b[sj] == '0') {
+			sj++;
+		}
+		c = (i - si > j - sj) - (i - si < j - sj);
+		c = c ? c : memcmp(a + si, b + sj, i - si);
+		if (c) {
+			return c;
+		}
+	}
+}
+
+// Same order as sort_key() in spiffs_assets_gen.py: extension, with .sraw
+// as .sqoi, then name with numbers by value
+static int asset_cmp(const void *a, const void *b) {
+	const char *na = ((const asset_t *)a)->name, *nb = ((const asset_t *)b)->name;
+	const char *ea = ext_of(na), *eb = ext_of(nb);
+	int c = strcmp(strcmp(ea, ".sraw") ? ea : ".sqoi", strcmp(eb, ".sraw") ? eb : ".sqoi");
+	c = c ? c : natural_cmp(na, ea - na, nb, eb - nb);
+	c = c ? c : strcmp(ea, eb);
+	return c ? c : memcmp_len(na, ea - na, nb, eb - nb);
+}
+
+static void write_header_file(const options_t *opt, const char *asset_name, const asset_t *assets, int count, unsigned int checksum) {
+	char upper[256], path[4096];
+	snprintf(upper, sizeof(upper), "%s", asset_name);
+	for (char *p = upper; *p; p++) {
+		*p = toupper((unsigned char)*p);
+	}
+
+	make_dirs(opt->main_path);
+	snprintf(path, sizeof(path), "%s/mmap_generate_%s.h", opt->main_path, asset_name);
+	FILE *f = fopen(path, "w");
+	if (!f) {
+		ERROR("can't write %s", path);
+	}
+
+	time_t now = time(NULL);
+	fprintf(f, "/*\n");
+	fprintf(f, " * SPDX-FileCopyrightText: 2022-%d Espressif Systems (Shanghai) CO LTD\n", localtime(&now)->tm_year + 1900);
+	fprintf(f, " *\n");
+	fprintf(f, " * SPDX-License-Identifier: Apache-2.0\n");
+	fprintf(f, " */\n\n");
+	fprintf(f, "/**\n");
+	fprintf(f, " * @file\n");
+	fprintf(f, " * @brief This file was generated by esp_mmap_assets, don't modify it\n");
+	fprintf(f, " */\n\n");
+	fprintf(f, "#pragma once\n\n");
+	fprintf(f, "#include \"esp_mmap_assets.h\"\n\n");
+	fprintf(f, "#define MMAP_%s_FILES           %d\n", upper, count);
+	fprintf(f, "#define MMAP_%s_CHECKSUM        0x%04X\n\n", upper, checksum);
+	fprintf(f, "enum MMAP_%s_LISTS {\n", upper);
+
+	int splits = 0;
+	for (int i = 0; i < count; i++) {
+		fprintf(f, "    MMAP_%s_", upper);
+		for (const char *p = assets[i].name; *p; p++) {
+			fputc(*p == '.' ? '_' : toupper((unsigned char)*p), f);
+		}
+		fprintf(f, " = %d,        /*!< %s */\n", i, assets[i].name);
+		splits |= assets[i].split_height != 0;
+	}
+	fprintf(f, "};\n");
+
+	if (splits) {
+		fprintf(f, "\n/* Split height of each split image */\n");
+		for (int i = 0; i < count; i++) {
+			if (!assets[i].split_height) {
+				continue;
+			}
+			fprintf(f, "#define MMAP_%s_", upper);
+			for (const char *p = assets[i].name; *p; p++) {
+				fputc(*p == '.' ? '_' : toupper((unsigned char)*p), f);
+			}
+			fprintf(f, "_SPLIT_HEIGHT    %d\n", assets[i].split_height);
+		}
+	}
+	fclose(f);
+}
+
+// A split of a V2 split image, for merge_assets()
+typedef struct {
+	const unsigned char *data;
+	int len;
+	unsigned int hash;
+	int owners;                     // number of assets using the split
+	int uses;                       // number of table entries using the split
+	int last_asset;
+	int offset;                     // offset in the merged data, -1 if not stored yet
+} tile_t;
+
+static tile_t *tile_find(tile_t *tiles, int cap, const unsigned char *data, int len) {
+	unsigned int hash = 2166136261u;
+	for (int i = 0; i < len; i++) {
+		hash = (hash ^ data[i]) * 16777619u;
+	}
+	for (unsigned int i = hash & (cap - 1);; i = (i + 1) & (cap - 1)) {
+		tile_t *tile = &tiles[i];
+		if (!tile->data) {
+			*tile = (tile_t){.data = data, .len = len, .hash = hash, .last_asset = -1, .offset = -1};
+			return tile;
+		}
+		if (tile->hash == hash && tile->len == len && memcmp(tile->data, data, len) == 0) {
+			return tile;
+		}
+	}
+}
+
+// The splits of a V2 split image with 1 byte alignment, see split_tiles() in
+// spiffs_assets_gen.py. Returns the number of splits, 0 for any other asset.
+static int split_tiles(const asset_t *asset, const unsigned char **tiles, int *lengths) {
+	static const char *magics[] = {"_SJPG__", "_SPNG__", "_SQOI__", "_SRAW__"};
+	const unsigned char *data = asset->data;
+	int magic = 0;
+
+	if (asset->size < SPLIT_HEADER_SIZE_V2 || memcmp(data + 7, "\0V2.00\0", 7) != 0) {
+		return 0;
+	}
+	for (int i = 0; i < 4; i++) {
+		magic |= memcmp(data, magics[i], 7) == 0;
+	}
+	if (!magic || (data[24] | data[25] << 8) != 1) {
+		return 0;
+	}
+
+	int splits = data[18] | data[19] << 8;
+	for (int i = 0; i < splits && tiles; i++) {
+		const unsigned char *entry = data + SPLIT_HEADER_SIZE_V2 + i * 4;
+		unsigned int start = entry[0] | entry[1] << 8 | entry[2] << 16 | (unsigned int)entry[3] << 24;
+		unsigned int end = entry[4] | entry[5] << 8 | entry[6] << 16 | (unsigned int)entry[7] << 24;
+		tiles[i] = data + start;
+		lengths[i] = end - start;
+	}
+	return splits;
+}
+
+// Zero padding so that the asset after the 0x5A5A prefix starts at a multiple
+// of align bytes in the partition, the merged data starting at base
+static void merge_pad(buffer_t *merged, int base, int align) {
+	static const unsigned char zeros[256];
+	for (int pad = (align - (base + merged->len + 2) % align) % align; pad > 0; pad -= sizeof(zeros)) {
+		buffer_append(merged, zeros, pad < (int)sizeof(zeros) ? pad : (int)sizeof(zeros));
+	}
+}
+
+// Concatenate the assets, each after a 0x5A5A prefix, and set the offset and
+// size of each in the mmap table. See merge_files() in spiffs_assets_gen.py for
+// the layout with dedup. Returns 1 if the splits shared between images were put
+// in a split pool, whose offset and size are set after the assets' and whose
+// table entry of entry_size bytes moves the merged data.
+static int merge_assets(const options_t *opt, const asset_t *assets, int count, int base, int entry_size, buffer_t *merged, int *offsets, int *sizes) {
+	// Splits are only aligned in flash if the image holding them is
+	int align = opt->asset_align > opt->split_align ? opt->asset_align : opt->split_align;
+
+	if (!opt->split_dedup) {
+		for (int i = 0; i < count; i++) {
+			merge_pad(merged, base, align);
+			offsets[i] = merged->len;
+			sizes[i] = assets[i].size;
+			buffer_append(merged, "\x5a\x5a", 2);
+			buffer_append(merged, assets[i].data, assets[i].size);
+		}
+		return 0;
+	}
+
+	// The size without dedup for the report, which counts the pool's table and name index entries
+	int verbatim = 0;
+	for (int i = 0; i < count; i++) {
+		verbatim += (align - (base + verbatim + 2) % align) % align + 2 + assets[i].size;
+	}
+
+	int *first = malloc(count * sizeof(int));
+	int *splits = calloc(count, sizeof(int));
+	int total_splits = 0, unique_assets = 0;
+	for (int i = 0; i < count; i++) {
+		first[i] = i;
+		for (int j = 0; j < i; j++) {
+			if (first[j] == j && assets[j].size == assets[i].size && memcmp(assets[j].data, assets[i].data, assets[i].size) == 0) {
+				first[i] = j;
+				break;
+			}
+		}
+		if (first[i] == i) {
+			unique_assets++;
+			splits[i] = split_tiles(&assets[i], NULL, NULL);
+			total_splits += splits[i];
+		}
+	}
+
+	int cap = 16;
+	while (cap < total_splits * 2) {
+		cap *= 2;
+	}
+	tile_t *tiles = calloc(cap, sizeof(tile_t));
+	tile_t ***asset_tiles = calloc(count, sizeof(tile_t **));
+	for (int i = 0; i < count; i++) {
+		if (!splits[i]) {
+			continue;
+		}
+		const unsigned char **data = malloc(splits[i] * sizeof(unsigned char *));
+		int *lengths = malloc(splits[i] * sizeof(int));
+		split_tiles(&assets[i], data, lengths);
+		asset_tiles[i] = malloc(splits[i] * sizeof(tile_t *));
+		for (int t = 0; t < splits[i]; t++) {
+			tile_t *tile = tile_find(tiles, cap, data[t], lengths[t]);
+			tile->owners += tile->last_asset != i;
+			tile->last_asset = i;
+			tile->uses++;
+			asset_tiles[i][t] = tile;
+		}
+		free(data);
+		free(lengths);
+	}
+	for (int t = 0; t < cap; t++) {
+		if (tiles[t].owners > 1) {
+			base += entry_size;
+			break;
+		}
+	}
+
+	// Assets whose splits repeat get a V3 header once the shared splits are placed
+	int *rewritten = calloc(count, sizeof(int));
+	tile_t **pool = malloc((total_splits + 1) * sizeof(tile_t *));
+	int pool_len = 0, stored_splits = 0, rewritten_splits = 0;
+	for (int i = 0; i < count; i++) {
+		if (first[i] != i) {
+			continue;
+		}
+		merge_pad(merged, base, align);
+		offsets[i] = merged->len;
+		sizes[i] = assets[i].size;
+		buffer_append(merged, "\x5a\x5a", 2);
+
+		for (int t = 0; t < splits[i]; t++) {
+			rewritten[i] |= asset_tiles[i][t]->uses > 1;
+		}
+		if (!rewritten[i]) {
+			buffer_append(merged, assets[i].data, assets[i].size);
+			continue;
+		}
+
+		int base = merged->len;
+		int header_len = SPLIT_HEADER_SIZE_V3 + splits[i] * 8;
+		unsigned char *header = calloc(1, header_len);
+		buffer_append(merged, header, header_len);
+		free(header);
+		for (int t = 0; t < splits[i]; t++) {
+			tile_t *tile = asset_tiles[i][t];
+			if (tile->offset != -1) {
+				continue;
+			}
+			if (tile->owners > 1) {
+				tile->offset = -2;
+				pool[pool_len++] = tile;
+			}
+			else {
+				tile->offset = merged->len;
+				buffer_append(merged, tile->data, tile->len);
+				stored_splits++;
+			}
+		}
+		sizes[i] = merged->len - base;
+		rewritten_splits += splits[i];
+	}
+
+	if (pool_len) {
+		merge_pad(merged, base, align);
+		offsets[count] = merged->len;
+		buffer_append(merged, "\x5a\x5a", 2);
+		buffer_append(merged, SPLIT_POOL_MAGIC, 7);
+		for (int p = 0; p < pool_len; p++) {
+			pool[p]->offset = merged->len;
+			buffer_append(merged, pool[p]->data, pool[p]->len);
+		}
+		sizes[count] = merged->len - offsets[count] - 2;
+	}
+	stored_splits += pool_len;
+
+	for (int i = 0; i < count; i++) {
+		if (!rewritten[i]) {
+			continue;
+		}
+		int base = offsets[i] + 2;
+		unsigned char *header = merged->data + base;
+		memcpy(header, assets[i].data, SPLIT_HEADER_SIZE_V2);
+		memcpy(header + 7, "\0V3.00\0", 7);
+		// The reach covers the pool if the image uses it
+		unsigned int reach = sizes[i];
+		for (int t = 0; t < splits[i]; t++) {
+			tile_t *tile = asset_tiles[i][t];
+			unsigned int offset = tile->offset - base;
+			for (int b = 0; b < 4; b++) {
+				header[SPLIT_HEADER_SIZE_V3 + t * 8 + b] = offset >> (b * 8);
+				header[SPLIT_HEADER_SIZE_V3 + t * 8 + 4 + b] = (unsigned int)tile->len >> (b * 8);
+			}
+			if (tile->owners > 1) {
+				reach = merged->len - base;
+			}
+		}
+		for (int b = 0; b < 4; b++) {
+			header[SPLIT_HEADER_SIZE_V2 + b] = reach >> (b * 8);
+		}
+	}
+
+	for (int i = 0; i < count; i++) {
+		offsets[i] = offsets[first[i]];
+		sizes[i] = sizes[first[i]];
+	}
+	int saved = verbatim - merged->len - (pool_len ? entry_size + 2 : 0);
+	printf("Dedup: %d duplicate files, %d duplicate splits, %d bytes saved (%.1f%%)\n",
+		count - unique_assets, rewritten_splits - stored_splits, saved, saved * 100.0 / (verbatim > 1 ? verbatim : 1));
+
+	for (int i = 0; i < count; i++) {
+		free(asset_tiles[i]);
+	}
+	free(asset_tiles);
+	free(tiles);
+	free(pool);
+	free(rewritten);
+	free(splits);
+	free(first);
+	return pool_len > 0;
+}
+
+// Stored names of the mmap table, for name_index_cmp()
+static const unsigned char *name_index_table;
+static int name_index_stride;
+static int name_index_name_len;
+
+static int name_index_cmp(const void *a, const void *b) {
+	int ia = *(const int *)a, ib = *(const int *)b;
+	int c = memcmp(name_index_table + ia * name_index_stride, name_index_table + ib * name_index_stride, name_index_name_len);
+	return c ? c : (ia > ib) - (ia < ib);
+}
+
+// Append the name index for mmap_assets_find(), see name_index() in
+// spiffs_assets_gen.py: the table indexes in the order of the stored names,
+// the number of files and "NIDX"
+static void append_name_index(buffer_t *out, const buffer_t *table, int count, int max_name_len, int entry_size) {
+	if (count > 0xffff) {
+		return;
+	}
+	int *order = malloc((count + 1) * sizeof(int));
+	for (int i = 0; i < count; i++) {
+		order[i] = i;
+	}
+	name_index_table = table->data;
+	name_index_stride = entry_size;
+	name_index_name_len = max_name_len;
+	qsort(order, count, sizeof(int), name_index_cmp);
+	for (int i = 0; i < count; i++) {
+		buffer_append_le(out, order[i], 2);
+	}
+	buffer_append_le(out, count, 4);
+	buffer_append(out, "NIDX", 4);
+	free(order);
+}
+
+// CRC32 of an asset for the mmap table, the same as zlib.crc32()
+static unsigned int crc32_le(const unsigned char *data, int len) {
+	static unsigned int table[256];
+	if (!table[1]) {
+		for (unsigned int i = 0; i < 256; i++) {
+			unsigned int c = i;
+			for (int k = 0; k < 8; k++) {
+				c = c & 1 ? 0xedb88320 ^ (c >> 1) : c >> 1;
+			}
+			table[i] = c;
+		}
+	}
+	unsigned int crc = 0xffffffff;
+	for (int i = 0; i < len; i++) {
+		crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+	}
+	return ~crc;
+}
+
+// Pack the assets into the partition image and write the mmap_generate_*.h
+// header. With dedup, the split pool is added to the assets, see merge_assets().
+// Returns the number of assets.
+static int pack_models(const options_t *opt, asset_t **assets_ptr, int count) {
+	buffer_t table = {0}, merged = {0};
+	int *offsets = malloc((count + 1) * sizeof(int));
+	int *sizes = malloc((count + 1) * sizeof(int));
+	int entry_size = opt->max_name_len + (opt->asset_crc ? 16 : 12);
+
+	qsort(*assets_ptr, count, sizeof(asset_t), asset_cmp);
+	if (merge_assets(opt, *assets_ptr, count, 12 + count * entry_size, entry_size, &merged, offsets, sizes)) {
+		*assets_ptr = realloc(*assets_ptr, (count + 1) * sizeof(asset_t));
+		asset_t *pool = &(*assets_ptr)[count++];
+		*pool = (asset_t){.name = strdup(SPLIT_POOL_NAME), .size = sizes[count - 1]};
+		pool->data = malloc(pool->size);
+		memcpy(pool->data, merged.data + offsets[count - 1] + 2, pool->size);
+	}
+	asset_t *assets = *assets_ptr;
+	for (int i = 0; i < count; i++) {
+		int name_len = strlen(assets[i].name);
+		if (name_len > opt->max_name_len) {
+			WARN("\"%s\" exceeds %d bytes and will be truncated.", assets[i].name, opt->max_name_len);
+		}
+		unsigned char *name = calloc(1, opt->max_name_len);
+		memcpy(name, assets[i].name, name_len < opt->max_name_len ? name_len : opt->max_name_len);
+		buffer_append(&table, name, opt->max_name_len);
+		free(name);
+		buffer_append_le(&table, sizes[i], 4);
+		buffer_append_le(&table, offsets[i], 4);
+		buffer_append_le(&table, assets[i].width, 2);
+		buffer_append_le(&table, assets[i].height, 2);
+		if (opt->asset_crc) {
+			buffer_append_le(&table, crc32_le(merged.data + offsets[i] + 2, sizes[i]), 4);
+		}
+	}
+	free(offsets);
+	free(sizes);
+	append_name_index(&merged, &table, count, opt->max_name_len, entry_size);
+
+	unsigned int checksum = 0;
+	for (int i = 0; i < table.len; i++) {
+		checksum += table.data[i];
+	}
+	for (int i = 0; i < merged.len; i++) {
+		checksum += merged.data[i];
+	}
+	checksum &= 0xffff;
+
+	char *dir = strdup(opt->image_file);
+	char *slash = strrchr(dir, '/');
+	if (slash && slash != dir) {
+		*slash = '\0';
+		make_dirs(dir);
+	}
+	free(dir);
+
+	FILE *f = fopen(opt->image_file, "wb");
+	if (!f) {
+		ERROR("can't write %s", opt->image_file);
+	}
+	unsigned char header[12];
+	unsigned int fields[3] = {count, checksum, table.len + merged.len};
+	for (int i = 0; i < 12; i++) {
+		header[i] = fields[i / 4] >> (i % 4 * 8);
+	}
+	fwrite(header, 1, sizeof(header), f);
+	fwrite(table.data, 1, table.len, f);
+	fwrite(merged.data, 1, merged.len, f);
+	fclose(f);
+
+	const char *asset_name = strrchr(opt->assets_path, '/');
+	asset_name = asset_name ? asset_name + 1 : opt->assets_path;
+	write_header_file(opt, asset_name, assets, count, checksum);
+	printf("All bin files have been merged into %s\n", opt->image_file);
+
+	unsigned long total_size = sizeof(header) + table.len + merged.len;
+	if (opt->size <= total_size) {
+		printf("Given assets partition size: %luK\n", (opt->size + 1023) / 1024);
+		printf("Recommended assets partition size: %luK\n", (total_size + 1023) / 1024);
+		ERROR("assets partition size is smaller than recommended.");
+	}
+
+	free(table.data);
+	free(merged.data);
+	return count;
+}
+
+
+// -----------------------------------------------------------------------------
+// Build report, see write_report() in spiffs_assets_gen.py
+
+typedef struct {
+	const asset_t *asset;
+	const char *format;
+	int tiles;
+	long long rgb565_bytes;
+	double ratio;                   // < 0 if unknown
+	long long decode_us;            // < 0 if not an image
+	int offender[3];                // size, decode, ratio
+} report_t;
+
+static const char *report_categories[] = {"size", "decode", "ratio"};
+
+static double now_us(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+// Decode an asset once like the esp_lv_* decoders do, raw splits are drawn in place
+static void decode_asset(const asset_t *asset, const int *offsets, const int *lengths, int splits) {
+	int is_qoi = splits && memcmp(asset->data, "_SQOI__", 7) == 0;
+	for (int i = 0; i < (splits ? splits : 1); i++) {
+		const unsigned char *data = splits ? asset->data + offsets[i] : asset->data;
+		int len = splits ? lengths[i] : asset->size;
+		void *pixels;
+		if (is_qoi || (!splits && len >= 4 && memcmp(data, "qoif", 4) == 0)) {
+			qoi_desc desc;
+			pixels = qoi_decode(data, len, &desc, 4);
+		}
+		else {
+			int width, height, channels;
+			pixels = stbi_load_from_memory(data, len, &width, &height, &channels, 4);
+		}
+		free(pixels);
+	}
+}
+
+// Time an asset's decode and find its splits, like asset_report()
+static void report_asset(const asset_t *asset, report_t *r) {
+	const unsigned char *d = asset->data;
+	const char *ext = ext_of(asset->name);
+	r->asset = asset;
+	r->format = *ext ? ext + 1 : ext;
+	r->rgb565_bytes = (long long)asset->width * asset->height * 2;
+	r->ratio = r->rgb565_bytes ? (double)asset->size / r->rgb565_bytes : -1;
+	r->decode_us = -1;
+
+	int splits = 0, *offsets = NULL, *lengths = NULL;
+	if (asset->split_height && asset->size >= SPLIT_HEADER_SIZE) {
+		splits = d[18] | d[19] << 8;
+		offsets = malloc((splits + 1) * sizeof(int));
+		lengths = malloc((splits + 1) * sizeof(int));
+		for (int i = 0, offset = SPLIT_HEADER_SIZE + splits * 2; i < splits; i++) {
+			if (memcmp(d + 7, "\0V1.00\0", 7) == 0) {
+				lengths[i] = d[SPLIT_HEADER_SIZE + i * 2] | d[SPLIT_HEADER_SIZE + i * 2 + 1] << 8;
+				offsets[i] = offset;
+				offset += lengths[i];
+			}
+			else {
+				const unsigned char *t = d + SPLIT_HEADER_SIZE_V2 + i * 4;
+				offsets[i] = t[0] | t[1] << 8 | t[2] << 16 | t[3] << 24;
+				lengths[i] = (t[4] | t[5] << 8 | t[6] << 16 | t[7] << 24) - offsets[i];
+			}
+		}
+		r->tiles = splits;
+		if (memcmp(d, "_SRAW__", 7) == 0) {
+			r->decode_us = 0;
+		}
+	}
+	else if (asset->width && asset->height) {
+		r->tiles = 1;
+	}
+
+	if (r->tiles && r->decode_us < 0) {
+		double best = -1;
+		for (int run = 0; run < REPORT_DECODE_RUNS; run++) {
+			double start = now_us();
+			decode_asset(asset, offsets, lengths, splits);
+			double elapsed = now_us() - start;
+			best = best < 0 || elapsed < best ? elapsed : best;
+		}
+		r->decode_us = (long long)(best + 0.5);
+	}
+	free(offsets);
+	free(lengths);
+}
+
+static int report_by_size(const void *a, const void *b) {
+	const report_t *ra = *(report_t * const *)a, *rb = *(report_t * const *)b;
+	return (rb->asset->size > ra->asset->size) - (rb->asset->size < ra->asset->size);
+}
+
+static int report_by_decode(const void *a, const void *b) {
+	const report_t *ra = *(report_t * const *)a, *rb = *(report_t * const *)b;
+	return (rb->decode_us > ra->decode_us) - (rb->decode_us < ra->decode_us);
+}
+
+// Order the reports for category c: by size, by decode time or as packed
+static void report_sort(report_t **sorted, report_t *reports, int count, int c) {
+	for (int i = 0; i < count; i++) {
+		sorted[i] = &reports[i];
+	}
+	if (c < 2) {
+		qsort(sorted, count, sizeof(report_t *), c == 0 ? report_by_size : report_by_decode);
+	}
+}
+
+// A JSON string, asset names are file names
+static void write_json_string(FILE *f, const char *s) {
+	fputc('"', f);
+	for (; *s; s++) {
+		if (*s == '"' || *s == '\\') {
+			fprintf(f, "\\%c", *s);
+		}
+		else if ((unsigned char)*s < 0x20) {
+			fprintf(f, "\\u%04x", *s);
+		}
+		else {
+			fputc(*s, f);
+		}
+	}
+	fputc('"', f);
+}
+
+static void write_html_string(FILE *f, const char *s) {
+	for (; *s; s++) {
+		switch (*s) {
+		case '&': fputs("&amp;", f); break;
+		case '<': fputs("&lt;", f); break;
+		case '>': fputs("&gt;", f); break;
+		case '"': fputs("&quot;", f); break;
+		default: fputc(*s, f);
+		}
+	}
+}
+
+// Write <assets>_report.json and .html next to the folder of the partition image,
+// with the largest and slowest REPORT_TOP assets and those larger than RGB565 flagged
+static void write_report(const options_t *opt, const asset_t *assets, int count) {
+	report_t *reports = calloc(count + 1, sizeof(report_t));
+	report_t **sorted = malloc((count + 1) * sizeof(report_t *));
+	for (int i = 0; i < count; i++) {
+		report_asset(&assets[i], &reports[i]);
+		reports[i].offender[2] = reports[i].ratio > 1;
+	}
+	report_sort(sorted, reports, count, 0);
+	for (int i = 0; i < count && i < REPORT_TOP; i++) {
+		sorted[i]->offender[0] = 1;
+	}
+	report_sort(sorted, reports, count, 1);
+	for (int i = 0; i < count && i < REPORT_TOP && sorted[i]->decode_us > 0; i++) {
+		sorted[i]->offender[1] = 1;
+	}
+
+	char base[4096], path[4200];
+	snprintf(base, sizeof(base), "%s", opt->image_file);
+	char *slash = strrchr(base, '/');
+	if (slash) {
+		*slash = '\0';
+	}
+	strcat(base, "_report");
+	const char *image = strrchr(opt->image_file, '/');
+	image = image ? image + 1 : opt->image_file;
+	struct stat st;
+	long long image_size = stat(opt->image_file, &st) == 0 ? (long long)st.st_size : 0;
+
+	snprintf(path, sizeof(path), "%s.json", base);
+	FILE *f = fopen(path, "w");
+	if (!f) {
+		ERROR("can't write %s", path);
+	}
+	fprintf(f, "{\n  \"image\": ");
+	write_json_string(f, image);
+	fprintf(f, ",\n  \"partition_size\": %lu,\n  \"image_size\": %lld,\n  \"assets\": [", opt->size, image_size);
+	for (int i = 0; i < count; i++) {
+		const report_t *r = &reports[i];
+		fprintf(f, "%s\n    {\"name\": ", i ? "," : "");
+		write_json_string(f, r->asset->name);
+		fprintf(f, ", \"format\": ");
+		write_json_string(f, r->format);
+		fprintf(f, ", \"width\": %d, \"height\": %d, \"split_height\": %d, \"tiles\": %d, \"frames\": 0, "
+			"\"bytes\": %d, \"rgb565_bytes\": %lld, ", r->asset->width, r->asset->height, r->asset->split_height,
+			r->tiles, r->asset->size, r->rgb565_bytes);
+		r->ratio < 0 ? fprintf(f, "\"ratio\": null, ") : fprintf(f, "\"ratio\": %.3f, ", r->ratio);
+		r->decode_us < 0 ? fprintf(f, "\"decode_us\": null, ") : fprintf(f, "\"decode_us\": %lld, ", r->decode_us);
+		fprintf(f, "\"offender\": [");
+		for (int c = 0, n = 0; c < 3; c++) {
+			if (r->offender[c]) {
+				fprintf(f, "%s\"%s\"", n++ ? ", " : "", report_categories[c]);
+			}
+		}
+		fprintf(f, "]}");
+	}
+	fprintf(f, "\n  ],\n  \"offenders\": {");
+	for (int c = 0; c < 3; c++) {
+		fprintf(f, "%s\n    \"%s\": [", c ? "," : "", report_categories[c]);
+		report_sort(sorted, reports, count, c);
+		for (int i = 0, n = 0; i < count; i++) {
+			if (sorted[i]->offender[c]) {
+				fprintf(f, "%s", n++ ? ", " : "");
+				write_json_string(f, sorted[i]->asset->name);
+			}
+		}
+		fprintf(f, "]");
+	}
+	fprintf(f, "\n  }\n}\n");
+	fclose(f);
+
+	snprintf(path, sizeof(path), "%s.html", base);
+	f = fopen(path, "w");
+	if (!f) {
+		ERROR("can't write %s", path);
+	}
+	fprintf(f, "<!DOCTYPE html>\n<html><head><meta charset=\"utf-8\"><title>");
+	write_html_string(f, image);
+	fprintf(f, " report</title>\n<style>body{font-family:sans-serif}table{border-collapse:collapse}"
+		"td,th{border:1px solid #ccc;padding:2px 6px;text-align:right}td:first-child{text-align:left}"
+		".bad{background:#fcc}</style></head><body>\n<h1>");
+	write_html_string(f, image);
+	fprintf(f, "</h1>\n<p>%lld of %lu bytes used, host decode times</p>\n<table>\n", image_size, opt->size);
+	fprintf(f, "<tr><th>name</th><th>format</th><th>width</th><th>height</th><th>split_height</th><th>tiles</th>"
+		"<th>frames</th><th>bytes</th><th>rgb565_bytes</th><th>ratio</th><th>decode_us</th></tr>\n");
+	for (int i = 0; i < count; i++) {
+		const report_t *r = &reports[i];
+		fprintf(f, "<tr><td>");
+		write_html_string(f, r->asset->name);
+		fprintf(f, "</td><td>");
+		write_html_string(f, r->format);
+		fprintf(f, "</td><td>%d</td><td>%d</td><td>%d</td><td>%d</td><td>0</td><td%s>%d</td><td>%lld</td>",
+			r->asset->width, r->asset->height, r->asset->split_height, r->tiles,
+			r->offender[0] ? " class=\"bad\"" : "", r->asset->size, r->rgb565_bytes);
+		fprintf(f, "<td%s>", r->offender[2] ? " class=\"bad\"" : "");
+		if (r->ratio >= 0) {
+			fprintf(f, "%.3f", r->ratio);
+		}
+		fprintf(f, "</td><td%s>", r->offender[1] ? " class=\"bad\"" : "");
+		if (r->decode_us >= 0) {
+			fprintf(f, "%lld", r->decode_us);
+		}
+		fprintf(f, "</td></tr>\n");
+	}
+	fprintf(f, "</table>\n</body></html>\n");
+	fclose(f);
+
+	printf("Build report: %s.json, %s.html\n", base, base);
+	for (int c = 0; c < 3; c++) {
+		static const char *titles[] = {"  largest:", "  slowest to decode:", "  \033[1;33mlarger than RGB565:\033[0m"};
+		report_sort(sorted, reports, count, c);
+		int n = 0;
+		for (int i = 0; i < count; i++) {
+			const report_t *r = sorted[i];
+			if (!r->offender[c]) {
+				continue;
+			}
+			printf("%s %s", n++ ? "," : titles[c], r->asset->name);
+			if (c == 0) {
+				printf(" (%d bytes)", r->asset->size);
+			}
+			else if (c == 1) {
+				printf(" (%lld us)", r->decode_us);
+			}
+		}
+		if (n) {
+			puts("");
+		}
+	}
+	free(sorted);
+	free(reports);
+}
+
+
+// -----------------------------------------------------------------------------
+// Arguments, same as spiffs_assets_gen.py
+
+static const char *arg_names[] = {
+	NULL, "project_path", "main_path", "assets_path", "size", "image_file", "support_spng",
+	"support_sjpg", "support_format", "split_height", "max_name_len", "support_qoi",
+	"qoi_seek_interval", "qoi_effort", "split_header_version", "split_ram_budget",
+	"raw_max_pixels", "raw_max_ratio", "raw_swap", "split_dedup", "anim_sequence",
+	"build_report", "asset_align", "split_align", "asset_crc"
+};
+#define ARG_COUNT ((int)(sizeof(arg_names) / sizeof(arg_names[0])))
+
+static int arg_index(const char *arg) {
+	if (arg[0] == '-' && arg[1] == 'd') {
+		char *end;
+		long i = strtol(arg + 2, &end, 10);
+		return *end == '\0' && i > 0 && i < ARG_COUNT ? (int)i : 0;
+	}
+	if (arg[0] == '-' && arg[1] == '-') {
+		for (int i = 1; i < ARG_COUNT; i++) {
+			if (strcmp(arg + 2, arg_names[i]) == 0) {
+				return i;
+			}
+		}
+	}
+	return 0;
+}
+
+int main(int argc, char **argv) {
+	const char *args[ARG_COUNT] = {0};
+	args[12] = "0";
+	args[13] = "0";
+	args[14] = "2";
+	args[15] = "0";
+	args[16] = "0";
+	args[17] = "0";
+	args[18] = "OFF";
+	args[19] = "OFF";
+	args[20] = "OFF";
+	args[21] = "OFF";
+	args[22] = "1";
+	args[23] = "1";
+	args[24] = "OFF";
+
+	for (int i = 1; i < argc; i++) {
+		int index = arg_index(argv[i]);
+		if (!index || i + 1 >= argc) {
+			puts("Usage: mmap_pack -d1 <project_path> -d2 <main_path> -d3 <assets_path> -d4 <size> -d5 <image_file>");
+			puts("                 -d6 <support_spng> -d7 <support_sjpg> -d8 <support_format> -d9 <split_height>");
+			puts("                 -d10 <max_name_len> -d11 <support_qoi> [-d12 <qoi_seek_interval>]");
+			puts("                 [-d13 <qoi_effort>] [-d14 <split_header_version>] [-d15 <split_ram_budget>]");
+			puts("                 [-d16 <raw_max_pixels>] [-d17 <raw_max_ratio>] [-d18 <raw_swap>]");
+			puts("                 [-d19 <split_dedup>] [-d20 <anim_sequence>] [-d21 <build_report>]");
+			puts("                 [-d22 <asset_align>] [-d23 <split_align>] [-d24 <asset_crc>]");
+			puts("Same arguments as esp_mmap_assets/spiffs_assets_gen.py, QOI mode only");
+			exit(1);
+		}
+		args[index] = argv[++i];
+	}
+	for (int i = 2; i <= 11; i++) {
+		if (!args[i]) {
+			ERROR("missing --%s", arg_names[i]);
+		}
+	}
+
+	options_t opt = {
+		.main_path = args[2],
+		.assets_path = args[3],
+		.size = strtoul(args[4], NULL, 16),
+		.image_file = args[5],
+		.support_spng = strcmp(args[6], "ON") == 0,
+		.support_sjpg = strcmp(args[7], "ON") == 0,
+		.support_format = args[8],
+		.split_height = atoi(args[9]),
+		.max_name_len = atoi(args[10]),
+		.support_qoi = strcmp(args[11], "ON") == 0,
+		.qoi_seek_interval = atoi(args[12]),
+		.qoi_effort = atoi(args[13]),
+		.header_version = atoi(args[14]),
+		.split_ram_budget = atoi(args[15]),
+		.raw_max_pixels = atoi(args[16]),
+		.raw_max_ratio = atoi(args[17]),
+		.raw_swap = strcmp(args[18], "ON") == 0,
+		.split_dedup = strcmp(args[19], "ON") == 0,
+		.build_report = strcmp(args[21], "ON") == 0,
+		.asset_align = atoi(args[22]),
+		.split_align = atoi(args[23]),
+		.asset_crc = strcmp(args[24], "ON") == 0,
+	};
+	if (opt.asset_align < 1 || (opt.asset_align & (opt.asset_align - 1))) {
+		ERROR("asset_align must be a power of two, not %d.", opt.asset_align);
+	}
+	if (opt.split_align < 1 || (opt.split_align & (opt.split_align - 1))) {
+		ERROR("split_align must be a power of two, not %d.", opt.split_align);
+	}
+	if (opt.support_qoi && strcmp(args[20], "ON") == 0) {
+		ERROR("QOI animations (--anim_sequence) need spiffs_assets_gen.py");
+	}
+
+	asset_t *assets;
+	int count = load_assets(&opt, &assets);
+	count = pack_models(&opt, &assets, count);
+	if (opt.build_report) {
+		write_report(&opt, assets, count);
+	}
+
+	for (int i = 0; i < count; i++) {
+		free(assets[i].name);
+		free(assets[i].data);
+	}
+	free(assets);
+	return 0;
+}
@@ -8,12 +8,19 @@ Simple benchmark suite for png, stbi and qoi
 
 Requires libpng, "stb_image.h" and "stb_image_write.h"
 Compile with: 
-	gcc qoibench.c -std=gnu99 -lpng -O3 -o qoibench 
+	gcc qoibench.c -std=gnu99 -lpng -pthread -O3 -o qoibench 
+
+Add -DQOI_SIMD -march=native to compare the scalar and SIMD encoders.
 
 */
 
 #include <stdio.h>
 #include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <png.h>
 
 #define STB_IMAGE_IMPLEMENTATION
@@ -180,7 +187,8 @@ void png_warning_callback(png_structp png_ptr, png_const_charp warning_msg) {
 	// Ignore warnings about sRGB profiles and such.
 }
 
-void *libpng_decode(void *data, int size, int *out_w, int *out_h) {	
+// Decode into out, or into a newly malloc()ed buffer if out is NULL
+void *libpng_decode(void *data, int size, int *out_w, int *out_h, unsigned char *out) {	
 	png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, png_warning_callback);
 	if (!png) {
 		ERROR("png_create_read_struct");
@@ -233,7 +241,9 @@ void *libpng_decode(void *data, int size, int *out_w, int *out_h) {
 	
 	png_read_update_info(png, info);
 
-	unsigned char* out = malloc(w * h * 4);
+	if (!out) {
+		out = malloc(w * h * 4);
+	}
 	*out_w = w;
 	*out_h = h;
 	
@@ -262,6 +272,234 @@ void stbi_write_callback(void *context, void *data, int size) {
 }
 
 
+// -----------------------------------------------------------------------------
+// Convert RGBA pixels in place to one of the QOI_FMT_* pixel formats. This is
+// the second pass over the frame that a decoder without direct format output
+// has to do.
+
+void rgba_convert(unsigned char *pixels, int px_count, int format) {
+	unsigned char *src = pixels;
+	unsigned char *dst = pixels;
+	for (int i = 0; i < px_count; i++, src += 4) {
+		unsigned char r = src[0], g = src[1], b = src[2], a = src[3];
+		if (format == QOI_FMT_ARGB8888) {
+			*dst++ = b;
+			*dst++ = g;
+			*dst++ = r;
+			*dst++ = a;
+			continue;
+		}
+
+		unsigned short c = ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3);
+		if (format == QOI_FMT_RGB565_SWAP || format == QOI_FMT_RGB565A8_SWAP) {
+			*dst++ = c >> 8;
+			*dst++ = c & 0xff;
+		}
+		else {
+			*dst++ = c & 0xff;
+			*dst++ = c >> 8;
+		}
+		if (format == QOI_FMT_RGB565A8 || format == QOI_FMT_RGB565A8_SWAP) {
+			*dst++ = a;
+		}
+	}
+}
+
+
+// -----------------------------------------------------------------------------
+// Thread pool for the tiled benchmarks. The workers are created once and wait
+// for jobs; each job is a function that is called once for every tile. Tiles
+// are handed out through an atomic counter, so faster threads pick up more.
+
+#define THREADS_MAX 64
+
+typedef void (*tile_fn_t)(void *ctx, int tile);
+
+typedef struct {
+	pthread_t threads[THREADS_MAX];
+	int thread_count;
+	pthread_mutex_t lock;
+	pthread_cond_t start;
+	pthread_cond_t done;
+	int generation;
+	int active;
+	int busy;
+	int quit;
+	tile_fn_t fn;
+	void *ctx;
+	int tiles;
+	int next_tile;
+} thread_pool_t;
+
+thread_pool_t pool = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.start = PTHREAD_COND_INITIALIZER,
+	.done = PTHREAD_COND_INITIALIZER,
+};
+
+void pool_work(void) {
+	int tile;
+	while ((tile = __atomic_fetch_add(&pool.next_tile, 1, __ATOMIC_RELAXED)) < pool.tiles) {
+		pool.fn(pool.ctx, tile);
+	}
+}
+
+void *pool_worker(void *arg) {
+	int id = (int)(intptr_t)arg;
+	int generation = 0;
+
+	pthread_mutex_lock(&pool.lock);
+	while (1) {
+		while (pool.generation == generation && !pool.quit) {
+			pthread_cond_wait(&pool.start, &pool.lock);
+		}
+		if (pool.quit) {
+			break;
+		}
+		generation = pool.generation;
+
+		// Thread 0 is the calling thread, workers are numbered from 1
+		if (id < pool.active) {
+			pthread_mutex_unlock(&pool.lock);
+			pool_work();
+			pthread_mutex_lock(&pool.lock);
+			if (--pool.busy == 0) {
+				pthread_cond_signal(&pool.done);
+			}
+		}
+	}
+	pthread_mutex_unlock(&pool.lock);
+	return NULL;
+}
+
+void pool_init(int thread_count) {
+	pool.thread_count = thread_count;
+	for (int i = 1; i < thread_count; i++) {
+		if (pthread_create(&pool.threads[i], NULL, pool_worker, (void *)(intptr_t)i) != 0) {
+			ERROR("Can't create thread %d", i);
+		}
+	}
+}
+
+void pool_destroy(void) {
+	pthread_mutex_lock(&pool.lock);
+	pool.quit = 1;
+	pthread_cond_broadcast(&pool.start);
+	pthread_mutex_unlock(&pool.lock);
+	for (int i = 1; i < pool.thread_count; i++) {
+		pthread_join(pool.threads[i], NULL);
+	}
+}
+
+// Call fn for every tile on the calling thread plus threads - 1 workers and
+// wait until all tiles are done
+void pool_run(int threads, tile_fn_t fn, void *ctx, int tiles) {
+	pthread_mutex_lock(&pool.lock);
+	pool.fn = fn;
+	pool.ctx = ctx;
+	pool.tiles = tiles;
+	pool.next_tile = 0;
+	pool.active = threads;
+	pool.busy = threads - 1;
+	pool.generation++;
+	pthread_cond_broadcast(&pool.start);
+	pthread_mutex_unlock(&pool.lock);
+
+	pool_work();
+
+	pthread_mutex_lock(&pool.lock);
+	while (pool.busy > 0) {
+		pthread_cond_wait(&pool.done, &pool.lock);
+	}
+	pthread_mutex_unlock(&pool.lock);
+}
+
+
+// -----------------------------------------------------------------------------
+// Tiled encode/decode. Every tile is a complete QOI image of a horizontal
+// stripe, the same way spiffs_assets_gen.py splits images for _SQOI__.
+
+typedef struct {
+	unsigned char *pixels;
+	int w;
+	int h;
+	int channels;
+	int tile_h;
+	int tile_count;
+	void **encoded;
+	int *encoded_size;
+	unsigned char *decoded;
+	unsigned char *prealloc;
+} tiles_t;
+
+static int tile_height(tiles_t *t, int tile) {
+	int h = t->h - tile * t->tile_h;
+	return h < t->tile_h ? h : t->tile_h;
+}
+
+void tile_encode(void *ctx, int tile) {
+	tiles_t *t = ctx;
+	free(t->encoded[tile]);
+	t->encoded[tile] = qoi_encode(t->pixels + tile * t->tile_h * t->w * t->channels, &(qoi_desc){
+		.width = t->w,
+		.height = tile_height(t, tile),
+		.channels = t->channels,
+		.colorspace = QOI_SRGB
+	}, &t->encoded_size[tile]);
+}
+
+void tile_decode(void *ctx, int tile) {
+	tiles_t *t = ctx;
+	qoi_desc desc;
+	if (t->prealloc) {
+		int tile_size = t->tile_h * t->w * 4;
+		qoi_decode_into(t->prealloc + tile * tile_size, tile_size, t->encoded[tile], t->encoded_size[tile], &desc, 4);
+	}
+	else {
+		void *dec_p = qoi_decode(t->encoded[tile], t->encoded_size[tile], &desc, 4);
+		free(dec_p);
+	}
+}
+
+void tile_decode_verify(void *ctx, int tile) {
+	tiles_t *t = ctx;
+	qoi_desc desc;
+	int tile_size = t->tile_h * t->w * t->channels;
+	if (!qoi_decode_into(t->decoded + tile * tile_size, tile_size, t->encoded[tile], t->encoded_size[tile], &desc, t->channels)) {
+		ERROR("QOI tile decode failed");
+	}
+}
+
+
+// -----------------------------------------------------------------------------
+// function to map a whole file into memory, to be released with funmap()
+
+void *fmap(const char *path, int *out_size) {
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		ERROR("Can't open file %s", path);
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		ERROR("Can't stat file %s", path);
+	}
+
+	void *buffer = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (buffer == MAP_FAILED) {
+		ERROR("Can't map file %s", path);
+	}
+	close(fd);
+
+	*out_size = st.st_size;
+	return buffer;
+}
+
+void funmap(void *buffer, int size) {
+	munmap(buffer, size);
+}
+
+
 // -----------------------------------------------------------------------------
 // function to load a whole file into memory
 
@@ -302,11 +540,41 @@ int opt_nodecode = 0;
 int opt_noencode = 0;
 int opt_norecurse = 0;
 int opt_onlytotals = 0;
+int opt_format = 0;
+int opt_output = 0;
+
+enum {
+	OUTPUT_TEXT,
+	OUTPUT_JSON,
+	OUTPUT_CSV,
+};
+int opt_tiles = 0;
+int opt_threads = 1;
+int opt_mmap = 0;
+int opt_prealloc = 0;
+int opt_effort = 0;
+
+static const struct {
+	const char *name;
+	int format;
+} formats[] = {
+	{"rgb565", QOI_FMT_RGB565},
+	{"rgb565swap", QOI_FMT_RGB565_SWAP},
+	{"rgb565a8", QOI_FMT_RGB565A8},
+	{"rgb565a8swap", QOI_FMT_RGB565A8_SWAP},
+	{"argb8888", QOI_FMT_ARGB8888},
+};
 
 enum {
 	LIBPNG,
 	STBI,
 	QOI,
+	QOI_ROWS,
+	QOI_FMT,
+	QOI_CVT,
+	QOI_VEC,
+	QOI_E1,
+	QOI_E2,
 	BENCH_COUNT /* must be the last element */
 };
 static const char *const lib_names[BENCH_COUNT] = {
@@ -314,12 +582,46 @@ static const char *const lib_names[BENCH_COUNT] = {
 	[LIBPNG] =  "libpng: ",
 	[STBI]   =  "stbi:   ",
 	[QOI]    =  "qoi:    ",
+	[QOI_ROWS] = "qoi-row:",
+	[QOI_FMT]  = "qoi-fmt:",
+	[QOI_CVT]  = "qoi+cvt:",
+	[QOI_VEC]  = "qoi-simd",
+	[QOI_E1]   = "qoi-e1: ",
+	[QOI_E2]   = "qoi-e2: ",
 };
 
+int lib_enabled(int lib) {
+	if (opt_nopng && (lib == LIBPNG || lib == STBI)) {
+		return 0;
+	}
+	if (!opt_format && (lib == QOI_FMT || lib == QOI_CVT)) {
+		return 0;
+	}
+	if (!opt_effort && (lib == QOI_E1 || lib == QOI_E2)) {
+		return 0;
+	}
+#ifndef QOI_SIMD
+	if (lib == QOI_VEC) {
+		return 0;
+	}
+#endif
+	return 1;
+}
+
+// Timing of all runs of one benchmark in ns. Only the mean is accumulated
+// for directory and grand totals.
+typedef struct {
+	uint64_t mean;
+	uint64_t min;
+	uint64_t median;
+	uint64_t p95;
+	uint64_t max;
+} benchmark_time_t;
+
 typedef struct {
 	uint64_t size;
-	uint64_t encode_time;
-	uint64_t decode_time;
+	benchmark_time_t encode;
+	benchmark_time_t decode;
 } benchmark_lib_result_t;
 
 typedef struct {
@@ -329,8 +631,43 @@ typedef struct {
 	int w;
 	int h;
 	benchmark_lib_result_t libs[BENCH_COUNT];
+	benchmark_lib_result_t tiled[THREADS_MAX];
 } benchmark_result_t;
 
+void benchmark_lib_result_add(benchmark_lib_result_t *total, benchmark_lib_result_t *res) {
+	total->encode.mean += res->encode.mean;
+	total->decode.mean += res->decode.mean;
+	total->size += res->size;
+}
+
+void benchmark_result_add(benchmark_result_t *total, benchmark_result_t *res) {
+	total->count++;
+	total->raw_size += res->raw_size;
+	total->px += res->px;
+	for (int i = 0; i < BENCH_COUNT; ++i) {
+		benchmark_lib_result_add(&total->libs[i], &res->libs[i]);
+	}
+	for (int i = 0; i < opt_threads; ++i) {
+		benchmark_lib_result_add(&total->tiled[i], &res->tiled[i]);
+	}
+}
+
+void benchmark_print_lib_result(const char *name, benchmark_lib_result_t lib, int count, double px, uint64_t raw_size) {
+	lib.encode.mean /= count;
+	lib.decode.mean /= count;
+	lib.size /= count;
+	printf(
+		"%s   %8.1f    %8.1f      %8.2f      %8.2f  %8ld   %4.1f%%\n",
+		name,
+		(double)lib.decode.mean/1000000.0,
+		(double)lib.encode.mean/1000000.0,
+		(lib.decode.mean > 0 ? px / ((double)lib.decode.mean/1000.0) : 0),
+		(lib.encode.mean > 0 ? px / ((double)lib.encode.mean/1000.0) : 0),
+		lib.size/1024,
+		((double)lib.size/(double)raw_size) * 100.0
+	);
+}
+
 
 void benchmark_print_result(benchmark_result_t res) {
 	res.px /= res.count;
@@ -339,43 +676,174 @@ void benchmark_print_result(benchmark_result_t res) {
 	double px = res.px;
 	printf("          decode ms   encode ms   decode mpps   encode mpps   size kb    rate\n");
 	for (int i = 0; i < BENCH_COUNT; ++i) {
-		if (opt_nopng && (i == LIBPNG || i == STBI)) {
+		if (!lib_enabled(i)) {
 			continue;
 		}
-		res.libs[i].encode_time /= res.count;
-		res.libs[i].decode_time /= res.count;
-		res.libs[i].size /= res.count;
-		printf(
-			"%s   %8.1f    %8.1f      %8.2f      %8.2f  %8ld   %4.1f%%\n",
-			lib_names[i],
-			(double)res.libs[i].decode_time/1000000.0,
-			(double)res.libs[i].encode_time/1000000.0,
-			(res.libs[i].decode_time > 0 ? px / ((double)res.libs[i].decode_time/1000.0) : 0),
-			(res.libs[i].encode_time > 0 ? px / ((double)res.libs[i].encode_time/1000.0) : 0),
-			res.libs[i].size/1024,
-			((double)res.libs[i].size/(double)res.raw_size) * 100.0
-		);
+		benchmark_print_lib_result(lib_names[i], res.libs[i], res.count, px, res.raw_size);
 	}
 	printf("\n");
+
+	if (opt_tiles) {
+		printf("tiles %-3d decode ms   encode ms   decode mpps   encode mpps   size kb    rate\n", opt_tiles);
+		for (int i = 0; i < opt_threads; ++i) {
+			char name[16];
+			snprintf(name, sizeof(name), "qoi-t%-2d:", i + 1);
+			benchmark_print_lib_result(name, res.tiled[i], res.count, px, res.raw_size);
+		}
+		printf("\n");
+	}
+}
+
+static int benchmark_cmp_time(const void *a, const void *b) {
+	uint64_t ta = *(const uint64_t *)a;
+	uint64_t tb = *(const uint64_t *)b;
+	return ta < tb ? -1 : ta > tb;
+}
+
+// Fill the mean and percentiles from the times of all runs. p95 uses the
+// nearest rank.
+void benchmark_time_from_runs(benchmark_time_t *time, uint64_t *runs, int count) {
+	uint64_t sum = 0;
+	for (int i = 0; i < count; i++) {
+		sum += runs[i];
+	}
+	qsort(runs, count, sizeof(uint64_t), benchmark_cmp_time);
+
+	time->mean = sum / count;
+	time->min = runs[0];
+	time->max = runs[count - 1];
+	time->median = count % 2
+		? runs[count / 2]
+		: (runs[count / 2 - 1] + runs[count / 2]) / 2;
+	time->p95 = runs[(count * 95 + 99) / 100 - 1];
 }
 
-// Run __VA_ARGS__ a number of times and measure the time taken. The first
-// run is ignored.
-#define BENCHMARK_FN(NOWARMUP, RUNS, AVG_TIME, ...) \
+// Run __VA_ARGS__ a number of times and record the time taken by each run in
+// TIME. The first run is ignored.
+#define BENCHMARK_FN(NOWARMUP, RUNS, TIME, ...) \
 	do { \
-		uint64_t time = 0; \
+		uint64_t runs[RUNS]; \
 		for (int i = NOWARMUP; i <= RUNS; i++) { \
 			uint64_t time_start = ns(); \
 			__VA_ARGS__ \
 			uint64_t time_end = ns(); \
 			if (i > 0) { \
-				time += time_end - time_start; \
+				runs[i - 1] = time_end - time_start; \
 			} \
 		} \
-		AVG_TIME = time / RUNS; \
+		benchmark_time_from_runs(&(TIME), runs, RUNS); \
 	} while (0)
 
 
+// -----------------------------------------------------------------------------
+// Machine readable output of the results of every image
+
+static void write_lib_name(char *out, const char *name) {
+	// Strip the padding and colon of the table labels
+	int len = strlen(name);
+	while (len > 0 && (name[len - 1] == ' ' || name[len - 1] == ':')) {
+		len--;
+	}
+	memcpy(out, name, len);
+	out[len] = '\0';
+}
+
+static void write_json_string(const char *str) {
+	putchar('"');
+	for (const unsigned char *c = (const unsigned char *)str; *c; c++) {
+		if (*c == '"' || *c == '\\') {
+			printf("\\%c", *c);
+		}
+		else if (*c < 0x20) {
+			printf("\\u%04x", *c);
+		}
+		else {
+			putchar(*c);
+		}
+	}
+	putchar('"');
+}
+
+static void write_csv_string(const char *str) {
+	putchar('"');
+	for (const char *c = str; *c; c++) {
+		if (*c == '"') {
+			putchar('"');
+		}
+		putchar(*c);
+	}
+	putchar('"');
+}
+
+void write_output_head(void) {
+	if (opt_output == OUTPUT_JSON) {
+		printf("{\"runs\": %d, \"results\": [", opt_runs);
+	}
+	else if (opt_output == OUTPUT_CSV) {
+		printf(
+			"image,width,height,lib,size,"
+			"decode_mean_ns,decode_min_ns,decode_median_ns,decode_p95_ns,decode_max_ns,"
+			"encode_mean_ns,encode_min_ns,encode_median_ns,encode_p95_ns,encode_max_ns\n"
+		);
+	}
+}
+
+void write_output_tail(void) {
+	if (opt_output == OUTPUT_JSON) {
+		printf("\n]}\n");
+	}
+}
+
+static void write_output_time(const char *key, benchmark_time_t *t) {
+	if (opt_output == OUTPUT_JSON) {
+		printf(
+			", \"%s\": {\"mean_ns\": %lu, \"min_ns\": %lu, \"median_ns\": %lu, \"p95_ns\": %lu, \"max_ns\": %lu}",
+			key, t->mean, t->min, t->median, t->p95, t->max
+		);
+	}
+	else {
+		printf(",%lu,%lu,%lu,%lu,%lu", t->mean, t->min, t->median, t->p95, t->max);
+	}
+}
+
+static void write_output_lib(const char *path, benchmark_result_t *res, const char *name, benchmark_lib_result_t *lib) {
+	static int results_written = 0;
+	char lib_name[32];
+	write_lib_name(lib_name, name);
+
+	if (opt_output == OUTPUT_JSON) {
+		printf("%s\n  {\"image\": ", results_written ? "," : "");
+		write_json_string(path);
+		printf(", \"width\": %d, \"height\": %d, \"lib\": ", res->w, res->h);
+		write_json_string(lib_name);
+		printf(", \"size\": %lu", lib->size);
+	}
+	else {
+		write_csv_string(path);
+		printf(",%d,%d,", res->w, res->h);
+		write_csv_string(lib_name);
+		printf(",%lu", lib->size);
+	}
+	write_output_time("decode", &lib->decode);
+	write_output_time("encode", &lib->encode);
+	printf(opt_output == OUTPUT_JSON ? "}" : "\n");
+	results_written++;
+}
+
+void write_output_result(const char *path, benchmark_result_t *res) {
+	for (int i = 0; i < BENCH_COUNT; ++i) {
+		if (lib_enabled(i)) {
+			write_output_lib(path, res, lib_names[i], &res->libs[i]);
+		}
+	}
+	for (int i = 0; opt_tiles && i < opt_threads; ++i) {
+		char name[16];
+		snprintf(name, sizeof(name), "qoi-t%d", i + 1);
+		write_output_lib(path, res, name, &res->tiled[i]);
+	}
+}
+
+
 benchmark_result_t benchmark_image(const char *path) {
 	int encoded_png_size;
 	int encoded_qoi_size;
@@ -393,7 +861,9 @@ benchmark_result_t benchmark_image(const char *path) {
 	}
 
 	void *pixels = (void *)stbi_load(path, &w, &h, NULL, channels);
-	void *encoded_png = fload(path, &encoded_png_size);
+	void *encoded_png = opt_mmap
+		? fmap(path, &encoded_png_size)
+		: fload(path, &encoded_png_size);
 	void *encoded_qoi = qoi_encode(pixels, &(qoi_desc){
 			.width = w,
 			.height = h, 
@@ -414,6 +884,89 @@ benchmark_result_t benchmark_image(const char *path) {
 			ERROR("QOI roundtrip pixel mismatch for %s", path);
 		}
 		free(pixels_qoi);
+
+		// Decode row by row, feeding the data in small chunks to exercise
+		// resuming in the middle of ops and rows
+		qoi_dec_state dec;
+		int p = qoi_decode_init(&dec, encoded_qoi, encoded_qoi_size, channels);
+		unsigned char *rows_qoi = malloc(w * h * channels);
+		while (p && dec.y < dec.desc.height) {
+			int chunk = encoded_qoi_size - p < 7 ? encoded_qoi_size - p : 7;
+			if (qoi_decode_rows(&dec, (unsigned char *)encoded_qoi + p, chunk, rows_qoi + dec.y * w * channels, h) < 0) {
+				break;
+			}
+			if (dec.consumed == 0 && chunk < 7) {
+				break;
+			}
+			p += dec.consumed;
+		}
+		if (!p || dec.y != h || memcmp(pixels, rows_qoi, w * h * channels) != 0) {
+			ERROR("QOI row decode pixel mismatch for %s", path);
+		}
+		free(rows_qoi);
+
+		// Direct format output must match decoding to RGBA and converting
+		if (opt_format) {
+			void *fmt_qoi = qoi_decode(encoded_qoi, encoded_qoi_size, &dc, opt_format);
+			void *cvt_qoi = qoi_decode(encoded_qoi, encoded_qoi_size, &dc, 4);
+			rgba_convert(cvt_qoi, w * h, opt_format);
+			if (!fmt_qoi || memcmp(fmt_qoi, cvt_qoi, w * h * QOI_FMT_BPP(opt_format)) != 0) {
+				ERROR("QOI format output mismatch for %s", path);
+			}
+			free(fmt_qoi);
+			free(cvt_qoi);
+		}
+
+#ifdef QOI_SIMD
+		// The SIMD encoder must be bit-exact
+		int scalar_size;
+		void *encoded_scalar = qoi_encode_scalar(pixels, &(qoi_desc){
+				.width = w,
+				.height = h,
+				.channels = channels,
+				.colorspace = QOI_SRGB
+			}, &scalar_size);
+		if (scalar_size != encoded_qoi_size || memcmp(encoded_scalar, encoded_qoi, scalar_size) != 0) {
+			ERROR("QOI SIMD encoder output mismatch for %s", path);
+		}
+		free(encoded_scalar);
+#endif
+	}
+
+	// Images encoded with higher effort levels. They must decode to the same
+	// pixels as far as the effort level allows
+	void *encoded_effort[2] = {NULL, NULL};
+	int encoded_effort_size[2] = {0, 0};
+	for (int e = 0; opt_effort && e < 2; e++) {
+		int effort = e == 0 ? QOI_EFFORT_ALPHA : QOI_EFFORT_RGB565;
+		encoded_effort[e] = qoi_encode_ex(pixels, &(qoi_desc){
+				.width = w,
+				.height = h,
+				.channels = channels,
+				.colorspace = QOI_SRGB
+			}, &encoded_effort_size[e], effort);
+		if (!encoded_effort[e]) {
+			ERROR("Error encoding %s with effort %d", path, effort);
+		}
+		if (!opt_noverify) {
+			qoi_desc dc;
+			unsigned char *dec_p = qoi_decode(encoded_effort[e], encoded_effort_size[e], &dc, channels);
+			if (!dec_p) {
+				ERROR("QOI effort %d decode error for %s", effort, path);
+			}
+			unsigned char *a = pixels;
+			unsigned char *b = dec_p;
+			int mask = effort == QOI_EFFORT_RGB565 ? 0xf8fcf8 : 0xffffff;
+			for (int i = 0; i < w * h; i++, a += channels, b += channels) {
+				int alpha = channels == 4 ? a[3] : 255;
+				int rgb_a = a[0] << 16 | a[1] << 8 | a[2];
+				int rgb_b = b[0] << 16 | b[1] << 8 | b[2];
+				if ((channels == 4 && a[3] != b[3]) || (alpha && ((rgb_a ^ rgb_b) & mask))) {
+					ERROR("QOI effort %d pixel mismatch for %s", effort, path);
+				}
+			}
+			free(dec_p);
+		}
 	}
 
 
@@ -424,53 +977,125 @@ benchmark_result_t benchmark_image(const char *path) {
 	res.px = w * h;
 	res.w = w;
 	res.h = h;
+	res.libs[QOI_E1].size = encoded_effort_size[0];
+	res.libs[QOI_E2].size = encoded_effort_size[1];
 
 
-	// Decoding
+	// Decoding. With --prealloc all decoders but stbi write into one reused
+	// buffer, so the timings don't include the allocator.
+
+	unsigned char *prealloc = opt_prealloc ? malloc(w * h * 4) : NULL;
+	int prealloc_size = w * h * 4;
 
 	if (!opt_nodecode) {
 		if (!opt_nopng) {
-			BENCHMARK_FN(opt_nowarmup, opt_runs, res.libs[LIBPNG].decode_time, {
+			BENCHMARK_FN(opt_nowarmup, opt_runs, res.libs[LIBPNG].decode, {
 				int dec_w, dec_h;
-				void *dec_p = libpng_decode(encoded_png, encoded_png_size, &dec_w, &dec_h);
-				free(dec_p);
+				void *dec_p = libpng_decode(encoded_png, encoded_png_size, &dec_w, &dec_h, prealloc);
+				if (!prealloc) {
+					free(dec_p);
+				}
 			});
 
-			BENCHMARK_FN(opt_nowarmup, opt_runs, res.libs[STBI].decode_time, {
+			BENCHMARK_FN(opt_nowarmup, opt_runs, res.libs[STBI].decode, {
 				int dec_w, dec_h, dec_channels;
 				void *dec_p = stbi_load_from_memory(encoded_png, encoded_png_size, &dec_w, &dec_h, &dec_channels, 4);
 				free(dec_p);
 			});
 		}
 
-		BENCHMARK_FN(opt_nowarmup, opt_runs, res.libs[QOI].decode_time, {
+		BENCHMARK_FN(opt_nowarmup, opt_runs, res.libs[QOI].decode, {
 			qoi_desc desc;
-			void *dec_p = qoi_decode(encoded_qoi, encoded_qoi_size, &desc, 4);
-			free(dec_p);
+			if (prealloc) {
+				qoi_decode_into(prealloc, prealloc_size, encoded_qoi, encoded_qoi_size, &desc, 4);
+			}
+			else {
+				void *dec_p = qoi_decode(encoded_qoi, encoded_qoi_size, &desc, 4);
+				free(dec_p);
+			}
+		});
+
+		// Decode into a single, reused row buffer as an embedded display
+		// driver would
+		unsigned char *row = malloc(w * 4);
+		BENCHMARK_FN(opt_nowarmup, opt_runs, res.libs[QOI_ROWS].decode, {
+			qoi_dec_state dec;
+			int p = qoi_decode_init(&dec, encoded_qoi, encoded_qoi_size, 4);
+			while (p && dec.y < dec.desc.height) {
+				qoi_decode_rows(&dec, (unsigned char *)encoded_qoi + p, encoded_qoi_size - p, row, 1);
+				p += dec.consumed;
+			}
 		});
+		free(row);
+
+		for (int e = 0; opt_effort && e < 2; e++) {
+			BENCHMARK_FN(opt_nowarmup, opt_runs, res.libs[QOI_E1 + e].decode, {
+				qoi_desc desc;
+				if (prealloc) {
+					qoi_decode_into(prealloc, prealloc_size, encoded_effort[e], encoded_effort_size[e], &desc, 4);
+				}
+				else {
+					void *dec_p = qoi_decode(encoded_effort[e], encoded_effort_size[e], &desc, 4);
+					free(dec_p);
+				}
+			});
+		}
+
+		if (opt_format) {
+			BENCHMARK_FN(opt_nowarmup, opt_runs, res.libs[QOI_FMT].decode, {
+				qoi_desc desc;
+				if (prealloc) {
+					qoi_decode_into(prealloc, prealloc_size, encoded_qoi, encoded_qoi_size, &desc, opt_format);
+				}
+				else {
+					void *dec_p = qoi_decode(encoded_qoi, encoded_qoi_size, &desc, opt_format);
+					free(dec_p);
+				}
+			});
+
+			BENCHMARK_FN(opt_nowarmup, opt_runs, res.libs[QOI_CVT].decode, {
+				qoi_desc desc;
+				if (prealloc) {
+					qoi_decode_into(prealloc, prealloc_size, encoded_qoi, encoded_qoi_size, &desc, 4);
+					rgba_convert(prealloc, w * h, opt_format);
+				}
+				else {
+					void *dec_p = qoi_decode(encoded_qoi, encoded_qoi_size, &desc, 4);
+					rgba_convert(dec_p, w * h, opt_format);
+					free(dec_p);
+				}
+			});
+		}
 	}
 
 
 	// Encoding
 	if (!opt_noencode) {
 		if (!opt_nopng) {
-			BENCHMARK_FN(opt_nowarmup, opt_runs, res.libs[LIBPNG].encode_time, {
+			BENCHMARK_FN(opt_nowarmup, opt_runs, res.libs[LIBPNG].encode, {
 				int enc_size;
 				void *enc_p = libpng_encode(pixels, w, h, channels, &enc_size);
 				res.libs[LIBPNG].size = enc_size;
 				free(enc_p);
 			});
 
-			BENCHMARK_FN(opt_nowarmup, opt_runs, res.libs[STBI].encode_time, {
+			BENCHMARK_FN(opt_nowarmup, opt_runs, res.libs[STBI].encode, {
 				int enc_size = 0;
 				stbi_write_png_to_func(stbi_write_callback, &enc_size, w, h, channels, pixels, 0);
 				res.libs[STBI].size = enc_size;
 			});
 		}
 
-		BENCHMARK_FN(opt_nowarmup, opt_runs, res.libs[QOI].encode_time, {
+		// With QOI_SIMD, qoi_encode() is the SIMD path and the qoi row shows
+		// the scalar encoder for comparison
+#ifdef QOI_SIMD
+		#define QOI_ENCODE_SCALAR qoi_encode_scalar
+#else
+		#define QOI_ENCODE_SCALAR qoi_encode
+#endif
+		BENCHMARK_FN(opt_nowarmup, opt_runs, res.libs[QOI].encode, {
 			int enc_size;
-			void *enc_p = qoi_encode(pixels, &(qoi_desc){
+			void *enc_p = QOI_ENCODE_SCALAR(pixels, &(qoi_desc){
 				.width = w,
 				.height = h, 
 				.channels = channels,
@@ -479,11 +1104,99 @@ benchmark_result_t benchmark_image(const char *path) {
 			res.libs[QOI].size = enc_size;
 			free(enc_p);
 		});
+
+#ifdef QOI_SIMD
+		BENCHMARK_FN(opt_nowarmup, opt_runs, res.libs[QOI_VEC].encode, {
+			int enc_size;
+			void *enc_p = qoi_encode(pixels, &(qoi_desc){
+				.width = w,
+				.height = h,
+				.channels = channels,
+				.colorspace = QOI_SRGB
+			}, &enc_size);
+			res.libs[QOI_VEC].size = enc_size;
+			free(enc_p);
+		});
+#endif
+		for (int e = 0; opt_effort && e < 2; e++) {
+			int effort = e == 0 ? QOI_EFFORT_ALPHA : QOI_EFFORT_RGB565;
+			BENCHMARK_FN(opt_nowarmup, opt_runs, res.libs[QOI_E1 + e].encode, {
+				int enc_size;
+				void *enc_p = qoi_encode_ex(pixels, &(qoi_desc){
+					.width = w,
+					.height = h,
+					.channels = channels,
+					.colorspace = QOI_SRGB
+				}, &enc_size, effort);
+				free(enc_p);
+			});
+		}
+		res.libs[QOI_ROWS].size = res.libs[QOI].size;
+		res.libs[QOI_FMT].size = res.libs[QOI].size;
+		res.libs[QOI_CVT].size = res.libs[QOI].size;
+	}
+
+	// Tiled encoding/decoding with 1 to opt_threads threads
+	if (opt_tiles) {
+		tiles_t tiles = {
+			.pixels = pixels,
+			.w = w,
+			.h = h,
+			.channels = channels,
+			.tile_h = opt_tiles,
+			.tile_count = (h + opt_tiles - 1) / opt_tiles,
+			.prealloc = prealloc,
+		};
+		tiles.encoded = calloc(tiles.tile_count, sizeof(void *));
+		tiles.encoded_size = calloc(tiles.tile_count, sizeof(int));
+		pool_run(opt_threads, tile_encode, &tiles, tiles.tile_count);
+
+		int tiles_size = 0;
+		for (int i = 0; i < tiles.tile_count; i++) {
+			tiles_size += tiles.encoded_size[i];
+		}
+
+		if (!opt_noverify) {
+			tiles.decoded = malloc(w * h * channels);
+			pool_run(opt_threads, tile_decode_verify, &tiles, tiles.tile_count);
+			if (memcmp(pixels, tiles.decoded, w * h * channels) != 0) {
+				ERROR("QOI tiled roundtrip pixel mismatch for %s", path);
+			}
+			free(tiles.decoded);
+		}
+
+		for (int t = 0; t < opt_threads; t++) {
+			res.tiled[t].size = tiles_size;
+			if (!opt_nodecode) {
+				BENCHMARK_FN(opt_nowarmup, opt_runs, res.tiled[t].decode, {
+					pool_run(t + 1, tile_decode, &tiles, tiles.tile_count);
+				});
+			}
+			if (!opt_noencode) {
+				BENCHMARK_FN(opt_nowarmup, opt_runs, res.tiled[t].encode, {
+					pool_run(t + 1, tile_encode, &tiles, tiles.tile_count);
+				});
+			}
+		}
+
+		for (int i = 0; i < tiles.tile_count; i++) {
+			free(tiles.encoded[i]);
+		}
+		free(tiles.encoded);
+		free(tiles.encoded_size);
 	}
 
+	free(prealloc);
 	free(pixels);
-	free(encoded_png);
 	free(encoded_qoi);
+	free(encoded_effort[0]);
+	free(encoded_effort[1]);
+	if (opt_mmap) {
+		funmap(encoded_png, encoded_png_size);
+	}
+	else {
+		free(encoded_png);
+	}
 
 	return res;
 }
@@ -519,7 +1232,7 @@ void benchmark_directory(const char *path, benchmark_result_t *grand_total) {
 			continue;
 		}
 
-		if (!has_shown_head) {
+		if (!has_shown_head && opt_output == OUTPUT_TEXT) {
 			has_shown_head = 1;
 			printf("## Benchmarking %s/*.png -- %d runs\n\n", path, opt_runs);
 		}
@@ -529,34 +1242,23 @@ void benchmark_directory(const char *path, benchmark_result_t *grand_total) {
 		
 		benchmark_result_t res = benchmark_image(file_path);
 
-		if (!opt_onlytotals) {
+		if (opt_output != OUTPUT_TEXT) {
+			write_output_result(file_path, &res);
+		}
+		else if (!opt_onlytotals) {
 			printf("## %s size: %dx%d\n", file_path, res.w, res.h);
 			benchmark_print_result(res);
 		}
+		fflush(stdout);
 
 		free(file_path);
 		
-		dir_total.count++;
-		dir_total.raw_size += res.raw_size;
-		dir_total.px += res.px;
-		for (int i = 0; i < BENCH_COUNT; ++i) {
-			dir_total.libs[i].encode_time += res.libs[i].encode_time;
-			dir_total.libs[i].decode_time += res.libs[i].decode_time;
-			dir_total.libs[i].size += res.libs[i].size;
-		}
-
-		grand_total->count++;
-		grand_total->raw_size += res.raw_size;
-		grand_total->px += res.px;
-		for (int i = 0; i < BENCH_COUNT; ++i) {
-			grand_total->libs[i].encode_time += res.libs[i].encode_time;
-			grand_total->libs[i].decode_time += res.libs[i].decode_time;
-			grand_total->libs[i].size += res.libs[i].size;
-		}
+		benchmark_result_add(&dir_total, &res);
+		benchmark_result_add(grand_total, &res);
 	}
 	closedir(dir);
 
-	if (dir_total.count > 0) {
+	if (dir_total.count > 0 && opt_output == OUTPUT_TEXT) {
 		printf("## Total for %s\n", path);
 		benchmark_print_result(dir_total);
 	}
@@ -573,9 +1275,25 @@ int main(int argc, char **argv) {
 		printf("    --nodecode ... don't run decoders\n");
 		printf("    --norecurse .. don't descend into directories\n");
 		printf("    --onlytotals . don't print individual image results\n");
+		printf("    --format <f> . also decode directly to pixel format <f> and compare\n");
+		printf("                   against decoding to rgba plus a conversion pass\n");
+		printf("                   (rgb565, rgb565swap, rgb565a8, rgb565a8swap, argb8888)\n");
+		printf("    --format <o> . print the mean, min, median, p95 and max times of\n");
+		printf("                   every image and lib as json or csv instead of tables\n");
+		printf("    --mmap ....... map the png files into memory instead of reading them\n");
+		printf("    --prealloc ... decode into one reused buffer instead of a malloc()\n");
+		printf("                   per run (except stbi, which always allocates)\n");
+		printf("    --effort ..... also encode with the QOI_EFFORT_ALPHA (qoi-e1) and\n");
+		printf("                   QOI_EFFORT_RGB565 (qoi-e2) effort levels\n");
+		printf("    --tiles <h> .. also encode/decode images split into tiles of h rows\n");
+		printf("    --threads <n>  process the tiles with 1 to n threads (default 1)\n");
 		printf("Examples\n");
 		printf("    qoibench 10 images/textures/\n");
 		printf("    qoibench 1 images/textures/ --nopng --nowarmup\n");
+		printf("    qoibench 10 images/textures/ --nopng --format rgb565\n");
+		printf("    qoibench 10 images/textures/ --nopng --tiles 32 --threads 8\n");
+		printf("    qoibench 20 images/textures/ --format csv > results.csv\n");
+		printf("    qoibench 10 images/textures/ --nopng --effort\n");
 		exit(1);
 	}
 
@@ -587,6 +1305,36 @@ int main(int argc, char **argv) {
 		else if (strcmp(argv[i], "--nodecode") == 0) { opt_nodecode = 1; }
 		else if (strcmp(argv[i], "--norecurse") == 0) { opt_norecurse = 1; }
 		else if (strcmp(argv[i], "--onlytotals") == 0) { opt_onlytotals = 1; }
+		else if (strcmp(argv[i], "--mmap") == 0) { opt_mmap = 1; }
+		else if (strcmp(argv[i], "--prealloc") == 0) { opt_prealloc = 1; }
+		else if (strcmp(argv[i], "--effort") == 0) { opt_effort = 1; }
+		else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+			// Output and pixel formats share the option; it may be given
+			// once for each
+			i++;
+			if (strcmp(argv[i], "json") == 0) { opt_output = OUTPUT_JSON; continue; }
+			if (strcmp(argv[i], "csv") == 0) { opt_output = OUTPUT_CSV; continue; }
+			for (int j = 0; j < sizeof(formats) / sizeof(formats[0]); j++) {
+				if (strcmp(argv[i], formats[j].name) == 0) {
+					opt_format = formats[j].format;
+				}
+			}
+			if (!opt_format) {
+				ERROR("Unknown format %s", argv[i]);
+			}
+		}
+		else if (strcmp(argv[i], "--tiles") == 0 && i + 1 < argc) {
+			opt_tiles = atoi(argv[++i]);
+			if (opt_tiles <= 0) {
+				ERROR("Invalid tile height %s", argv[i]);
+			}
+		}
+		else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+			opt_threads = atoi(argv[++i]);
+			if (opt_threads <= 0 || opt_threads > THREADS_MAX) {
+				ERROR("Invalid number of threads %s", argv[i]);
+			}
+		}
 		else { ERROR("Unknown option %s", argv[i]); }
 	}
 
@@ -595,10 +1343,27 @@ int main(int argc, char **argv) {
 		ERROR("Invalid number of runs %d", opt_runs);
 	}
 
+	if (opt_tiles) {
+		pool_init(opt_threads);
+	}
+
+	write_output_head();
+
 	benchmark_result_t grand_total = {0};
 	benchmark_directory(argv[2], &grand_total);
 
-	if (grand_total.count > 0) {
+	write_output_tail();
+
+	if (opt_tiles) {
+		pool_destroy();
+	}
+
+	if (opt_output != OUTPUT_TEXT) {
+		if (grand_total.count == 0) {
+			fprintf(stderr, "No images found in %s\n", argv[2]);
+		}
+	}
+	else if (grand_total.count > 0) {
 		printf("# Grand total for %s\n", argv[2]);
 		benchmark_print_result(grand_total);
 	}
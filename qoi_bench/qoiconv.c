@@ -31,12 +31,60 @@ Compile with:
 
 #define STR_ENDS_WITH(S, E) (strcmp(S + strlen(S) - (sizeof(E)-1), E) == 0)
 
+// Encode and write a QOI file with the given effort level, followed by a seek
+// table with a snapshot every interval rows unless interval is 0
+static int qoi_write_ex(const char *filename, const void *data, const qoi_desc *desc, int effort, int interval) {
+	int size, table_len = 0, err;
+	void *encoded = qoi_encode_ex(data, desc, &size, effort);
+	if (!encoded) {
+		return 0;
+	}
+
+	void *table = interval ? qoi_seek_build(encoded, size, interval, &table_len) : NULL;
+	FILE *f = table || !interval ? fopen(filename, "wb") : NULL;
+	if (!f) {
+		free(table);
+		free(encoded);
+		return 0;
+	}
+
+	fwrite(encoded, 1, size, f);
+	if (table) {
+		fwrite(table, 1, table_len, f);
+	}
+	fflush(f);
+	err = ferror(f);
+	fclose(f);
+
+	free(table);
+	free(encoded);
+	return err ? 0 : size + table_len;
+}
+
 int main(int argc, char **argv) {
-	if (argc < 3) {
-		puts("Usage: qoiconv <infile> <outfile>");
+	int seek = 0;
+	int effort = QOI_EFFORT_FAST;
+	while (argc > 2 && strncmp(argv[1], "--", 2) == 0) {
+		if (strcmp(argv[1], "--seek") == 0) { seek = atoi(argv[2]); }
+		else if (strcmp(argv[1], "--effort") == 0) { effort = atoi(argv[2]); }
+		else { break; }
+		argv += 2;
+		argc -= 2;
+	}
+
+	if (argc < 3 || seek < 0 || effort < QOI_EFFORT_FAST || effort > QOI_EFFORT_RGB565) {
+		puts("Usage: qoiconv [--seek rows] [--effort level] <infile> <outfile>");
+		puts("Options:");
+		puts("  --seek rows .... append a seek table with a snapshot every rows rows to a .qoi outfile");
+		puts("  --effort level . encoder effort for a .qoi outfile:");
+		puts("                   0 = lossless (default)");
+		puts("                   1 = encode fully transparent pixels as transparent black");
+		puts("                   2 = as 1, and round colors to RGB565 precision");
 		puts("Examples:");
 		puts("  qoiconv input.png output.qoi");
 		puts("  qoiconv input.qoi output.png");
+		puts("  qoiconv --seek 16 input.png output.qoi");
+		puts("  qoiconv --effort 2 input.png output.qoi");
 		exit(1);
 	}
 
@@ -73,12 +121,15 @@ int main(int argc, char **argv) {
 		encoded = stbi_write_png(argv[2], w, h, channels, pixels, 0);
 	}
 	else if (STR_ENDS_WITH(argv[2], ".qoi")) {
-		encoded = qoi_write(argv[2], pixels, &(qoi_desc){
+		qoi_desc desc = {
 			.width = w,
 			.height = h, 
 			.channels = channels,
 			.colorspace = QOI_SRGB
-		});
+		};
+		encoded = seek || effort
+			? qoi_write_ex(argv[2], pixels, &desc, effort, seek)
+			: qoi_write(argv[2], pixels, &desc);
 	}
 
 	if (!encoded) {
@@ -0,0 +1,641 @@
+/*
+
+SPDX-License-Identifier: MIT
+
+
+Differential fuzzing harness for the qoi.h copies in this tree
+
+Every input is run through qoi_bench/qoi.h (plain and with QOI_SIMD) and the
+copies in the esp_lv_sqoi and esp_lv_qoi components. All of them have to
+agree byte for byte on:
+	- qoi_decode() to RGB, RGBA and every QOI_FMT_* pixel format
+	- qoi_decode_into(), including its bounds check
+	- qoi_decode_rows() fed in chunks, against the rows of qoi_decode()
+	- qoi_seek_build() and qoi_decode_seek() from any row
+	- qoi_encode() and qoi_encode_ex() at every effort level
+Split images are parsed with split_image.h, as decoder_open() does, and each
+split is checked like a single image. Animations are parsed with anim_image.h,
+and the splits of their keyframe and each patch of their frames are checked
+the same way.
+
+The first input byte selects the test, the second its parameters:
+	0: decode the rest as a QOI image
+	1: decode the rest as a split image, after the "_SQOI__\0V1.00\0" magic
+	2: encode the rest as RGB or RGBA pixels
+	3: decode the rest as a split image, after the "_SQOI__\0V2.00\0" magic
+	4: decode the rest as a split image, after the "_SQOI__\0V3.00\0" magic
+	5: decode the rest as an animation, after the "_AQOI__\0V1.00\0" magic
+
+Compile and run with libFuzzer:
+	make fuzz && ./qoidiff-fuzz
+
+Without clang, build the standalone driver, which runs the given files or
+random inputs derived from encoded images:
+	make diff && ./qoidiff 100000
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "qoidiff.h"
+#include "../decoder_bench/components/esp_lv_sqoi/priv_include/split_image.h"
+#include "../decoder_bench/components/esp_lv_sqoi/priv_include/anim_image.h"
+
+static const qoidiff_copy_t *const copies[] = {
+	&qoidiff_bench,
+	&qoidiff_simd,
+	&qoidiff_sqoi,
+	&qoidiff_c2,
+};
+#define COPY_COUNT ((int)(sizeof(copies) / sizeof(copies[0])))
+
+static const int channel_list[] = {
+	0, 3, 4,
+	QOI_FMT_RGB565, QOI_FMT_RGB565_SWAP,
+	QOI_FMT_RGB565A8, QOI_FMT_RGB565A8_SWAP,
+	QOI_FMT_ARGB8888,
+};
+#define CHANNEL_COUNT ((int)(sizeof(channel_list) / sizeof(channel_list[0])))
+
+#define CHECK(COND, ...) do { \
+		if (!(COND)) { \
+			fprintf(stderr, "qoidiff: %s:%d: ", __FILE__, __LINE__); \
+			fprintf(stderr, __VA_ARGS__); \
+			fprintf(stderr, "\n"); \
+			abort(); \
+		} \
+	} while (0)
+
+#define QOIDIFF_MAX_PIXELS (1 << 20)
+
+static int desc_equal(const qoi_desc *a, const qoi_desc *b) {
+	return
+		a->width == b->width && a->height == b->height &&
+		a->channels == b->channels && a->colorspace == b->colorspace;
+}
+
+// Decode rows in chunks of `chunk` bytes, like a driver streaming from flash.
+// The padding is left out, so decoding stops where the ops run out instead of
+// interpreting the padding. Returns the number of complete rows.
+static unsigned int diff_rows(const qoidiff_copy_t *c, const unsigned char *qoi, int size, int channels, int chunk, unsigned char *out) {
+	qoi_dec_state dec;
+	int p = c->decode_init(&dec, qoi, size, channels);
+	int end = size - 8;
+	if (!p) {
+		return 0;
+	}
+
+	int row_bytes = dec.desc.width * QOI_FMT_BPP(dec.channels);
+	while (dec.y < dec.desc.height) {
+		int n = end - p < chunk ? end - p : chunk;
+		if (n < 0) {
+			n = 0;
+		}
+		int rows = c->decode_rows(&dec, qoi + p, n, out + dec.y * row_bytes, dec.desc.height - dec.y);
+		CHECK(rows >= 0, "%s: qoi_decode_rows() failed", c->name);
+		p += dec.consumed;
+		if (dec.consumed == 0 && rows == 0 && n < chunk) {
+			break;
+		}
+	}
+	return dec.y;
+}
+
+// Decode row y through the seek table at the end of qoi and compare it
+// against the reference
+static void diff_seek(const qoidiff_copy_t *c, const unsigned char *qoi, int size, int channels, unsigned int y, const unsigned char *ref) {
+	qoi_dec_state dec;
+	int p = c->decode_seek(&dec, qoi, size, channels, y);
+	CHECK(p, "%s: qoi_decode_seek() failed", c->name);
+	CHECK(dec.y <= y, "%s: qoi_decode_seek() to %u resumed at %u", c->name, y, dec.y);
+
+	int row_bytes = dec.desc.width * QOI_FMT_BPP(dec.channels);
+	unsigned char *row = malloc(row_bytes);
+	while (dec.y <= y) {
+		CHECK(c->decode_rows(&dec, qoi + p, size - p, row, 1) == 1, "%s: qoi_decode_rows() after seek failed", c->name);
+		p += dec.consumed;
+	}
+	CHECK(memcmp(row, ref + y * row_bytes, row_bytes) == 0, "%s: row %u after seek differs", c->name, y);
+	free(row);
+}
+
+static void diff_decode(const unsigned char *qoi, int size, int param) {
+	int channels = channel_list[param % CHANNEL_COUNT];
+	int chunk = 5 + (param >> 3) % 16;
+	qoi_desc ref_desc;
+
+	if (size >= 14) {
+		// Keep the fuzzer from spending its time on huge images
+		unsigned int w = (unsigned int)qoi[4] << 24 | qoi[5] << 16 | qoi[6] << 8 | qoi[7];
+		unsigned int h = (unsigned int)qoi[8] << 24 | qoi[9] << 16 | qoi[10] << 8 | qoi[11];
+		if (w && h > QOIDIFF_MAX_PIXELS / w) {
+			return;
+		}
+	}
+
+	unsigned char *ref = copies[0]->decode(qoi, size, &ref_desc, channels);
+	for (int i = 1; i < COPY_COUNT; i++) {
+		qoi_desc desc;
+		unsigned char *out = copies[i]->decode(qoi, size, &desc, channels);
+		CHECK(!ref == !out, "%s: qoi_decode() %s", copies[i]->name, out ? "succeeded" : "failed");
+		if (out) {
+			int bpp = QOI_FMT_BPP(channels ? channels : desc.channels);
+			CHECK(desc_equal(&desc, &ref_desc), "%s: qoi_decode() desc differs", copies[i]->name);
+			CHECK(memcmp(out, ref, desc.width * desc.height * bpp) == 0, "%s: qoi_decode() pixels differ", copies[i]->name);
+			free(out);
+		}
+	}
+	if (!ref) {
+		return;
+	}
+
+	int bpp = QOI_FMT_BPP(channels ? channels : ref_desc.channels);
+	int px_len = ref_desc.width * ref_desc.height * bpp;
+	int row_bytes = ref_desc.width * bpp;
+	unsigned char *out = malloc(px_len);
+	int complete = 1;
+	void *ref_table = NULL;
+	int ref_table_len = 0;
+
+	for (int i = 0; i < COPY_COUNT; i++) {
+		const qoidiff_copy_t *c = copies[i];
+		qoi_desc desc;
+
+		memset(out, 0, px_len);
+		CHECK(c->decode_into(out, px_len, qoi, size, &desc, channels) == px_len, "%s: qoi_decode_into() failed", c->name);
+		CHECK(desc_equal(&desc, &ref_desc), "%s: qoi_decode_into() desc differs", c->name);
+		CHECK(memcmp(out, ref, px_len) == 0, "%s: qoi_decode_into() pixels differ", c->name);
+		CHECK(c->decode_into(out, px_len - 1, qoi, size, &desc, channels) == 0, "%s: qoi_decode_into() ignored dst_size", c->name);
+
+		unsigned int rows = diff_rows(c, qoi, size, channels, chunk, out);
+		CHECK(memcmp(out, ref, rows * row_bytes) == 0, "%s: qoi_decode_rows() pixels differ", c->name);
+		complete = complete && rows == ref_desc.height;
+
+		// Seek tables are only defined for images that decode completely
+		if (rows == ref_desc.height) {
+			int interval = 1 + (param >> 7) % 8;
+			int table_len;
+			void *table = c->seek_build(qoi, size, interval, &table_len);
+			CHECK(table, "%s: qoi_seek_build() failed", c->name);
+			if (!ref_table) {
+				ref_table = table;
+				ref_table_len = table_len;
+			}
+			else {
+				CHECK(table_len == ref_table_len && memcmp(table, ref_table, table_len) == 0, "%s: qoi_seek_build() differs", c->name);
+				free(table);
+			}
+		}
+	}
+
+	if (complete && ref_table) {
+		unsigned char *seekable = malloc(size + ref_table_len);
+		memcpy(seekable, qoi, size);
+		memcpy(seekable + size, ref_table, ref_table_len);
+		unsigned int ys[] = {0, ref_desc.height / 2, ref_desc.height - 1, (unsigned int)param % ref_desc.height};
+		for (int i = 0; i < COPY_COUNT; i++) {
+			for (int j = 0; j < (int)(sizeof(ys) / sizeof(ys[0])); j++) {
+				diff_seek(copies[i], seekable, size + ref_table_len, channels, ys[j], ref);
+			}
+		}
+		free(seekable);
+	}
+
+	free(ref_table);
+	free(out);
+	free(ref);
+}
+
+static void diff_tiles(const split_image_t *split, const unsigned char *data, int size, int param) {
+	for (int i = 0; i < split->splits; i++) {
+		uint32_t len;
+		const unsigned char *tile = split_image_tile(split, i, &len);
+		CHECK(tile >= split->data && tile + len <= data + size, "split %d reaches outside the image", i);
+		CHECK((tile - data) % split->align == 0, "split %d isn't aligned", i);
+		diff_decode(tile, len, param);
+	}
+}
+
+static void diff_split(const unsigned char *data, int size, int param) {
+	// With the top bits of param set, the first half of the input is the
+	// image and the second half the pool a V3 image can share splits from
+	int own = (param >> 6) == 3 ? size / 2 : size;
+	split_image_pool_t pool = {data + own, size - own};
+	split_image_t split;
+	if (!split_image_parse(data, own, "_SQOI__", &pool, &split)) {
+		return;
+	}
+	diff_tiles(&split, data, size, param);
+}
+
+static void diff_anim(const unsigned char *data, int size, int param) {
+	anim_image_t anim;
+	if (!anim_image_parse(data, size, &anim)) {
+		return;
+	}
+
+	uint32_t key = split_image_read_32(anim.table);
+	uint32_t key_size = split_image_read_32(anim.table + 4) - key;
+	CHECK(key + key_size <= (uint32_t)size, "keyframe reaches outside the animation");
+	diff_tiles(&anim.key, data + key, key_size, param);
+
+	for (int i = 0; i < anim.frames; i++) {
+		anim_image_frame_t frame;
+		if (!anim_image_frame(&anim, i, &frame)) {
+			continue;
+		}
+		CHECK(frame.base >= data && frame.base + frame.size <= data + size, "frame %d reaches outside the animation", i);
+		for (int j = 0; j < frame.dirty; j++) {
+			anim_image_rect_t rect = anim_image_dirty(&frame, j);
+			CHECK(anim_image_rect_valid(&anim, rect), "frame %d: dirty rect %d is outside the image", i, j);
+		}
+		for (int j = 0; j < frame.patches; j++) {
+			anim_image_rect_t rect;
+			uint32_t len;
+			const unsigned char *patch = anim_image_patch(&frame, j, &rect, &len);
+			CHECK(anim_image_rect_valid(&anim, rect), "frame %d: patch %d is outside the image", i, j);
+			CHECK(rect.y / anim.split_height == (rect.y + rect.h - 1) / anim.split_height, "frame %d: patch %d crosses a split", i, j);
+			CHECK(patch >= frame.base && patch + len <= frame.base + frame.size, "frame %d: patch %d reaches outside the frame", i, j);
+			diff_decode(patch, len, param);
+		}
+	}
+}
+
+static void diff_encode(const unsigned char *data, int size, int param) {
+	int channels = param & 1 ? 4 : 3;
+	int w = 1 + (param >> 1) % 64;
+	int h = size / (w * channels);
+	if (h == 0) {
+		return;
+	}
+
+	qoi_desc desc = {
+		.width = w,
+		.height = h,
+		.channels = channels,
+		.colorspace = QOI_SRGB
+	};
+
+	for (int effort = QOI_EFFORT_FAST; effort <= QOI_EFFORT_RGB565; effort++) {
+		int ref_len;
+		unsigned char *ref = copies[0]->encode_ex(data, &desc, &ref_len, effort);
+		CHECK(ref, "%s: qoi_encode_ex() failed", copies[0]->name);
+
+		for (int i = 0; i < COPY_COUNT; i++) {
+			int len;
+			unsigned char *enc = copies[i]->encode_ex(data, &desc, &len, effort);
+			CHECK(enc && len == ref_len && memcmp(enc, ref, len) == 0, "%s: qoi_encode_ex(%d) differs", copies[i]->name, effort);
+			free(enc);
+			if (effort == QOI_EFFORT_FAST) {
+				enc = copies[i]->encode(data, &desc, &len);
+				CHECK(enc && len == ref_len && memcmp(enc, ref, len) == 0, "%s: qoi_encode() differs", copies[i]->name);
+				free(enc);
+			}
+		}
+
+		// Lossless except for what the effort level allows
+		qoi_desc dec_desc;
+		unsigned char *dec = copies[0]->decode(ref, ref_len, &dec_desc, channels);
+		CHECK(dec && desc_equal(&desc, &dec_desc), "qoi_encode_ex(%d) doesn't decode", effort);
+		int mask = effort == QOI_EFFORT_RGB565 ? 0xf8fcf8 : 0xffffff;
+		for (int j = 0; j < w * h; j++) {
+			const unsigned char *a = data + j * channels;
+			const unsigned char *b = dec + j * channels;
+			int visible = channels == 3 || a[3] != 0 || effort == QOI_EFFORT_FAST;
+			int diff = (a[0] << 16 | a[1] << 8 | a[2]) ^ (b[0] << 16 | b[1] << 8 | b[2]);
+			CHECK(channels == 3 || a[3] == b[3], "qoi_encode_ex(%d) changed alpha of pixel %d", effort, j);
+			CHECK(!visible || !(diff & mask), "qoi_encode_ex(%d) changed pixel %d", effort, j);
+		}
+		free(dec);
+
+		diff_decode(ref, ref_len, param);
+		free(ref);
+	}
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+	static const unsigned char magic[4][14] = {"_SQOI__\0V1.00", "_SQOI__\0V2.00", "_SQOI__\0V3.00", "_AQOI__\0V1.00"};
+	if (size < 2 || size > (1 << 22)) {
+		return 0;
+	}
+
+	int test = data[0] % 6;
+	int param = data[1];
+	data += 2;
+	size -= 2;
+
+	switch (test) {
+		case 0:
+			diff_decode(data, (int)size, param);
+			break;
+		case 1:
+		case 3:
+		case 4:
+		case 5: {
+			// An exactly sized copy lets ASan catch the parser reading past the end
+			unsigned char *split = malloc(sizeof(magic[0]) + size);
+			memcpy(split, magic[test == 1 ? 0 : test - 2], sizeof(magic[0]));
+			memcpy(split + sizeof(magic[0]), data, size);
+			if (test == 5) {
+				diff_anim(split, (int)(sizeof(magic[0]) + size), param);
+			}
+			else {
+				diff_split(split, (int)(sizeof(magic[0]) + size), param);
+			}
+			free(split);
+			break;
+		}
+		case 2:
+			diff_encode(data, (int)size, param);
+			break;
+	}
+	return 0;
+}
+
+#ifdef QOIDIFF_MAIN
+
+static unsigned int rnd_state = 1;
+static unsigned int rnd(void) {
+	rnd_state = rnd_state * 1103515245 + 12345;
+	return rnd_state >> 8;
+}
+
+// Pixels with runs, repeats and small differences, to reach all QOI ops
+static void rnd_pixels(unsigned char *px, int len) {
+	for (int i = 0; i < len; i++) {
+		switch (rnd() % 4) {
+			case 0: px[i] = rnd(); break;
+			case 1: px[i] = i >= 4 ? px[i - 4] + rnd() % 5 - 2 : 0; break;
+			default: px[i] = i >= 4 ? px[i - 4] : 0; break;
+		}
+		if ((i & 3) == 3 && rnd() % 4 == 0) {
+			px[i] = rnd() % 2 ? 0 : 255;
+		}
+	}
+}
+
+static void put_16(unsigned char *p, unsigned int v) {
+	p[0] = v;
+	p[1] = v >> 8;
+}
+
+static void put_32(unsigned char *p, unsigned int v) {
+	for (int k = 0; k < 4; k++) {
+		p[k] = v >> (k * 8);
+	}
+}
+
+// Write a V1, V2 or V3 split image of the pixels, cut into splits of sh rows,
+// without its 14 byte magic. Stops at the last split that fits in size bytes.
+// Returns the number of bytes written.
+static int gen_split(unsigned char *out, int size, const unsigned char *px, int w, int h, int channels, int version, int sh) {
+	int align = version > 1 ? 1 << rnd() % 4 : 1;
+	int splits = (h + sh - 1) / sh;
+	int p = 0;
+	put_16(out + p, w); p += 2;
+	put_16(out + p, h); p += 2;
+	put_16(out + p, splits); p += 2;
+	put_16(out + p, sh); p += 2;
+	if (version > 1) {
+		out[p++] = SPLIT_IMAGE_FORMAT_QOI;
+		out[p++] = channels;
+		put_16(out + p, align); p += 2;
+		put_16(out + p, 0); p += 2;
+	}
+	int reach = p;
+	p += version == 3 ? 4 : 0;
+	int table = p;
+	p += version == 3 ? splits * 8 : version == 2 ? (splits + 1) * 4 : splits * 2;
+	for (int s = 0; s < splits; s++) {
+		int th = s == splits - 1 ? h - s * sh : sh;
+		int tile_len;
+		unsigned char *tile = qoidiff_bench.encode(px + s * sh * w * channels, &(qoi_desc){w, th, channels, QOI_SRGB}, &tile_len);
+		while ((p + 14) % align) {
+			out[p++] = 0;
+		}
+		if (p + tile_len > size) {
+			free(tile);
+			break;
+		}
+		if (version == 3) {
+			// This split's offset and length
+			put_32(out + table + s * 8, p + 14);
+			put_32(out + table + s * 8 + 4, tile_len);
+		}
+		else if (version == 2) {
+			// This split's offset and the end offset, overwritten by the next split
+			put_32(out + table + s * 4, p + 14);
+			put_32(out + table + s * 4 + 4, p + 14 + tile_len);
+		}
+		else {
+			put_16(out + table + s * 2, tile_len);
+		}
+		memcpy(out + p, tile, tile_len);
+		p += tile_len;
+		free(tile);
+	}
+	if (version == 3) {
+		// Not trusted by the parser: within the image, or past it
+		put_32(out + reach, p + 14 + (rnd() % 4 == 0 ? rnd() % 256 : 0));
+	}
+	return p;
+}
+
+#define ANIM_BUF_SIZE (1 << 18)
+#define ANIM_MAX_FRAMES 4
+#define ANIM_MAX_RECTS 3
+
+// Write an animation of the pixels as its keyframe, without its 14 byte magic.
+// Each frame has random dirty rects, and random patches that stay within a
+// split. Returns the number of bytes written.
+static int gen_anim(unsigned char *out, int size, const unsigned char *px, int w, int h, int channels) {
+	int frames = 1 + rnd() % ANIM_MAX_FRAMES;
+	int sh = 1 + rnd() % h;
+	int p = 0;
+	put_16(out + p, w); p += 2;
+	put_16(out + p, h); p += 2;
+	put_16(out + p, frames); p += 2;
+	put_16(out + p, sh); p += 2;
+	out[p++] = SPLIT_IMAGE_FORMAT_QOI;
+	out[p++] = channels;
+	put_32(out + p, 0); p += 4;
+	int table = p;
+	p += (frames + 2) * 4;
+
+	// The keyframe, a V2 or V3 split image with its own magic
+	put_32(out + table, p + 14);
+	memcpy(out + p, rnd() % 2 ? "_SQOI__\0V2.00" : "_SQOI__\0V3.00", 14);
+	int version = out[p + 9] - '0';
+	p += 14;
+	p += gen_split(out + p, size / 2 - p, px, w, h, channels, version, sh);
+
+	for (int f = 0; f < frames; f++) {
+		int start = p;
+		int dirty = rnd() % (ANIM_MAX_RECTS + 1);
+		int patches = rnd() % (ANIM_MAX_RECTS + 1);
+		put_32(out + table + (f + 1) * 4, start + 14);
+		put_16(out + p, dirty); p += 2;
+		put_16(out + p, patches); p += 2;
+		for (int i = 0; i < dirty; i++) {
+			int x = rnd() % w;
+			int y = rnd() % h;
+			put_16(out + p, x);
+			put_16(out + p + 2, y);
+			put_16(out + p + 4, 1 + rnd() % (w - x));
+			put_16(out + p + 6, 1 + rnd() % (h - y));
+			p += ANIM_IMAGE_RECT_SIZE;
+		}
+		int entry = p;
+		p += patches * ANIM_IMAGE_PATCH_SIZE;
+		for (int i = 0; i < patches; i++) {
+			// Within the split of its first row
+			int x = rnd() % w;
+			int y = rnd() % h;
+			int split_end = (y / sh + 1) * sh < h ? (y / sh + 1) * sh : h;
+			int pw = 1 + rnd() % (w - x);
+			int ph = 1 + rnd() % (split_end - y);
+			unsigned char *patch_px = malloc(pw * ph * channels);
+			rnd_pixels(patch_px, pw * ph * channels);
+			int len;
+			unsigned char *patch = qoidiff_bench.encode(patch_px, &(qoi_desc){pw, ph, channels, QOI_SRGB}, &len);
+			free(patch_px);
+			if (p + len > size) {
+				len = 0;
+			}
+			put_16(out + entry, x);
+			put_16(out + entry + 2, y);
+			put_16(out + entry + 4, pw);
+			put_16(out + entry + 6, ph);
+			put_32(out + entry + 8, p - start);
+			put_32(out + entry + 12, len);
+			memcpy(out + p, patch, len);
+			p += len;
+			entry += ANIM_IMAGE_PATCH_SIZE;
+			free(patch);
+		}
+	}
+	put_32(out + table + (frames + 1) * 4, p + 14);
+	return p;
+}
+
+static void run_input(const unsigned char *data, size_t size) {
+	// Exactly sized, so ASan catches overreads
+	unsigned char *copy = malloc(size);
+	memcpy(copy, data, size);
+	LLVMFuzzerTestOneInput(copy, size);
+	free(copy);
+}
+
+int main(int argc, char **argv) {
+	if (argc < 2) {
+		printf("Usage: qoidiff <iterations> | <file> ...\n");
+		printf("Runs the files as fuzzer inputs, or <iterations> random inputs\n");
+		return 1;
+	}
+
+	char *end;
+	long iterations = strtol(argv[1], &end, 10);
+	if (*end != '\0') {
+		for (int i = 1; i < argc; i++) {
+			FILE *f = fopen(argv[i], "rb");
+			CHECK(f, "can't open %s", argv[i]);
+			fseek(f, 0, SEEK_END);
+			long size = ftell(f);
+			fseek(f, 0, SEEK_SET);
+			unsigned char *data = malloc(size);
+			CHECK(fread(data, 1, size, f) == (size_t)size, "can't read %s", argv[i]);
+			fclose(f);
+			run_input(data, size);
+			free(data);
+		}
+		printf("qoidiff: %d files ok\n", argc - 1);
+		return 0;
+	}
+
+	unsigned char *buf = malloc(2 + (1 << 16));
+	unsigned char *anim = malloc(ANIM_BUF_SIZE);
+	for (long it = 0; it < iterations; it++) {
+		int w = 1 + rnd() % 48;
+		int h = 1 + rnd() % 48;
+		int channels = 3 + rnd() % 2;
+		int len = w * h * channels;
+		unsigned char *px = malloc(len);
+		rnd_pixels(px, len);
+
+		// Encode test on the pixels
+		buf[0] = 2;
+		buf[1] = (channels == 4) | (w - 1) << 1;
+		memcpy(buf + 2, px, len);
+		run_input(buf, 2 + len);
+
+		// Decode tests on the encoded image, intact and mutated
+		int qoi_len;
+		unsigned char *qoi = qoidiff_bench.encode(px, &(qoi_desc){w, h, channels, QOI_SRGB}, &qoi_len);
+		for (int m = 0; m < 4 && qoi_len <= (1 << 16); m++) {
+			int size = qoi_len;
+			buf[0] = 0;
+			buf[1] = rnd();
+			memcpy(buf + 2, qoi, qoi_len);
+			if (m == 1) {
+				buf[2 + 14 + rnd() % (qoi_len - 14)] ^= 1 << rnd() % 8;
+			}
+			else if (m == 2) {
+				size = 14 + rnd() % (qoi_len - 13);
+			}
+			else if (m == 3) {
+				for (int k = 0; k < 8; k++) {
+					buf[2 + rnd() % qoi_len] = rnd();
+				}
+			}
+			run_input(buf, 2 + size);
+		}
+
+		// Split image test: the image cut into splits of sh rows, in a V1,
+		// V2 or V3 container. The 14 byte magic is prepended by the test.
+		int version = 1 + rnd() % 3;
+		buf[0] = version == 1 ? 1 : version + 1;
+		buf[1] = rnd();
+		int p = 2 + gen_split(buf + 2, 1 << 15, px, w, h, channels, version, 1 + rnd() % h);
+		while ((p - 2 + 14) % 8) {
+			buf[p++] = 0;
+		}
+		if (version == 3 && rnd() % 4 == 0 && 2 * (14 + p - 2) <= (1 << 16)) {
+			// A pool after the image holding a copy of it, some splits shared from there
+			int len = 14 + p - 2;
+			memcpy(buf + p, "_SQOI__\0V3.00", 14);
+			memcpy(buf + p + 14, buf + 2, p - 2);
+			p += len;
+			for (int s = 0; s < split_image_read_16(buf + 2 + 4); s++) {
+				if (rnd() % 2) {
+					put_32(buf + 2 + 18 + s * 8, split_image_read_32(buf + 2 + 18 + s * 8) + len);
+				}
+			}
+			buf[1] |= 0xc0;
+		}
+		if (rnd() % 4 == 0) {
+			buf[2 + rnd() % (p - 2)] = rnd();
+		}
+		run_input(buf, p);
+
+		// Animation test: the image as the keyframe, and frames patching it.
+		// The 14 byte magic is prepended by the test.
+		p = 2 + gen_anim(anim + 2, ANIM_BUF_SIZE - 2, px, w, h, channels);
+		anim[0] = 5;
+		anim[1] = rnd();
+		if (rnd() % 4 == 0) {
+			anim[2 + rnd() % (p - 2)] = rnd();
+		}
+		run_input(anim, p);
+
+		free(qoi);
+		free(px);
+	}
+	free(anim);
+	free(buf);
+	printf("qoidiff: %ld iterations ok\n", iterations);
+	return 0;
+}
+
+#endif // QOIDIFF_MAIN
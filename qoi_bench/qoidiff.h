@@ -0,0 +1,35 @@
+/*
+
+SPDX-License-Identifier: MIT
+
+
+Differential testing of the qoi.h copies in this tree
+
+Each copy is compiled from qoidiff_copy.c into its own object with all public
+functions renamed, and exposes them through a qoidiff_copy_t.
+
+*/
+
+#ifndef QOIDIFF_H
+#define QOIDIFF_H
+
+#include "qoi.h"
+
+typedef struct {
+	const char *name;
+	void *(*encode)(const void *data, const qoi_desc *desc, int *out_len);
+	void *(*encode_ex)(const void *data, const qoi_desc *desc, int *out_len, int effort);
+	void *(*decode)(const void *data, int size, qoi_desc *desc, int channels);
+	int (*decode_into)(void *dst, int dst_size, const void *data, int size, qoi_desc *desc, int channels);
+	int (*decode_init)(qoi_dec_state *state, const void *data, int size, int channels);
+	int (*decode_rows)(qoi_dec_state *state, const void *data, int size, void *out_rows, int n_rows);
+	void *(*seek_build)(const void *data, int size, int interval, int *out_len);
+	int (*decode_seek)(qoi_dec_state *state, const void *data, int size, int channels, unsigned int y);
+} qoidiff_copy_t;
+
+extern const qoidiff_copy_t qoidiff_bench;      // qoi_bench/qoi.h
+extern const qoidiff_copy_t qoidiff_simd;       // qoi_bench/qoi.h with QOI_SIMD
+extern const qoidiff_copy_t qoidiff_sqoi;       // decoder_bench/components/esp_lv_sqoi
+extern const qoidiff_copy_t qoidiff_c2;         // esp32c2_devkits_demo/components/esp_lv_qoi
+
+#endif // QOIDIFF_H
@@ -0,0 +1,50 @@
+/*
+
+SPDX-License-Identifier: MIT
+
+
+One qoi.h copy for qoidiff.c
+
+Compile once per copy, e.g.:
+	cc -c qoidiff_copy.c -DQOIDIFF_NAME=sqoi \
+		-DQOIDIFF_HEADER='"../decoder_bench/components/esp_lv_sqoi/priv_include/qoi.h"'
+
+*/
+
+#define QOIDIFF_CAT2(A, B) A##_##B
+#define QOIDIFF_CAT(A, B) QOIDIFF_CAT2(A, B)
+#define QOIDIFF_FN(F) QOIDIFF_CAT(QOIDIFF_NAME, F)
+
+// Rename all public functions so the copies can be linked together
+#define qoi_encode        QOIDIFF_FN(qoi_encode)
+#define qoi_encode_ex     QOIDIFF_FN(qoi_encode_ex)
+#define qoi_encode_scalar QOIDIFF_FN(qoi_encode_scalar)
+#define qoi_decode        QOIDIFF_FN(qoi_decode)
+#define qoi_decode_into   QOIDIFF_FN(qoi_decode_into)
+#define qoi_decode_init   QOIDIFF_FN(qoi_decode_init)
+#define qoi_decode_rows   QOIDIFF_FN(qoi_decode_rows)
+#define qoi_seek_build    QOIDIFF_FN(qoi_seek_build)
+#define qoi_decode_seek   QOIDIFF_FN(qoi_decode_seek)
+
+#define QOI_NO_STDIO
+#define QOI_IMPLEMENTATION
+#include QOIDIFF_HEADER
+
+// The copy's include guard keeps qoidiff.h from pulling in qoi_bench/qoi.h
+#undef QOI_IMPLEMENTATION
+#include "qoidiff.h"
+
+#define QOIDIFF_STR2(S) #S
+#define QOIDIFF_STR(S) QOIDIFF_STR2(S)
+
+const qoidiff_copy_t QOIDIFF_CAT(qoidiff, QOIDIFF_NAME) = {
+	.name = QOIDIFF_STR(QOIDIFF_NAME),
+	.encode = qoi_encode,
+	.encode_ex = qoi_encode_ex,
+	.decode = qoi_decode,
+	.decode_into = qoi_decode_into,
+	.decode_init = qoi_decode_init,
+	.decode_rows = qoi_decode_rows,
+	.seek_build = qoi_seek_build,
+	.decode_seek = qoi_decode_seek,
+};